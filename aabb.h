@@ -14,6 +14,10 @@ struct aabb
 		center = c; size = s;
 	}
 
+	explicit aabb(uninitialized_tag): center(uninitialized), size(uninitialized)
+	{
+	}
+
 	vec3 min_point() const
 	{
 		return center - size;
@@ -67,3 +71,27 @@ struct aabb
 	vec3 center;
 	vec3 size;
 };
+
+SIMPLEMATH_ASSERT_PLAIN_TYPE(aabb, 24);
+
+/********************************************************************************/
+/*								Batch operations								*/
+/********************************************************************************/
+
+// Same as aabb::mul for each box, 'ret' and 'boxes' can be the same array
+inline void transform_aabbs(aabb *ret, const aabb *boxes, unsigned count, const mat4& mat)
+{
+	// Absolute values of the rotation and scale are computed once
+	mat3 absMat(mat);
+
+	for(unsigned i = 0; i < 9; i++)
+		absMat.mat[i] = absMat.mat[i] < 0.0f ? -absMat.mat[i] : absMat.mat[i];
+
+	for(unsigned i = 0; i < count; i++)
+	{
+		aabb box = boxes[i];
+
+		ret[i].center = mat * box.center;
+		ret[i].size = absMat * box.size;
+	}
+}
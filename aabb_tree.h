@@ -0,0 +1,690 @@
+#pragma once
+
+#include <float.h>
+
+#include <vector>
+
+#include "plane.h"
+#include "frustum.h"
+
+/********************************************************************************/
+/*								aabb_tree_node									*/
+/********************************************************************************/
+
+// Internal nodes store fattened bounds of the subtree, leaves store the fattened bounds of the object
+struct aabb_tree_node
+{
+	vec3 min;
+	unsigned parent;		// ~0u for the root, next free node for free nodes
+	vec3 max;
+	int height;				// 0 for leaves, -1 for free nodes
+
+	unsigned children[2];	// ~0u for leaves
+	unsigned value;			// User value of a leaf
+};
+
+struct aabb_tree_pair
+{
+	unsigned a;
+	unsigned b;
+};
+
+/********************************************************************************/
+/*								aabb_tree										*/
+/********************************************************************************/
+
+// Dynamic bounding volume hierarchy for moving objects
+// Leaves are fattened by 'margin' and by the predicted displacement, an object that moves inside of its fattened bounds doesn't change the tree
+// The tree is kept balanced with rotations of the nodes on the path of each change
+// Nodes are stored in a flat array with a free list, the handles returned by insert are leaf indices that stay valid until the object is removed
+// Queries test the exact object bounds and report the user values of the objects
+struct aabb_tree
+{
+	enum
+	{
+		STACK_SIZE = 256
+	};
+
+	aabb_tree(float margin = 0.1f, float displacementScale = 2.0f): root(~0u), freeNode(~0u), leafCount(0), margin(margin), displacementScale(displacementScale)
+	{
+	}
+
+	// Removes all objects
+	void clear()
+	{
+		nodes.clear();
+		boxes.clear();
+
+		root = ~0u;
+		freeNode = ~0u;
+		leafCount = 0;
+	}
+
+	unsigned insert(const aabb& box, unsigned value)
+	{
+		unsigned leaf = allocate_node();
+
+		aabb_tree_node &node = nodes[leaf];
+
+		node.min = box.min_point() - vec3(margin);
+		node.max = box.max_point() + vec3(margin);
+		node.height = 0;
+		node.value = value;
+
+		boxes[leaf] = box;
+
+		insert_leaf(leaf);
+
+		leafCount++;
+
+		return leaf;
+	}
+
+	void remove(unsigned handle)
+	{
+		remove_leaf(handle);
+
+		release_node(handle);
+
+		leafCount--;
+	}
+
+	// Updates the object bounds, 'displacement' is the expected movement until the next update
+	// Returns true if the leaf had to be reinserted into the tree
+	bool move(unsigned handle, const aabb& box, const vec3& displacement = vec3(0.0f))
+	{
+		boxes[handle] = box;
+
+		vec3 minp = box.min_point();
+		vec3 maxp = box.max_point();
+
+		aabb_tree_node &node = nodes[handle];
+
+		if(contains(node.min, node.max, minp, maxp))
+		{
+			// Bounds that became much larger than needed are reinserted as well
+			vec3 minLarge = minp - vec3(margin * 4.0f) + min_zero(displacement * (displacementScale * 4.0f));
+			vec3 maxLarge = maxp + vec3(margin * 4.0f) + max_zero(displacement * (displacementScale * 4.0f));
+
+			if(contains(minLarge, maxLarge, node.min, node.max))
+				return false;
+		}
+
+		remove_leaf(handle);
+
+		vec3 predicted = displacement * displacementScale;
+
+		node.min = minp - vec3(margin) + min_zero(predicted);
+		node.max = maxp + vec3(margin) + max_zero(predicted);
+
+		insert_leaf(handle);
+
+		return true;
+	}
+
+	const aabb& bounds(unsigned handle) const
+	{
+		return boxes[handle];
+	}
+
+	unsigned value(unsigned handle) const
+	{
+		return nodes[handle].value;
+	}
+
+	unsigned size() const
+	{
+		return leafCount;
+	}
+
+	int height() const
+	{
+		return root != ~0u ? nodes[root].height : 0;
+	}
+
+	// Queries
+	// Traversals use a fixed stack, subtrees that don't fit are traversed with a recursive call
+
+	// Appends values of objects with bounds that overlap the box
+	void aabb_overlap(const aabb& box, std::vector<unsigned>& result) const
+	{
+		if(root != ~0u)
+			aabb_overlap(root, box.min_point(), box.max_point(), result);
+	}
+
+	// Appends values of objects with bounds that are visible in the frustum (see frustum::aabb_classify)
+	void frustum_overlap(const frustum& f, std::vector<unsigned>& result) const
+	{
+		if(root != ~0u)
+			frustum_overlap(root, frustum::PLANE_MASK_ALL, f, result);
+	}
+
+	// Returns the value of the object with the closest entry point of the line (in the direction of 'l.n') or -1
+	// The distance is 0 if the line starts inside of the box
+	int ray_nearest(const line& l, float& distance, float maxDistance = FLT_MAX) const
+	{
+		int nearest = -1;
+
+		distance = maxDistance;
+
+		if(root != ~0u)
+			ray_nearest(root, l, line_inverse_direction(l), distance, nearest);
+
+		return nearest;
+	}
+
+	// Appends value pairs of objects from this tree and the other tree with overlapping bounds
+	// When 'other' is this tree, each overlapping pair of different objects is reported once
+	void pair_overlap(const aabb_tree& other, std::vector<aabb_tree_pair>& result) const
+	{
+		if(root != ~0u && other.root != ~0u)
+			pair_overlap(root, other.root, other, result);
+	}
+
+	std::vector<aabb_tree_node> nodes;
+	std::vector<aabb> boxes;	// Exact bounds of the leaf objects, indexed by the node
+
+	unsigned root;
+
+private:
+	void aabb_overlap(unsigned start, const vec3& minp, const vec3& maxp, std::vector<unsigned>& result) const
+	{
+		unsigned stack[STACK_SIZE];
+		unsigned stackSize = 0;
+
+		stack[stackSize++] = start;
+
+		while(stackSize)
+		{
+			unsigned index = stack[--stackSize];
+
+			const aabb_tree_node &node = nodes[index];
+
+			if(!overlap(node.min, node.max, minp, maxp))
+				continue;
+
+			if(node.height == 0)
+			{
+				if(overlap(boxes[index].min_point(), boxes[index].max_point(), minp, maxp))
+					result.push_back(node.value);
+			}
+			else if(stackSize + 2 > STACK_SIZE)
+			{
+				aabb_overlap(node.children[0], minp, maxp, result);
+				aabb_overlap(node.children[1], minp, maxp, result);
+			}
+			else
+			{
+				stack[stackSize++] = node.children[1];
+				stack[stackSize++] = node.children[0];
+			}
+		}
+	}
+
+	void frustum_overlap(unsigned start, unsigned startMask, const frustum& f, std::vector<unsigned>& result) const
+	{
+		unsigned stack[STACK_SIZE];
+		unsigned stackMask[STACK_SIZE];
+		unsigned stackSize = 0;
+
+		stack[stackSize] = start;
+		stackMask[stackSize++] = startMask;
+
+		while(stackSize)
+		{
+			--stackSize;
+
+			unsigned index = stack[stackSize];
+			unsigned planeMask = stackMask[stackSize];
+
+			const aabb_tree_node &node = nodes[index];
+
+			if(node.height == 0)
+			{
+				if(!planeMask || f.aabb_classify(boxes[index], planeMask) != frustum::CULL_OUTSIDE)
+					result.push_back(node.value);
+
+				continue;
+			}
+
+			if(planeMask && f.aabb_classify(aabb((node.min + node.max) * 0.5f, (node.max - node.min) * 0.5f), planeMask) == frustum::CULL_OUTSIDE)
+				continue;
+
+			if(stackSize + 2 > STACK_SIZE)
+			{
+				frustum_overlap(node.children[0], planeMask, f, result);
+				frustum_overlap(node.children[1], planeMask, f, result);
+				continue;
+			}
+
+			stack[stackSize] = node.children[1];
+			stackMask[stackSize++] = planeMask;
+			stack[stackSize] = node.children[0];
+			stackMask[stackSize++] = planeMask;
+		}
+	}
+
+	void ray_nearest(unsigned start, const line& l, const vec3& invDir, float& distance, int& nearest) const
+	{
+		unsigned stack[STACK_SIZE];
+		unsigned stackSize = 0;
+
+		stack[stackSize++] = start;
+
+		while(stackSize)
+		{
+			unsigned index = stack[--stackSize];
+
+			const aabb_tree_node &node = nodes[index];
+
+			if(line_intersect_aabb_distance(l.p, invDir, node.min, node.max, distance) < 0.0f)
+				continue;
+
+			if(node.height == 0)
+			{
+				float d = line_intersect_aabb_distance(l.p, invDir, boxes[index].min_point(), boxes[index].max_point(), distance);
+
+				if(d >= 0.0f && d < distance)
+				{
+					distance = d;
+					nearest = int(node.value);
+				}
+
+				continue;
+			}
+
+			// Visit the closer child first
+			unsigned first = node.children[0];
+			unsigned second = node.children[1];
+
+			float dFirst = line_intersect_aabb_distance(l.p, invDir, nodes[first].min, nodes[first].max, distance);
+			float dSecond = line_intersect_aabb_distance(l.p, invDir, nodes[second].min, nodes[second].max, distance);
+
+			if(dSecond >= 0.0f && (dFirst < 0.0f || dSecond < dFirst))
+			{
+				unsigned tmp = first;
+				first = second;
+				second = tmp;
+			}
+
+			if(stackSize + 2 > STACK_SIZE)
+			{
+				ray_nearest(first, l, invDir, distance, nearest);
+				ray_nearest(second, l, invDir, distance, nearest);
+				continue;
+			}
+
+			stack[stackSize++] = second;
+			stack[stackSize++] = first;
+		}
+	}
+
+	void pair_overlap(unsigned startA, unsigned startB, const aabb_tree& other, std::vector<aabb_tree_pair>& result) const
+	{
+		bool self = &other == this;
+
+		unsigned stackA[STACK_SIZE];
+		unsigned stackB[STACK_SIZE];
+		unsigned stackSize = 0;
+
+		stackA[stackSize] = startA;
+		stackB[stackSize++] = startB;
+
+		while(stackSize)
+		{
+			--stackSize;
+
+			unsigned indexA = stackA[stackSize];
+			unsigned indexB = stackB[stackSize];
+
+			const aabb_tree_node &a = nodes[indexA];
+			const aabb_tree_node &b = other.nodes[indexB];
+
+			// Pairs of a subtree with itself are split into the pairs of its children
+			if(self && indexA == indexB)
+			{
+				if(a.height == 0)
+					continue;
+
+				if(stackSize + 3 > STACK_SIZE)
+				{
+					pair_overlap(a.children[0], a.children[0], other, result);
+					pair_overlap(a.children[1], a.children[1], other, result);
+					pair_overlap(a.children[0], a.children[1], other, result);
+					continue;
+				}
+
+				stackA[stackSize] = a.children[0];
+				stackB[stackSize++] = a.children[1];
+				stackA[stackSize] = a.children[1];
+				stackB[stackSize++] = a.children[1];
+				stackA[stackSize] = a.children[0];
+				stackB[stackSize++] = a.children[0];
+				continue;
+			}
+
+			if(!overlap(a.min, a.max, b.min, b.max))
+				continue;
+
+			if(a.height == 0 && b.height == 0)
+			{
+				if(overlap(boxes[indexA].min_point(), boxes[indexA].max_point(), other.boxes[indexB].min_point(), other.boxes[indexB].max_point()))
+				{
+					aabb_tree_pair pair = { a.value, b.value };
+					result.push_back(pair);
+				}
+
+				continue;
+			}
+
+			// Descend into the larger subtree
+			if(b.height == 0 || (a.height != 0 && half_area(a.min, a.max) >= half_area(b.min, b.max)))
+			{
+				if(stackSize + 2 > STACK_SIZE)
+				{
+					pair_overlap(a.children[0], indexB, other, result);
+					pair_overlap(a.children[1], indexB, other, result);
+					continue;
+				}
+
+				stackA[stackSize] = a.children[1];
+				stackB[stackSize++] = indexB;
+				stackA[stackSize] = a.children[0];
+				stackB[stackSize++] = indexB;
+			}
+			else
+			{
+				if(stackSize + 2 > STACK_SIZE)
+				{
+					pair_overlap(indexA, b.children[0], other, result);
+					pair_overlap(indexA, b.children[1], other, result);
+					continue;
+				}
+
+				stackA[stackSize] = indexA;
+				stackB[stackSize++] = b.children[1];
+				stackA[stackSize] = indexA;
+				stackB[stackSize++] = b.children[0];
+			}
+		}
+	}
+
+	unsigned allocate_node()
+	{
+		unsigned index;
+
+		if(freeNode != ~0u)
+		{
+			index = freeNode;
+			freeNode = nodes[index].parent;
+		}
+		else
+		{
+			index = unsigned(nodes.size());
+
+			nodes.push_back(aabb_tree_node());
+			boxes.push_back(aabb());
+		}
+
+		aabb_tree_node &node = nodes[index];
+
+		node.parent = ~0u;
+		node.children[0] = ~0u;
+		node.children[1] = ~0u;
+		node.height = 0;
+		node.value = 0;
+
+		return index;
+	}
+
+	void release_node(unsigned index)
+	{
+		nodes[index].parent = freeNode;
+		nodes[index].height = -1;
+
+		freeNode = index;
+	}
+
+	// The sibling is selected by the surface area cost of the new parent and of the enlarged ancestors
+	void insert_leaf(unsigned leaf)
+	{
+		if(root == ~0u)
+		{
+			root = leaf;
+			nodes[root].parent = ~0u;
+			return;
+		}
+
+		vec3 leafMin = nodes[leaf].min;
+		vec3 leafMax = nodes[leaf].max;
+
+		unsigned index = root;
+
+		while(nodes[index].height != 0)
+		{
+			const aabb_tree_node &node = nodes[index];
+
+			float area = half_area(node.min, node.max);
+			float combinedArea = half_area(min_point(node.min, leafMin), max_point(node.max, leafMax));
+
+			// Cost of a new parent for this node and the leaf
+			float cost = 2.0f * combinedArea;
+
+			// Minimum cost of pushing the leaf further down
+			float inheritanceCost = 2.0f * (combinedArea - area);
+
+			float childCost[2];
+
+			for(unsigned i = 0; i < 2; i++)
+			{
+				const aabb_tree_node &child = nodes[node.children[i]];
+
+				float enlarged = half_area(min_point(child.min, leafMin), max_point(child.max, leafMax));
+
+				childCost[i] = (child.height == 0 ? enlarged : enlarged - half_area(child.min, child.max)) + inheritanceCost;
+			}
+
+			if(cost < childCost[0] && cost < childCost[1])
+				break;
+
+			index = childCost[0] < childCost[1] ? node.children[0] : node.children[1];
+		}
+
+		unsigned sibling = index;
+
+		unsigned oldParent = nodes[sibling].parent;
+		unsigned newParent = allocate_node();
+
+		aabb_tree_node &parent = nodes[newParent];
+
+		parent.parent = oldParent;
+		parent.min = min_point(nodes[sibling].min, leafMin);
+		parent.max = max_point(nodes[sibling].max, leafMax);
+		parent.height = nodes[sibling].height + 1;
+		parent.children[0] = sibling;
+		parent.children[1] = leaf;
+
+		if(oldParent != ~0u)
+		{
+			aabb_tree_node &grandParent = nodes[oldParent];
+
+			grandParent.children[grandParent.children[0] == sibling ? 0 : 1] = newParent;
+		}
+		else
+		{
+			root = newParent;
+		}
+
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+
+		refit(newParent);
+	}
+
+	void remove_leaf(unsigned leaf)
+	{
+		if(leaf == root)
+		{
+			root = ~0u;
+			return;
+		}
+
+		unsigned parent = nodes[leaf].parent;
+		unsigned grandParent = nodes[parent].parent;
+		unsigned sibling = nodes[parent].children[0] == leaf ? nodes[parent].children[1] : nodes[parent].children[0];
+
+		release_node(parent);
+
+		if(grandParent != ~0u)
+		{
+			aabb_tree_node &node = nodes[grandParent];
+
+			node.children[node.children[0] == parent ? 0 : 1] = sibling;
+			nodes[sibling].parent = grandParent;
+
+			refit(grandParent);
+		}
+		else
+		{
+			root = sibling;
+			nodes[sibling].parent = ~0u;
+		}
+	}
+
+	// Rebalances the ancestors of a changed subtree and updates their bounds and heights
+	void refit(unsigned index)
+	{
+		while(index != ~0u)
+		{
+			index = balance(index);
+
+			aabb_tree_node &node = nodes[index];
+
+			const aabb_tree_node &left = nodes[node.children[0]];
+			const aabb_tree_node &right = nodes[node.children[1]];
+
+			node.height = 1 + (left.height > right.height ? left.height : right.height);
+			node.min = min_point(left.min, right.min);
+			node.max = max_point(left.max, right.max);
+
+			index = node.parent;
+		}
+	}
+
+	// Rotates the higher child of 'a' up if the heights of its children differ by more than 1, returns the new root of the subtree
+	unsigned balance(unsigned a)
+	{
+		aabb_tree_node &nodeA = nodes[a];
+
+		if(nodeA.height < 2)
+			return a;
+
+		unsigned b = nodeA.children[0];
+		unsigned c = nodeA.children[1];
+
+		int difference = nodes[c].height - nodes[b].height;
+
+		if(difference > 1)
+			return rotate(a, 1);
+
+		if(difference < -1)
+			return rotate(a, 0);
+
+		return a;
+	}
+
+	// Child 'side' of 'a' takes the place of 'a', its higher child stays with it and the lower one goes to 'a'
+	unsigned rotate(unsigned a, unsigned side)
+	{
+		aabb_tree_node &nodeA = nodes[a];
+
+		unsigned c = nodeA.children[side];
+
+		aabb_tree_node &nodeC = nodes[c];
+
+		unsigned f = nodeC.children[0];
+		unsigned g = nodeC.children[1];
+
+		// C takes the place of A
+		nodeC.children[0] = a;
+		nodeC.parent = nodeA.parent;
+		nodeA.parent = c;
+
+		if(nodeC.parent != ~0u)
+		{
+			aabb_tree_node &parent = nodes[nodeC.parent];
+
+			parent.children[parent.children[0] == a ? 0 : 1] = c;
+		}
+		else
+		{
+			root = c;
+		}
+
+		unsigned high = nodes[f].height > nodes[g].height ? f : g;
+		unsigned low = high == f ? g : f;
+
+		nodeC.children[1] = high;
+		nodeA.children[side] = low;
+		nodes[low].parent = a;
+
+		const aabb_tree_node &other = nodes[nodeA.children[1 - side]];
+		const aabb_tree_node &lowNode = nodes[low];
+
+		nodeA.min = min_point(other.min, lowNode.min);
+		nodeA.max = max_point(other.max, lowNode.max);
+		nodeA.height = 1 + (other.height > lowNode.height ? other.height : lowNode.height);
+
+		const aabb_tree_node &highNode = nodes[high];
+
+		nodeC.min = min_point(nodeA.min, highNode.min);
+		nodeC.max = max_point(nodeA.max, highNode.max);
+		nodeC.height = 1 + (nodeA.height > highNode.height ? nodeA.height : highNode.height);
+
+		return c;
+	}
+
+	static vec3 min_point(const vec3& a, const vec3& b)
+	{
+		return vec3(a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z);
+	}
+
+	static vec3 max_point(const vec3& a, const vec3& b)
+	{
+		return vec3(a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z);
+	}
+
+	static vec3 min_zero(const vec3& v)
+	{
+		return min_point(v, vec3(0.0f));
+	}
+
+	static vec3 max_zero(const vec3& v)
+	{
+		return max_point(v, vec3(0.0f));
+	}
+
+	static float half_area(const vec3& minp, const vec3& maxp)
+	{
+		vec3 d = maxp - minp;
+
+		return d.x * d.y + d.y * d.z + d.z * d.x;
+	}
+
+	static bool overlap(const vec3& minA, const vec3& maxA, const vec3& minB, const vec3& maxB)
+	{
+		return minA.x <= maxB.x && maxA.x >= minB.x && minA.y <= maxB.y && maxA.y >= minB.y && minA.z <= maxB.z && maxA.z >= minB.z;
+	}
+
+	// Box A contains box B
+	static bool contains(const vec3& minA, const vec3& maxA, const vec3& minB, const vec3& maxB)
+	{
+		return minA.x <= minB.x && minA.y <= minB.y && minA.z <= minB.z && maxA.x >= maxB.x && maxA.y >= maxB.y && maxA.z >= maxB.z;
+	}
+
+	unsigned freeNode;
+	unsigned leafCount;
+
+	float margin;
+	float displacementScale;
+};
@@ -0,0 +1,419 @@
+#pragma once
+
+#include <math.h>
+
+#include "vector.h"
+#include "matrix.h"
+#include "quat.h"
+#include "aabb.h"
+
+struct affine3x4;
+
+inline SIMPLEMATH_CONSTEXPR_SIMD void mul(affine3x4 &ret, const affine3x4 &n, const affine3x4 &m);
+
+/********************************************************************************/
+/*								affine3x4										*/
+/********************************************************************************/
+
+// Affine transformation, a mat4 without the constant last row (0, 0, 0, 1)
+// Stored by rows, mat[4 * i + 3] is the translation of row i, so the rows can be sent to shaders as three float4 constants
+// Composition, inverse and transformations give the same results as the mat4 functions on the same matrix
+// Results are only bitwise equal when the compiler doesn't fuse multiplications and additions on its own (-ffp-contract=off on GCC and Clang)
+struct SIMPLEMATH_ALIGN16 affine3x4
+{
+	SIMPLEMATH_CONSTEXPR affine3x4(): mat()
+	{
+		mat[0] = 1.0f; mat[1] = 0.0f; mat[2] = 0.0f; mat[3] = 0.0f;
+		mat[4] = 0.0f; mat[5] = 1.0f; mat[6] = 0.0f; mat[7] = 0.0f;
+		mat[8] = 0.0f; mat[9] = 0.0f; mat[10] = 1.0f; mat[11] = 0.0f;
+	}
+
+	// 12 floats by rows
+	SIMPLEMATH_CONSTEXPR explicit affine3x4(const float* m): mat()
+	{
+		for(unsigned i = 0; i < 12; i++)
+			mat[i] = m[i];
+	}
+
+	explicit affine3x4(uninitialized_tag)
+	{
+	}
+
+	SIMPLEMATH_CONSTEXPR affine3x4(const mat3& rotation, const vec3& translation): mat()
+	{
+		mat[0] = rotation.mat[0]; mat[1] = rotation.mat[3]; mat[2] = rotation.mat[6]; mat[3] = translation.x;
+		mat[4] = rotation.mat[1]; mat[5] = rotation.mat[4]; mat[6] = rotation.mat[7]; mat[7] = translation.y;
+		mat[8] = rotation.mat[2]; mat[9] = rotation.mat[5]; mat[10] = rotation.mat[8]; mat[11] = translation.z;
+	}
+
+	SIMPLEMATH_CONSTEXPR explicit affine3x4(const mat3& m): affine3x4(m, vec3(0.0f, 0.0f, 0.0f))
+	{
+	}
+
+	// 'rotation' has to be a unit quaternion
+	SIMPLEMATH_CONSTEXPR affine3x4(const quat& rotation, const vec3& translation): affine3x4(rotation.to_matrix(), translation)
+	{
+	}
+
+	// Last row of 'm' is ignored
+	SIMPLEMATH_CONSTEXPR_SIMD explicit affine3x4(const mat4& m): mat()
+	{
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		{
+			__m128 c0 = _mm_load_ps(&m.mat[0]);
+			__m128 c1 = _mm_load_ps(&m.mat[4]);
+			__m128 c2 = _mm_load_ps(&m.mat[8]);
+			__m128 c3 = _mm_load_ps(&m.mat[12]);
+
+			_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+			_mm_store_ps(&mat[0], c0);
+			_mm_store_ps(&mat[4], c1);
+			_mm_store_ps(&mat[8], c2);
+			return;
+		}
+#endif
+		mat[0] = m.mat[0]; mat[1] = m.mat[4]; mat[2] = m.mat[8]; mat[3] = m.mat[12];
+		mat[4] = m.mat[1]; mat[5] = m.mat[5]; mat[6] = m.mat[9]; mat[7] = m.mat[13];
+		mat[8] = m.mat[2]; mat[9] = m.mat[6]; mat[10] = m.mat[10]; mat[11] = m.mat[14];
+	}
+
+	// Transformation 'm' followed by this one, same as mat4 multiplication
+	SIMPLEMATH_CONSTEXPR_SIMD affine3x4 operator*(const affine3x4& m) const
+	{
+		affine3x4 ret;
+		mul(ret, *this, m);
+		return ret;
+	}
+
+	SIMPLEMATH_CONSTEXPR_SIMD affine3x4& operator*=(const affine3x4& m)
+	{
+		*this = *this * m;
+		return *this;
+	}
+
+	// Same as mul_m4_v3_trans
+	SIMPLEMATH_CONSTEXPR vec3 transform_point(const vec3& v) const
+	{
+		return vec3(mat[0] * v.x + mat[1] * v.y + mat[2] * v.z + mat[3],
+					mat[4] * v.x + mat[5] * v.y + mat[6] * v.z + mat[7],
+					mat[8] * v.x + mat[9] * v.y + mat[10] * v.z + mat[11]);
+	}
+
+	// Translation is ignored
+	SIMPLEMATH_CONSTEXPR vec3 transform_vector(const vec3& v) const
+	{
+		return vec3(mat[0] * v.x + mat[1] * v.y + mat[2] * v.z,
+					mat[4] * v.x + mat[5] * v.y + mat[6] * v.z,
+					mat[8] * v.x + mat[9] * v.y + mat[10] * v.z);
+	}
+
+	// Same as aabb::mul with the mat4 of this transformation
+	aabb transform_aabb(const aabb& box) const
+	{
+		return aabb(transform_point(box.center), abs().transform_vector(box.size));
+	}
+
+	// Absolute values of all elements, transforms extents of boxes
+	SIMPLEMATH_CONSTEXPR affine3x4 abs() const
+	{
+		affine3x4 ret;
+
+		for(unsigned i = 0; i < 12; i++)
+			ret.mat[i] = mat[i] < 0.0f ? -mat[i] : mat[i];
+
+		return ret;
+	}
+
+	SIMPLEMATH_CONSTEXPR vec3 translation() const
+	{
+		return vec3(mat[3], mat[7], mat[11]);
+	}
+
+	SIMPLEMATH_CONSTEXPR float det() const
+	{
+		return mat[0] * (mat[5] * mat[10] - mat[9] * mat[6]) + mat[4] * (mat[9] * mat[2] - mat[1] * mat[10]) + mat[8] * (mat[1] * mat[6] - mat[5] * mat[2]);
+	}
+
+	// 3x3 inverse and an inverse translation, same as mat4::inverse_affine
+	// The two functions are computed in a different shape, so a compiler that contracts them on its own can round them differently
+	SIMPLEMATH_CONSTEXPR_SIMD affine3x4 inverse() const
+	{
+		affine3x4 ret;
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		{
+			__m128 r0 = _mm_load_ps(&mat[0]);
+			__m128 r1 = _mm_load_ps(&mat[4]);
+			__m128 r2 = _mm_load_ps(&mat[8]);
+
+			// Columns of the inverse are cross products of the rows divided by the determinant, the last lanes are zero
+			__m128 c0 = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(r1, r1, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(3, 1, 0, 2))), _mm_mul_ps(_mm_shuffle_ps(r1, r1, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(3, 0, 2, 1))));
+			__m128 c1 = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(r2, r2, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(r0, r0, _MM_SHUFFLE(3, 1, 0, 2))), _mm_mul_ps(_mm_shuffle_ps(r2, r2, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(r0, r0, _MM_SHUFFLE(3, 0, 2, 1))));
+			__m128 c2 = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(r0, r0, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(3, 1, 0, 2))), _mm_mul_ps(_mm_shuffle_ps(r0, r0, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(3, 0, 2, 1))));
+
+			// Determinant is summed in the same order as in mat4::inverse_affine
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r0, c0), _mm_mul_ps(r1, c1)), _mm_mul_ps(r2, c2));
+			__m128 idet = _mm_div_ps(_mm_set1_ps(1.0f), _mm_shuffle_ps(d, d, _MM_SHUFFLE(0, 0, 0, 0)));
+
+			c0 = _mm_mul_ps(c0, idet);
+			c1 = _mm_mul_ps(c1, idet);
+			c2 = _mm_mul_ps(c2, idet);
+
+			__m128 t = _mm_mul_ps(c0, _mm_shuffle_ps(r0, r0, _MM_SHUFFLE(3, 3, 3, 3)));
+			t = _mm_add_ps(t, _mm_mul_ps(c1, _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(3, 3, 3, 3))));
+			t = _mm_add_ps(t, _mm_mul_ps(c2, _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(3, 3, 3, 3))));
+			t = _mm_sub_ps(_mm_setzero_ps(), t);
+
+			_MM_TRANSPOSE4_PS(c0, c1, c2, t);
+
+			_mm_store_ps(&ret.mat[0], c0);
+			_mm_store_ps(&ret.mat[4], c1);
+			_mm_store_ps(&ret.mat[8], c2);
+			return ret;
+		}
+#endif
+		float idet = 1.0f / det();
+
+		ret.mat[0] = (mat[5] * mat[10] - mat[9] * mat[6]) * idet;
+		ret.mat[4] = (mat[8] * mat[6] - mat[4] * mat[10]) * idet;
+		ret.mat[8] = (mat[4] * mat[9] - mat[8] * mat[5]) * idet;
+
+		ret.mat[1] = (mat[9] * mat[2] - mat[1] * mat[10]) * idet;
+		ret.mat[5] = (mat[0] * mat[10] - mat[8] * mat[2]) * idet;
+		ret.mat[9] = (mat[8] * mat[1] - mat[0] * mat[9]) * idet;
+
+		ret.mat[2] = (mat[1] * mat[6] - mat[5] * mat[2]) * idet;
+		ret.mat[6] = (mat[4] * mat[2] - mat[0] * mat[6]) * idet;
+		ret.mat[10] = (mat[0] * mat[5] - mat[4] * mat[1]) * idet;
+
+		ret.mat[3] = -(ret.mat[0] * mat[3] + ret.mat[1] * mat[7] + ret.mat[2] * mat[11]);
+		ret.mat[7] = -(ret.mat[4] * mat[3] + ret.mat[5] * mat[7] + ret.mat[6] * mat[11]);
+		ret.mat[11] = -(ret.mat[8] * mat[3] + ret.mat[9] * mat[7] + ret.mat[10] * mat[11]);
+		return ret;
+	}
+
+	// Inverse of a rotation and translation: transposed rotation and an inverse translation, same as mat4::inverse_rigid
+	SIMPLEMATH_CONSTEXPR affine3x4 inverse_rigid() const
+	{
+		affine3x4 ret;
+
+		ret.mat[0] = mat[0]; ret.mat[1] = mat[4]; ret.mat[2] = mat[8];
+		ret.mat[4] = mat[1]; ret.mat[5] = mat[5]; ret.mat[6] = mat[9];
+		ret.mat[8] = mat[2]; ret.mat[9] = mat[6]; ret.mat[10] = mat[10];
+
+		ret.mat[3] = -(mat[0] * mat[3] + mat[4] * mat[7] + mat[8] * mat[11]);
+		ret.mat[7] = -(mat[1] * mat[3] + mat[5] * mat[7] + mat[9] * mat[11]);
+		ret.mat[11] = -(mat[2] * mat[3] + mat[6] * mat[7] + mat[10] * mat[11]);
+		return ret;
+	}
+
+	SIMPLEMATH_CONSTEXPR_SIMD mat4 to_mat4() const
+	{
+		mat4 ret;
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		{
+			__m128 r0 = _mm_load_ps(&mat[0]);
+			__m128 r1 = _mm_load_ps(&mat[4]);
+			__m128 r2 = _mm_load_ps(&mat[8]);
+			__m128 r3 = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+			_mm_store_ps(&ret.mat[0], r0);
+			_mm_store_ps(&ret.mat[4], r1);
+			_mm_store_ps(&ret.mat[8], r2);
+			_mm_store_ps(&ret.mat[12], r3);
+			return ret;
+		}
+#endif
+		ret.mat[0] = mat[0]; ret.mat[1] = mat[4]; ret.mat[2] = mat[8]; ret.mat[3] = 0.0f;
+		ret.mat[4] = mat[1]; ret.mat[5] = mat[5]; ret.mat[6] = mat[9]; ret.mat[7] = 0.0f;
+		ret.mat[8] = mat[2]; ret.mat[9] = mat[6]; ret.mat[10] = mat[10]; ret.mat[11] = 0.0f;
+		ret.mat[12] = mat[3]; ret.mat[13] = mat[7]; ret.mat[14] = mat[11]; ret.mat[15] = 1.0f;
+		return ret;
+	}
+
+	// Rotation and scale part
+	SIMPLEMATH_CONSTEXPR mat3 to_mat3() const
+	{
+		return mat3(vec3(mat[0], mat[4], mat[8]), vec3(mat[1], mat[5], mat[9]), vec3(mat[2], mat[6], mat[10]));
+	}
+
+	// Rotation part has to be orthonormal
+	quat to_quat() const
+	{
+		return quat(to_mat3());
+	}
+
+	float mat[12];
+};
+
+SIMPLEMATH_ASSERT_PLAIN_TYPE(affine3x4, 48);
+
+// Each element is summed from the left like in mat4 multiplication, the translation is added last
+// 36 multiplications instead of 64 for mat4, 96 bytes of input instead of 128
+inline SIMPLEMATH_CONSTEXPR_SIMD void mul(affine3x4 &ret, const affine3x4 &n, const affine3x4 &m)
+{
+#if defined(SIMPLEMATH_AVX)
+	if(!SIMPLEMATH_CONSTANT_EVALUATED())
+	{
+		// First two result rows at a time, both halves hold the same row of 'm'
+		__m256 m0 = _mm256_broadcast_ps((const __m128*)&m.mat[0]);
+		__m256 m1 = _mm256_broadcast_ps((const __m128*)&m.mat[4]);
+		__m256 m2 = _mm256_broadcast_ps((const __m128*)&m.mat[8]);
+
+		__m256 n01 = _mm256_loadu_ps(&n.mat[0]);
+		__m128 n2 = _mm_load_ps(&n.mat[8]);
+
+		__m256 r01 = _mm256_mul_ps(_mm256_shuffle_ps(n01, n01, _MM_SHUFFLE(0, 0, 0, 0)), m0);
+		r01 = SIMPLEMATH_MUL_ADD_256(_mm256_shuffle_ps(n01, n01, _MM_SHUFFLE(1, 1, 1, 1)), m1, r01);
+		r01 = SIMPLEMATH_MUL_ADD_256(_mm256_shuffle_ps(n01, n01, _MM_SHUFFLE(2, 2, 2, 2)), m2, r01);
+		r01 = _mm256_add_ps(r01, _mm256_and_ps(n01, _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1))));
+
+		__m128 r2 = _mm_mul_ps(_mm_set1_ps(n.mat[8]), _mm256_castps256_ps128(m0));
+		r2 = SIMPLEMATH_MUL_ADD_128(_mm_set1_ps(n.mat[9]), _mm256_castps256_ps128(m1), r2);
+		r2 = SIMPLEMATH_MUL_ADD_128(_mm_set1_ps(n.mat[10]), _mm256_castps256_ps128(m2), r2);
+		r2 = _mm_add_ps(r2, _mm_and_ps(n2, _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1))));
+
+		_mm256_storeu_ps(&ret.mat[0], r01);
+		_mm_store_ps(&ret.mat[8], r2);
+		return;
+	}
+#elif defined(SIMPLEMATH_SSE41)
+	if(!SIMPLEMATH_CONSTANT_EVALUATED())
+	{
+		__m128 m0 = _mm_load_ps(&m.mat[0]);
+		__m128 m1 = _mm_load_ps(&m.mat[4]);
+		__m128 m2 = _mm_load_ps(&m.mat[8]);
+
+		__m128 translation = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+
+		for(unsigned i = 0; i < 12; i += 4)
+		{
+			__m128 r = _mm_mul_ps(_mm_set1_ps(n.mat[i]), m0);
+			r = SIMPLEMATH_MUL_ADD_128(_mm_set1_ps(n.mat[i + 1]), m1, r);
+			r = SIMPLEMATH_MUL_ADD_128(_mm_set1_ps(n.mat[i + 2]), m2, r);
+			r = _mm_add_ps(r, _mm_and_ps(_mm_load_ps(&n.mat[i]), translation));
+
+			_mm_store_ps(&ret.mat[i], r);
+		}
+		return;
+	}
+#endif
+	// Translation is multiplied by the last row (0, 0, 0, 1) like in mat4 multiplication, so that the compiler vectorizes the rows
+	// The result is assigned at the end, 'ret' can be the same matrix as 'n' or 'm'
+	affine3x4 r;
+
+#if defined(SIMPLEMATH_FMA)
+	for(unsigned i = 0; i < 12; i += 4)
+	{
+		for(unsigned j = 0; j < 4; j++)
+			r.mat[i + j] = mul_add(n.mat[i + 3], j == 3 ? 1.0f : 0.0f, mul_add(n.mat[i + 2], m.mat[8 + j], mul_add(n.mat[i + 1], m.mat[4 + j], n.mat[i] * m.mat[j])));
+	}
+#else
+	r.mat[0] = n.mat[0] * m.mat[0] + n.mat[1] * m.mat[4] + n.mat[2] * m.mat[8] + n.mat[3] * 0.0f;
+	r.mat[1] = n.mat[0] * m.mat[1] + n.mat[1] * m.mat[5] + n.mat[2] * m.mat[9] + n.mat[3] * 0.0f;
+	r.mat[2] = n.mat[0] * m.mat[2] + n.mat[1] * m.mat[6] + n.mat[2] * m.mat[10] + n.mat[3] * 0.0f;
+	r.mat[3] = n.mat[0] * m.mat[3] + n.mat[1] * m.mat[7] + n.mat[2] * m.mat[11] + n.mat[3] * 1.0f;
+	r.mat[4] = n.mat[4] * m.mat[0] + n.mat[5] * m.mat[4] + n.mat[6] * m.mat[8] + n.mat[7] * 0.0f;
+	r.mat[5] = n.mat[4] * m.mat[1] + n.mat[5] * m.mat[5] + n.mat[6] * m.mat[9] + n.mat[7] * 0.0f;
+	r.mat[6] = n.mat[4] * m.mat[2] + n.mat[5] * m.mat[6] + n.mat[6] * m.mat[10] + n.mat[7] * 0.0f;
+	r.mat[7] = n.mat[4] * m.mat[3] + n.mat[5] * m.mat[7] + n.mat[6] * m.mat[11] + n.mat[7] * 1.0f;
+	r.mat[8] = n.mat[8] * m.mat[0] + n.mat[9] * m.mat[4] + n.mat[10] * m.mat[8] + n.mat[11] * 0.0f;
+	r.mat[9] = n.mat[8] * m.mat[1] + n.mat[9] * m.mat[5] + n.mat[10] * m.mat[9] + n.mat[11] * 0.0f;
+	r.mat[10] = n.mat[8] * m.mat[2] + n.mat[9] * m.mat[6] + n.mat[10] * m.mat[10] + n.mat[11] * 0.0f;
+	r.mat[11] = n.mat[8] * m.mat[3] + n.mat[9] * m.mat[7] + n.mat[10] * m.mat[11] + n.mat[11] * 1.0f;
+#endif
+
+	ret = r;
+}
+
+/********************************************************************************/
+/*								Batch operations								*/
+/********************************************************************************/
+
+// Same as the mat4 versions of transform_points and transform_directions
+inline void transform_points(vec3 *ret, unsigned retStride, const vec3 *v, unsigned vStride, unsigned count, const affine3x4 &m)
+{
+	transform_vec3_array<true, false>(ret, retStride, v, vStride, count, m.to_mat4());
+}
+
+inline void transform_points(vec3 *ret, const vec3 *v, unsigned count, const affine3x4 &m)
+{
+	transform_vec3_array<true, false>(ret, sizeof(vec3), v, sizeof(vec3), count, m.to_mat4());
+}
+
+inline void transform_directions(vec3 *ret, unsigned retStride, const vec3 *v, unsigned vStride, unsigned count, const affine3x4 &m)
+{
+	transform_vec3_array<false, false>(ret, retStride, v, vStride, count, m.to_mat4());
+}
+
+inline void transform_directions(vec3 *ret, const vec3 *v, unsigned count, const affine3x4 &m)
+{
+	transform_vec3_array<false, false>(ret, sizeof(vec3), v, sizeof(vec3), count, m.to_mat4());
+}
+
+// Same as affine3x4::transform_aabb for each box, 'ret' and 'boxes' can be the same array
+inline void transform_aabbs(aabb *ret, const aabb *boxes, unsigned count, const affine3x4 &m)
+{
+	// Absolute values of the rotation and scale are computed once
+	affine3x4 absMat = m.abs();
+
+	for(unsigned i = 0; i < count; i++)
+	{
+		aabb box = boxes[i];
+
+		ret[i].center = m.transform_point(box.center);
+		ret[i].size = absMat.transform_vector(box.size);
+	}
+}
+
+// Each box with its own transformation, as in the world bounds of scene nodes
+inline void transform_aabbs(aabb *ret, const aabb *boxes, const affine3x4 *transforms, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i] = transforms[i].transform_aabb(boxes[i]);
+}
+
+// ret[i] = n[i] * m[i], 'ret' can be the same array as 'n' or 'm'
+inline void mul(affine3x4 *ret, const affine3x4 *n, const affine3x4 *m, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i] = n[i] * m[i];
+}
+
+// Batch inversion, 'ret' and 'm' can be the same array
+inline void inverse(affine3x4 *ret, const affine3x4 *m, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i] = m[i].inverse();
+}
+
+inline void inverse_rigid(affine3x4 *ret, const affine3x4 *m, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i] = m[i].inverse_rigid();
+}
+
+// Conversion for the APIs that take full matrices
+inline void to_mat4(mat4 *ret, const affine3x4 *m, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+	{
+#if defined(SIMPLEMATH_SSE41)
+		ret[i] = m[i].to_mat4();
+#else
+		// Written in place, a temporary matrix is copied with vector loads of the scalar stores that are not forwarded
+		const float *src = m[i].mat;
+		float *dst = ret[i].mat;
+
+		dst[0] = src[0]; dst[1] = src[4]; dst[2] = src[8]; dst[3] = 0.0f;
+		dst[4] = src[1]; dst[5] = src[5]; dst[6] = src[9]; dst[7] = 0.0f;
+		dst[8] = src[2]; dst[9] = src[6]; dst[10] = src[10]; dst[11] = 0.0f;
+		dst[12] = src[3]; dst[13] = src[7]; dst[14] = src[11]; dst[15] = 1.0f;
+#endif
+	}
+}
@@ -0,0 +1,1551 @@
+// Micro-benchmarks for simplemath
+//
+// Build (from the repository root):
+//	g++ -std=c++11 -O2 -pthread -I. bench/bench.cpp -o simplemath_bench
+//	g++ -std=c++11 -O2 -pthread -DSIMPLEMATH_SIMD -mavx2 -I. bench/bench.cpp -o simplemath_bench_avx2
+//	g++ -std=c++11 -O2 -pthread -DSIMPLEMATH_SIMD -DSIMPLEMATH_FMA -mavx2 -mfma -ffp-contract=off -I. bench/bench.cpp -o simplemath_bench_fma
+//	cl /O2 /EHsc /I. bench\bench.cpp
+//
+// Usage:
+//	simplemath_bench [--format=csv|json|text] [--filter=substring] [--time=ms] [--samples=n] [--output=file]
+//	simplemath_bench --compare base.csv current.csv [--threshold=percent]
+//	simplemath_bench --errors [--output=file]
+//	simplemath_bench --plane-tests [--output=file]
+//	simplemath_bench --packet-tests [--output=file]
+//	simplemath_bench --skinning-tests [--output=file]
+//
+// Each case processes an array of randomized inputs, results are in nanoseconds per element
+// Comparison exits with code 1 if any case is slower than the base run by more than the threshold (default 5%)
+// Error report prints the largest errors of the approximations in fastmath.h and of the functions that use them
+// SIMPLEMATH_FMA gains are the comparison with the same build without -DSIMPLEMATH_FMA
+// Plane test report prints how many frustum planes are tested per box during a camera path replay, with and without the cached rejecting plane
+// Packet test report compares the packet line-triangle intersection with the scalar function lane by lane and exits with code 1 if any result differs
+// Skinning test report runs skin_linear and skin_dualquat without normals and without source normals and exits with code 1 if positions change or normals are not zero
+
+#include "bench.h"
+
+#include "../vector.h"
+#include "../matrix.h"
+#include "../affine.h"
+#include "../transform.h"
+#include "../quat.h"
+#include "../aabb.h"
+#include "../plane.h"
+#include "../frustum.h"
+#include "../bvh.h"
+#include "../packed.h"
+#include "../octree.h"
+#include "../aabb_tree.h"
+#include "../hierarchy.h"
+#include "../parallel.h"
+#include "../lazy.h"
+#include "../skinning.h"
+
+/********************************************************************************/
+/*								Inputs											*/
+/********************************************************************************/
+
+// Small enough to stay in the cache, so the results show the computation cost
+static const unsigned N = 1024;
+
+// Large enough to not fit in the cache
+static const unsigned BOX_COUNT = 500000;
+
+// Camera path replays cull this many scene boxes in each frame
+static const unsigned PATH_BOX_COUNT = 50000;
+static const unsigned PATH_FRAMES = 240;
+
+// Scene graph nodes in the hierarchy updates
+static const unsigned HIERARCHY_COUNT = 300000;
+
+// Transform arrays that don't fit in the cache, 19MB of mat4 and 14MB of affine3x4
+static const unsigned TRANSFORM_COUNT = 100000;
+
+// Skinned mesh
+static const unsigned SKIN_VERTEX_COUNT = 16384;
+static const unsigned SKIN_JOINT_COUNT = 64;
+
+// Crowd skinning, the palette doesn't fit in the L2 cache
+static const unsigned CROWD_VERTEX_COUNT = 262144;
+static const unsigned CROWD_JOINT_COUNT = 16384;
+
+struct bench_data
+{
+	bench_data()
+	{
+		bench_random rng(17);
+
+		a2.resize(N); b2.resize(N); c2.resize(N);
+		a3.resize(N); b3.resize(N); c3.resize(N); normals.resize(N);
+		a4.resize(N); b4.resize(N);
+		f.resize(N); t.resize(N);
+		m3.resize(N); m4.resize(N); affine.resize(N); rigid.resize(N);
+		qa.resize(N); qb.resize(N);
+		boxes.resize(N); planes.resize(N); lines.resize(N);
+
+		for(unsigned i = 0; i < N; i++)
+		{
+			a2[i] = vec2(rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f));
+			b2[i] = vec2(rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f));
+			c2[i] = vec2(rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f));
+
+			a3[i] = vec3(rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f));
+			b3[i] = vec3(rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f));
+			c3[i] = vec3(rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f));
+
+			a4[i] = vec4(rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f));
+			b4[i] = vec4(rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f));
+
+			f[i] = rng.uniform(0.1f, 2.0f);
+			t[i] = rng.uniform(0.0f, 1.0f);
+
+			// Rotation, scale and translation
+			mat4 r;
+			r.rotate(random_direction(rng), rng.uniform(-180.0f, 180.0f));
+
+			mat4 s;
+			s.scale(vec3(rng.uniform(0.5f, 2.0f), rng.uniform(0.5f, 2.0f), rng.uniform(0.5f, 2.0f)));
+
+			mat4 tr;
+			tr.translate(a3[i]);
+
+			rigid[i] = tr * r;
+			affine[i] = rigid[i] * s;
+
+			// General matrices are affine transforms with a perturbed last row
+			m4[i] = affine[i];
+			m4[i].mat[3] = rng.uniform(-0.1f, 0.1f);
+			m4[i].mat[7] = rng.uniform(-0.1f, 0.1f);
+			m4[i].mat[11] = rng.uniform(-0.1f, 0.1f);
+
+			m3[i] = mat3(affine[i]);
+
+			qa[i] = quat(mat3(rigid[i]));
+			qb[i].set(random_direction(rng), rng.uniform(-180.0f, 180.0f));
+
+			boxes[i] = aabb(a3[i], vec3(rng.uniform(0.1f, 2.0f), rng.uniform(0.1f, 2.0f), rng.uniform(0.1f, 2.0f)));
+
+			planes[i] = plane(random_direction(rng), rng.uniform(-5.0f, 5.0f));
+
+			lines[i] = line(b3[i], c3[i]);
+		}
+
+		// Camera in the middle of the scene
+		mat4 view;
+		view.look_at(vec3(0, 0, 0), vec3(1, 0.2f, 0.3f), vec3(0, 0, 1));
+
+		projection.perspective_rh(60, 1.5f, 0.1f, 500.0f);
+		viewProjection = projection * view;
+
+		camera.calculate_planes(viewProjection);
+
+		sceneBoxes.resize(BOX_COUNT);
+
+		for(unsigned i = 0; i < BOX_COUNT; i++)
+		{
+			vec3 center(rng.uniform(-500.0f, 500.0f), rng.uniform(-500.0f, 500.0f), rng.uniform(-50.0f, 50.0f));
+
+			sceneBoxes[i] = aabb(center, vec3(rng.uniform(0.5f, 5.0f), rng.uniform(0.5f, 5.0f), rng.uniform(0.5f, 5.0f)));
+		}
+
+		for(unsigned i = 0; i < N; i++)
+			normals[i] = bench_data::random_direction(rng);
+
+		// Camera moving on a closed loop through the scene and turning from side to side
+		cameraPath.resize(PATH_FRAMES);
+
+		for(unsigned i = 0; i < PATH_FRAMES; i++)
+		{
+			float angle = 6.2831853f * float(i) / float(PATH_FRAMES);
+			float yaw = angle + 1.5707963f + 0.5f * sinf(angle * 8.0f);
+
+			vec3 pos(250.0f * cosf(angle), 250.0f * sinf(angle), 10.0f);
+
+			mat4 pathView;
+			pathView.look_at(pos, pos + vec3(cosf(yaw), sinf(yaw), -0.1f), vec3(0, 0, 1));
+
+			cameraPath[i].calculate_planes(projection * pathView);
+		}
+	}
+
+	static vec3 random_direction(bench_random& rng)
+	{
+		vec3 v;
+
+		do
+		{
+			v = vec3(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f));
+		}
+		while(v.length_squared() < 0.01f || v.length_squared() > 1.0f);
+
+		return normalize(v);
+	}
+
+	std::vector<vec2> a2, b2, c2;
+	std::vector<vec3> a3, b3, c3;
+	std::vector<vec3> normals;
+	std::vector<vec4> a4, b4;
+	std::vector<float> f, t;
+	std::vector<mat3> m3;
+	std::vector<mat4> m4, affine, rigid;
+	std::vector<quat> qa, qb;
+	std::vector<aabb> boxes;
+	std::vector<plane> planes;
+	std::vector<line> lines;
+
+	mat4 projection;
+	mat4 viewProjection;
+	frustum camera;
+
+	std::vector<aabb> sceneBoxes;
+
+	std::vector<frustum> cameraPath;
+};
+
+// Output arrays
+struct bench_output
+{
+	bench_output(): r2(N), r3(N), r4(N), rf(N), ri(N), rm3(N), rm4(N), rq(N), rbox(N), rplane(N), rline(N), mask(BOX_COUNT / 32 + 1), indices(BOX_COUNT)
+	{
+	}
+
+	std::vector<vec2> r2;
+	std::vector<vec3> r3;
+	std::vector<vec4> r4;
+	std::vector<float> rf;
+	std::vector<int> ri;
+	std::vector<mat3> rm3;
+	std::vector<mat4> rm4;
+	std::vector<quat> rq;
+	std::vector<aabb> rbox;
+	std::vector<plane> rplane;
+	std::vector<line> rline;
+	std::vector<unsigned> mask;
+	std::vector<unsigned> indices;
+};
+
+/********************************************************************************/
+/*								Cases											*/
+/********************************************************************************/
+
+static void bench_fast_math(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	// Same inputs for libm and the approximations from fastmath.h
+	s.run("math", "sinf_cosf", N, [&]() { for(unsigned i = 0; i < N; i++) o.r2[i] = vec2(sinf(d.a3[i].x), cosf(d.a3[i].x)); bench_keep(o.r2); });
+	s.run("math", "fast_sincos", N, [&]() { for(unsigned i = 0; i < N; i++) fast_sincos(d.a3[i].x, o.r2[i].x, o.r2[i].y); bench_keep(o.r2); });
+	s.run("math", "acosf", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = acosf(d.t[i] * 2.0f - 1.0f); bench_keep(o.rf); });
+	s.run("math", "fast_acos", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = fast_acos(d.t[i] * 2.0f - 1.0f); bench_keep(o.rf); });
+	s.run("math", "div_sqrtf", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = 1.0f / sqrtf(d.f[i]); bench_keep(o.rf); });
+	s.run("math", "fast_rsqrt", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = fast_rsqrt(d.f[i]); bench_keep(o.rf); });
+}
+
+static void bench_vector(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	s.run("vec2", "add", N, [&]() { for(unsigned i = 0; i < N; i++) o.r2[i] = d.a2[i] + d.b2[i]; bench_keep(o.r2); });
+	s.run("vec2", "length", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = d.a2[i].length(); bench_keep(o.rf); });
+	s.run("vec2", "normalize", N, [&]() { for(unsigned i = 0; i < N; i++) o.r2[i] = normalize(d.a2[i]); bench_keep(o.r2); });
+	s.run("vec2", "dot", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = dot(d.a2[i], d.b2[i]); bench_keep(o.rf); });
+	s.run("vec2", "rotated", N, [&]() { for(unsigned i = 0; i < N; i++) o.r2[i] = d.a2[i].rotated(d.f[i]); bench_keep(o.r2); });
+
+	s.run("vec3", "add", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = d.a3[i] + d.b3[i]; bench_keep(o.r3); });
+	s.run("vec3", "mul_float", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = d.a3[i] * d.f[i]; bench_keep(o.r3); });
+	s.run("vec3", "length", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = d.a3[i].length(); bench_keep(o.rf); });
+	s.run("vec3", "normalize", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = normalize(d.a3[i]); bench_keep(o.r3); });
+	s.run("vec3", "dot", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = dot(d.a3[i], d.b3[i]); bench_keep(o.rf); });
+	s.run("vec3", "cross", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = cross(d.a3[i], d.b3[i]); bench_keep(o.r3); });
+	s.run("vec3", "saturate", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = saturate(d.a3[i]); bench_keep(o.r3); });
+	s.run("vec3", "pow", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = pow(d.a3[i] * d.a3[i], d.f[i]); bench_keep(o.r3); });
+	s.run("vec3", "triangle_normal", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = triangle_normal(d.a3[i], d.b3[i], d.c3[i]); bench_keep(o.r3); });
+	s.run("vec3", "triangle_area", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = triangle_area(d.a3[i], d.b3[i], d.c3[i]); bench_keep(o.rf); });
+	s.run("vec3", "vector_copy", N, [&]() { o.r3.assign(d.a3.begin(), d.a3.end()); bench_keep(o.r3); });
+
+	s.run("vec4", "add", N, [&]() { for(unsigned i = 0; i < N; i++) o.r4[i] = d.a4[i] + d.b4[i]; bench_keep(o.r4); });
+	s.run("vec4", "mul", N, [&]() { for(unsigned i = 0; i < N; i++) o.r4[i] = d.a4[i] * d.b4[i]; bench_keep(o.r4); });
+	s.run("vec4", "length", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = d.a4[i].length(); bench_keep(o.rf); });
+	s.run("vec4", "normalize", N, [&]() { for(unsigned i = 0; i < N; i++) o.r4[i] = normalize(d.a4[i]); bench_keep(o.r4); });
+	s.run("vec4", "dot", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = dot(d.a4[i], d.b4[i]); bench_keep(o.rf); });
+	s.run("vec4", "saturate", N, [&]() { for(unsigned i = 0; i < N; i++) o.r4[i] = saturate(d.a4[i]); bench_keep(o.r4); });
+}
+
+static void bench_matrix(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	s.run("mat3", "mul_vec3", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = d.m3[i] * d.a3[i]; bench_keep(o.r3); });
+	s.run("mat3", "mul_mat3", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm3[i] = d.m3[i] * d.m3[N - 1 - i]; bench_keep(o.rm3); });
+	s.run("mat3", "transpose", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm3[i] = d.m3[i].transpose(); bench_keep(o.rm3); });
+	s.run("mat3", "det", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = d.m3[i].det(); bench_keep(o.rf); });
+	s.run("mat3", "inverse", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm3[i] = d.m3[i].inverse(); bench_keep(o.rm3); });
+	s.run("mat3", "rotate", N, [&]() { for(unsigned i = 0; i < N; i++) { o.rm3[i] = d.m3[i]; o.rm3[i].rotate(d.b3[i], d.f[i]); } bench_keep(o.rm3); });
+	s.run("mat3", "orthonormalize", N, [&]() { for(unsigned i = 0; i < N; i++) { o.rm3[i] = d.m3[i]; o.rm3[i].orthonormalize(); } bench_keep(o.rm3); });
+
+	s.run("mat4", "mul_vec3", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = d.m4[i] * d.a3[i]; bench_keep(o.r3); });
+	s.run("mat4", "mul_vec4", N, [&]() { for(unsigned i = 0; i < N; i++) o.r4[i] = d.m4[i] * d.a4[i]; bench_keep(o.r4); });
+	s.run("mat4", "mul_mat4", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm4[i] = d.m4[i] * d.m4[N - 1 - i]; bench_keep(o.rm4); });
+	s.run("mat4", "add", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm4[i] = d.m4[i] + d.m4[N - 1 - i]; bench_keep(o.rm4); });
+	s.run("mat4", "transpose", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm4[i] = d.m4[i].transpose(); bench_keep(o.rm4); });
+	s.run("mat4", "transpose_rotation", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm4[i] = d.m4[i].transpose_rotation(); bench_keep(o.rm4); });
+	s.run("mat4", "det", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = d.m4[i].det(); bench_keep(o.rf); });
+	s.run("mat4", "inverse", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm4[i] = d.m4[i].inverse(); bench_keep(o.rm4); });
+	s.run("mat4", "inverse_affine", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm4[i] = d.affine[i].inverse_affine(); bench_keep(o.rm4); });
+	s.run("mat4", "inverse_rigid", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm4[i] = d.rigid[i].inverse_rigid(); bench_keep(o.rm4); });
+	s.run("mat4", "rotate", N, [&]() { for(unsigned i = 0; i < N; i++) { o.rm4[i] = d.m4[i]; o.rm4[i].rotate(d.b3[i], d.f[i]); } bench_keep(o.rm4); });
+	s.run("mat4", "translate", N, [&]() { for(unsigned i = 0; i < N; i++) { o.rm4[i] = d.m4[i]; o.rm4[i].translate(d.b3[i]); } bench_keep(o.rm4); });
+	s.run("mat4", "normalize_rotation", N, [&]() { for(unsigned i = 0; i < N; i++) { o.rm4[i] = d.affine[i]; o.rm4[i].normalize_rotation(); } bench_keep(o.rm4); });
+	s.run("mat4", "look_at", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm4[i].look_at(d.a3[i], d.b3[i], vec3(0, 0, 1)); bench_keep(o.rm4); });
+	s.run("mat4", "perspective_rh", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm4[i].perspective_rh(60.0f, d.f[i], 0.1f, 100.0f); bench_keep(o.rm4); });
+	s.run("mat4", "mul_m4_v3", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = mul_m4_v3(d.m4[i], d.a3[i]); bench_keep(o.r3); });
+	s.run("mat4", "project_vector", N, [&]() { for(unsigned i = 0; i < N; i++) o.r4[i] = project_vector(d.viewProjection, d.a4[i]); bench_keep(o.r4); });
+
+	// Batch functions, a single matrix is applied to all elements
+	s.run("mat4", "transform_points_loop", N, [&]() { const mat4 &m = d.affine[0]; for(unsigned i = 0; i < N; i++) o.r3[i] = m * d.a3[i]; bench_keep(o.r3); });
+	s.run("mat4", "transform_points", N, [&]() { transform_points(&o.r3[0], &d.a3[0], N, d.affine[0]); bench_keep(o.r3); });
+	s.run("mat4", "transform_directions", N, [&]() { transform_directions(&o.r3[0], &d.a3[0], N, d.affine[0]); bench_keep(o.r3); });
+	s.run("mat4", "project_points", N, [&]() { project_points(&o.r3[0], &d.a3[0], N, d.viewProjection); bench_keep(o.r3); });
+	s.run("mat4", "inverse_batch", N, [&]() { inverse(&o.rm4[0], &d.m4[0], N); bench_keep(o.rm4); });
+	s.run("mat4", "inverse_affine_batch", N, [&]() { inverse_affine(&o.rm4[0], &d.affine[0], N); bench_keep(o.rm4); });
+	s.run("mat4", "inverse_rigid_batch", N, [&]() { inverse_rigid(&o.rm4[0], &d.rigid[0], N); bench_keep(o.rm4); });
+
+	// Containers copy and relocate trivially copyable elements with memmove
+	s.run("mat4", "vector_copy", N, [&]() { o.rm4.assign(d.m4.begin(), d.m4.end()); bench_keep(o.rm4); });
+	s.run("mat4", "vector_grow", N, [&]() { std::vector<mat4> v; for(unsigned i = 0; i < N; i++) v.push_back(d.m4[i]); o.rm4[0] = v.back(); bench_keep(o.rm4); });
+}
+
+// Same inputs as the mat4 cases with 'affine' and 'rigid' matrices
+static void bench_affine(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	std::vector<affine3x4> affine(N), rigid(N), ra(N);
+
+	for(unsigned i = 0; i < N; i++)
+	{
+		affine[i] = affine3x4(d.affine[i]);
+		rigid[i] = affine3x4(d.rigid[i]);
+	}
+
+	s.run("affine3x4", "mul", N, [&]() { for(unsigned i = 0; i < N; i++) ra[i] = affine[i] * affine[N - 1 - i]; bench_keep(ra); });
+	s.run("affine3x4", "mul_mat4", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm4[i] = d.affine[i] * d.affine[N - 1 - i]; bench_keep(o.rm4); });
+	s.run("affine3x4", "transform_point", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = affine[i].transform_point(d.a3[i]); bench_keep(o.r3); });
+	s.run("affine3x4", "transform_point_mat4", N, [&]() { for(unsigned i = 0; i < N; i++) mul_m4_v3_trans(o.r3[i], d.a3[i], d.affine[i]); bench_keep(o.r3); });
+	s.run("affine3x4", "transform_aabb", N, [&]() { for(unsigned i = 0; i < N; i++) o.rbox[i] = affine[i].transform_aabb(d.boxes[i]); bench_keep(o.rbox); });
+	s.run("affine3x4", "transform_aabb_mat4", N, [&]() { for(unsigned i = 0; i < N; i++) { o.rbox[i] = d.boxes[i]; o.rbox[i].mul(d.affine[i]); } bench_keep(o.rbox); });
+	s.run("affine3x4", "inverse", N, [&]() { for(unsigned i = 0; i < N; i++) ra[i] = affine[i].inverse(); bench_keep(ra); });
+	s.run("affine3x4", "inverse_mat4", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm4[i] = d.affine[i].inverse_affine(); bench_keep(o.rm4); });
+	s.run("affine3x4", "inverse_rigid", N, [&]() { for(unsigned i = 0; i < N; i++) ra[i] = rigid[i].inverse_rigid(); bench_keep(ra); });
+	s.run("affine3x4", "inverse_rigid_mat4", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm4[i] = d.rigid[i].inverse_rigid(); bench_keep(o.rm4); });
+	s.run("affine3x4", "from_mat4", N, [&]() { for(unsigned i = 0; i < N; i++) ra[i] = affine3x4(d.affine[i]); bench_keep(ra); });
+	s.run("affine3x4", "to_mat4", N, [&]() { to_mat4(&o.rm4[0], &affine[0], N); bench_keep(o.rm4); });
+
+	// Batch functions
+	s.run("affine3x4", "mul_batch", N, [&]() { mul(&ra[0], &affine[0], &rigid[0], N); bench_keep(ra); });
+	s.run("affine3x4", "inverse_batch", N, [&]() { inverse(&ra[0], &affine[0], N); bench_keep(ra); });
+	s.run("affine3x4", "inverse_rigid_batch", N, [&]() { inverse_rigid(&ra[0], &rigid[0], N); bench_keep(ra); });
+	s.run("affine3x4", "transform_aabbs_batch", N, [&]() { transform_aabbs(&o.rbox[0], &d.boxes[0], &affine[0], N); bench_keep(o.rbox); });
+
+	// Composition of transforms that don't fit in the cache, the affine version reads and writes 25% less memory
+	std::vector<affine3x4> parents(TRANSFORM_COUNT), locals(TRANSFORM_COUNT), worlds(TRANSFORM_COUNT);
+	std::vector<mat4> parents4(TRANSFORM_COUNT), locals4(TRANSFORM_COUNT), worlds4(TRANSFORM_COUNT);
+
+	for(unsigned i = 0; i < TRANSFORM_COUNT; i++)
+	{
+		parents4[i] = d.rigid[i % N];
+		locals4[i] = d.affine[(i * 7) % N];
+
+		parents[i] = affine3x4(parents4[i]);
+		locals[i] = affine3x4(locals4[i]);
+	}
+
+	s.run("affine3x4", "mul_batch_100k", TRANSFORM_COUNT, [&]() { mul(&worlds[0], &parents[0], &locals[0], TRANSFORM_COUNT); bench_keep(worlds); });
+	s.run("affine3x4", "mul_batch_100k_mat4", TRANSFORM_COUNT, [&]() { for(unsigned i = 0; i < TRANSFORM_COUNT; i++) mul(worlds4[i], parents4[i], locals4[i]); bench_keep(worlds4); });
+}
+
+// Local transforms sampled from an animation, converted with the mat4 functions in the reference cases
+static void bench_transform(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	std::vector<transform> ta(N), tb(N), rt(N);
+	std::vector<affine3x4> ra(N);
+
+	for(unsigned i = 0; i < N; i++)
+	{
+		float scale = d.f[i];
+
+		ta[i] = transform(d.a3[i], d.qa[i], vec3(scale, scale, scale));
+		tb[i] = transform(d.b3[i], d.qb[i], vec3(d.f[N - 1 - i], scale, 1.0f));
+	}
+
+	s.run("transform", "to_matrix", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm4[i] = ta[i].to_matrix(); bench_keep(o.rm4); });
+	s.run("transform", "to_matrix_mat4", N, [&]() { for(unsigned i = 0; i < N; i++) { mat4 m; m.translate(ta[i].translation); m *= mat4(ta[i].rotation.to_matrix()); m.scale(ta[i].scale); o.rm4[i] = m; } bench_keep(o.rm4); });
+	s.run("transform", "to_affine", N, [&]() { for(unsigned i = 0; i < N; i++) ra[i] = ta[i].to_affine(); bench_keep(ra); });
+	s.run("transform", "mul", N, [&]() { for(unsigned i = 0; i < N; i++) rt[i] = ta[i] * tb[i]; bench_keep(rt); });
+	s.run("transform", "mul_mat4", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm4[i] = ta[i].to_matrix() * tb[i].to_matrix(); bench_keep(o.rm4); });
+	s.run("transform", "inverse", N, [&]() { for(unsigned i = 0; i < N; i++) rt[i] = ta[i].inverse(); bench_keep(rt); });
+	s.run("transform", "transform_point", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = ta[i].transform_point(d.c3[i]); bench_keep(o.r3); });
+	s.run("transform", "interpolate", N, [&]() { for(unsigned i = 0; i < N; i++) rt[i].interpolate(ta[i], tb[i], d.t[i]); bench_keep(rt); });
+
+	// Batch functions
+	s.run("transform", "to_matrix_batch", N, [&]() { to_matrix(&o.rm4[0], &ta[0], N); bench_keep(o.rm4); });
+	s.run("transform", "to_affine_batch", N, [&]() { to_matrix(&ra[0], &ta[0], N); bench_keep(ra); });
+}
+
+static void bench_quat(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	s.run("quat", "mul", N, [&]() { for(unsigned i = 0; i < N; i++) o.rq[i] = d.qa[i] * d.qb[i]; bench_keep(o.rq); });
+	s.run("quat", "dot", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = dot(d.qa[i], d.qb[i]); bench_keep(o.rf); });
+	s.run("quat", "from_mat3", N, [&]() { for(unsigned i = 0; i < N; i++) o.rq[i] = quat(d.m3[i]); bench_keep(o.rq); });
+	s.run("quat", "to_matrix", N, [&]() { for(unsigned i = 0; i < N; i++) o.rm3[i] = d.qa[i].to_matrix(); bench_keep(o.rm3); });
+	s.run("quat", "set_axis_angle", N, [&]() { for(unsigned i = 0; i < N; i++) o.rq[i].set(d.b3[i], d.f[i]); bench_keep(o.rq); });
+	s.run("quat", "set_from_direction", N, [&]() { for(unsigned i = 0; i < N; i++) o.rq[i].set_from_direction(d.a3[i], d.b3[i]); bench_keep(o.rq); });
+	s.run("quat", "normalize", N, [&]() { for(unsigned i = 0; i < N; i++) { o.rq[i] = d.qa[i]; o.rq[i].normalize(); } bench_keep(o.rq); });
+	s.run("quat", "transform_vector", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = d.qa[i].transform_vector(d.a3[i]); bench_keep(o.r3); });
+	s.run("quat", "slerp", N, [&]() { for(unsigned i = 0; i < N; i++) o.rq[i].slerp(d.qa[i], d.qb[i], d.t[i]); bench_keep(o.rq); });
+	s.run("quat", "slerp_batch", N, [&]() { slerp(&o.rq[0], &d.qa[0], &d.qb[0], &d.t[0], N); bench_keep(o.rq); });
+	s.run("quat", "slerp_fast_batch", N, [&]() { slerp_fast(&o.rq[0], &d.qa[0], &d.qb[0], &d.t[0], N); bench_keep(o.rq); });
+	s.run("quat", "nlerp_batch", N, [&]() { nlerp(&o.rq[0], &d.qa[0], &d.qb[0], &d.t[0], N); bench_keep(o.rq); });
+}
+
+static void bench_plane(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	s.run("plane", "from_triangle", N, [&]() { for(unsigned i = 0; i < N; i++) o.rplane[i].from_triangle(d.a3[i], d.b3[i], d.c3[i]); bench_keep(o.rplane); });
+	s.run("plane", "normalize", N, [&]() { for(unsigned i = 0; i < N; i++) { o.rplane[i] = plane(d.a4[i]); o.rplane[i].normalize(); } bench_keep(o.rplane); });
+	s.run("plane", "distance", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = dot(d.a3[i], d.planes[i].pl); bench_keep(o.rf); });
+	s.run("plane", "angle_between_planes", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = angle_between_planes(d.planes[i], d.planes[N - 1 - i]); bench_keep(o.rf); });
+
+	s.run("line", "construct", N, [&]() { for(unsigned i = 0; i < N; i++) o.rline[i] = line(d.a3[i], d.b3[i]); bench_keep(o.rline); });
+	s.run("line", "distance_from_point", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = distance_from_point(d.lines[i], d.a3[i]); bench_keep(o.rf); });
+	s.run("line", "distance_from_segment_to_point", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = distance_from_segment_to_point(d.a2[i], d.b2[i], d.c2[i]); bench_keep(o.rf); });
+	s.run("line", "project_point_on_line", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = project_point_on_line(d.lines[i], d.a3[i]); bench_keep(o.r3); });
+	s.run("line", "distance_from_line", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = distance_from_line(d.lines[i], d.lines[N - 1 - i]); bench_keep(o.rf); });
+	s.run("line", "angle_between_lines", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = angle_between_lines(d.lines[i], d.lines[N - 1 - i]); bench_keep(o.rf); });
+	s.run("line", "line_intersects_line_2d", N, [&]() { for(unsigned i = 0; i < N; i++) o.ri[i] = line_intersects_line_2d(d.a2[i].x, d.a2[i].y, d.b2[i].x, d.b2[i].y, d.c2[i].x, d.c2[i].y, d.a2[N - 1 - i].x, d.a2[N - 1 - i].y); bench_keep(o.ri); });
+	s.run("line", "line_intersects_aabb", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = line_intersects_aabb(d.lines[i], d.boxes[N - 1 - i]); bench_keep(o.rf); });
+	s.run("line", "line_intersect_triangle_distance", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = line_intersect_triangle_distance(d.lines[i], d.a3[i], d.b3[N - 1 - i], d.c3[i]); bench_keep(o.rf); });
+	s.run("line", "line_intersects_triangle", N, [&]() { for(unsigned i = 0; i < N; i++) o.ri[i] = line_intersects_triangle(d.lines[i], d.a3[i], d.b3[N - 1 - i], d.c3[i]); bench_keep(o.ri); });
+	s.run("line", "line_intersects_triangle_2d", N, [&]() { for(unsigned i = 0; i < N; i++) o.ri[i] = line_intersects_triangle(d.lines[i], d.a2[i], d.b2[i], d.c2[i]); bench_keep(o.ri); });
+	s.run("line", "unproject_ray", N, [&]() { mat4 m = d.viewProjection.inverse(); for(unsigned i = 0; i < N; i++) o.rline[i] = unproject_ray(m, d.a2[i] * 0.1f); bench_keep(o.rline); });
+
+	// Same lines and triangles as in the scalar case, packed once outside of the measured loops
+	// Packets are kept in arrays on the stack, std::vector doesn't align the AVX lanes before C++17
+	std::vector<vec3> reversed(d.b3.rbegin(), d.b3.rend());
+	linex4 lines4[N / 4];
+	trianglex4 triangles4[N / 4];
+	linex8 lines8[N / 8];
+	trianglex8 triangles8[N / 8];
+
+	for(unsigned i = 0; i < N / 4; i++)
+	{
+		lines4[i] = linex4::load(&d.lines[i * 4]);
+		triangles4[i] = trianglex4::load(&d.a3[i * 4], &reversed[i * 4], &d.c3[i * 4]);
+	}
+
+	for(unsigned i = 0; i < N / 8; i++)
+	{
+		lines8[i] = linex8::load(&d.lines[i * 8]);
+		triangles8[i] = trianglex8::load(&d.a3[i * 8], &reversed[i * 8], &d.c3[i * 8]);
+	}
+
+	s.run("line", "line_intersect_triangle_distance_x4", N, [&]() {
+		for(unsigned i = 0; i < N / 4; i++)
+		{
+			floatx4 distance, u, v;
+			o.ri[i] = line_intersect_triangle_distance(lines4[i], triangles4[i], distance, u, v);
+			distance.store(&o.rf[i * 4]);
+		}
+		bench_keep(o.rf);
+	});
+	s.run("line", "line_intersect_triangle_distance_x8", N, [&]() {
+		for(unsigned i = 0; i < N / 8; i++)
+		{
+			floatx8 distance, u, v;
+			o.ri[i] = line_intersect_triangle_distance(lines8[i], triangles8[i], distance, u, v);
+			distance.store(&o.rf[i * 8]);
+		}
+		bench_keep(o.rf);
+	});
+}
+
+static void bench_aabb(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	s.run("aabb", "merge", N, [&]() { for(unsigned i = 0; i < N; i++) { o.rbox[i] = d.boxes[i]; o.rbox[i].merge(d.boxes[N - 1 - i]); } bench_keep(o.rbox); });
+	s.run("aabb", "mul", N, [&]() { for(unsigned i = 0; i < N; i++) { o.rbox[i] = d.boxes[i]; o.rbox[i].mul(d.affine[i]); } bench_keep(o.rbox); });
+	s.run("aabb", "radius", N, [&]() { for(unsigned i = 0; i < N; i++) o.rf[i] = d.boxes[i].radius(); bench_keep(o.rf); });
+}
+
+static void bench_frustum(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	frustum f = d.camera;
+
+	s.run("frustum", "calculate_planes", 1, [&]() { f.calculate_planes(d.viewProjection); bench_keep(f); });
+	s.run("frustum", "calculate_points", 1, [&]() { f.calculate_points(d.viewProjection); bench_keep(f); });
+
+	f = d.camera;
+
+	s.run("frustum", "point_inside", N, [&]() { for(unsigned i = 0; i < N; i++) o.ri[i] = f.point_inside(d.a3[i]); bench_keep(o.ri); });
+	s.run("frustum", "sphere_inside", N, [&]() { for(unsigned i = 0; i < N; i++) o.ri[i] = f.sphere_inside(d.a3[i], d.f[i]); bench_keep(o.ri); });
+	s.run("frustum", "aabb_inside", N, [&]() { for(unsigned i = 0; i < N; i++) o.ri[i] = f.aabb_inside(d.boxes[i]); bench_keep(o.ri); });
+	s.run("frustum", "aabb_inside_radius", N, [&]() { for(unsigned i = 0; i < N; i++) o.ri[i] = f.aabb_inside_radius(d.boxes[i]); bench_keep(o.ri); });
+	s.run("frustum", "sphere_classify", N, [&]() { for(unsigned i = 0; i < N; i++) { unsigned mask = frustum::PLANE_MASK_ALL; o.ri[i] = f.sphere_classify(d.a3[i], d.f[i], mask); } bench_keep(o.ri); });
+	s.run("frustum", "aabb_classify", N, [&]() { for(unsigned i = 0; i < N; i++) { unsigned mask = frustum::PLANE_MASK_ALL; o.ri[i] = f.aabb_classify(d.boxes[i], mask); } bench_keep(o.ri); });
+
+	// Culling of a scene that doesn't fit in the cache
+	const aabb *boxes = &d.sceneBoxes[0];
+
+	s.run("frustum", "cull_500k_aabb_inside", BOX_COUNT, [&]() { unsigned count = 0; for(unsigned i = 0; i < BOX_COUNT; i++) if(f.aabb_inside(boxes[i])) o.indices[count++] = i; bench_keep(o.indices); });
+	s.run("frustum", "cull_500k_aabb_inside_mask", BOX_COUNT, [&]() { f.aabb_inside_mask(boxes, BOX_COUNT, &o.mask[0]); bench_keep(o.mask); });
+	s.run("frustum", "cull_500k_aabb_inside_indices", BOX_COUNT, [&]() { f.aabb_inside_indices(boxes, BOX_COUNT, &o.indices[0]); bench_keep(o.indices); });
+
+	// Camera path replay, each call culls the scene for the next frame, cached variants keep the last rejecting plane of each box
+	std::vector<unsigned char> lastPlane(PATH_BOX_COUNT, 0);
+	std::vector<float> radius(PATH_BOX_COUNT);
+
+	for(unsigned i = 0; i < PATH_BOX_COUNT; i++)
+		radius[i] = boxes[i].radius();
+
+	unsigned frame = 0;
+
+	s.run("frustum", "camera_path_50k_sphere_inside", PATH_BOX_COUNT, [&]() {
+		frustum pf = d.cameraPath[frame++ % PATH_FRAMES];
+		unsigned count = 0; for(unsigned i = 0; i < PATH_BOX_COUNT; i++) if(pf.sphere_inside(boxes[i].center, radius[i])) o.indices[count++] = i; bench_keep(o.indices);
+	});
+	s.run("frustum", "camera_path_50k_sphere_inside_cached", PATH_BOX_COUNT, [&]() {
+		frustum pf = d.cameraPath[frame++ % PATH_FRAMES];
+		unsigned count = 0; for(unsigned i = 0; i < PATH_BOX_COUNT; i++) if(pf.sphere_inside(boxes[i].center, radius[i], lastPlane[i])) o.indices[count++] = i; bench_keep(o.indices);
+	});
+	s.run("frustum", "camera_path_50k_aabb_inside", PATH_BOX_COUNT, [&]() {
+		frustum pf = d.cameraPath[frame++ % PATH_FRAMES];
+		unsigned count = 0; for(unsigned i = 0; i < PATH_BOX_COUNT; i++) if(pf.aabb_inside(boxes[i])) o.indices[count++] = i; bench_keep(o.indices);
+	});
+	s.run("frustum", "camera_path_50k_aabb_inside_cached", PATH_BOX_COUNT, [&]() {
+		frustum pf = d.cameraPath[frame++ % PATH_FRAMES];
+		unsigned count = 0; for(unsigned i = 0; i < PATH_BOX_COUNT; i++) if(pf.aabb_inside(boxes[i], lastPlane[i])) o.indices[count++] = i; bench_keep(o.indices);
+	});
+	s.run("frustum", "camera_path_50k_aabb_inside_radius", PATH_BOX_COUNT, [&]() {
+		frustum pf = d.cameraPath[frame++ % PATH_FRAMES];
+		unsigned count = 0; for(unsigned i = 0; i < PATH_BOX_COUNT; i++) if(pf.aabb_inside_radius(boxes[i])) o.indices[count++] = i; bench_keep(o.indices);
+	});
+	s.run("frustum", "camera_path_50k_aabb_inside_radius_cached", PATH_BOX_COUNT, [&]() {
+		frustum pf = d.cameraPath[frame++ % PATH_FRAMES];
+		unsigned count = 0; for(unsigned i = 0; i < PATH_BOX_COUNT; i++) if(pf.aabb_inside_radius(boxes[i], lastPlane[i])) o.indices[count++] = i; bench_keep(o.indices);
+	});
+}
+
+static void bench_bvh(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	// Scene boxes and a triangle soup made of the input vectors
+	bvh sceneTree;
+	sceneTree.build(&d.sceneBoxes[0], 50000);
+
+	std::vector<vec3> triangles(N * 3);
+
+	for(unsigned i = 0; i < N; i++)
+	{
+		triangles[i * 3] = d.a3[i];
+		triangles[i * 3 + 1] = d.a3[i] + (d.b3[i] - d.a3[i]) * 0.1f;
+		triangles[i * 3 + 2] = d.a3[i] + (d.c3[i] - d.a3[i]) * 0.1f;
+	}
+
+	bvh triangleTree;
+	triangleTree.build(&triangles[0], N);
+
+	std::vector<unsigned> visible;
+	visible.reserve(50000);
+
+	unsigned frame = 0;
+
+	s.run("bvh", "build_50k_aabb", 50000, [&]() { bvh tree; tree.build(&d.sceneBoxes[0], 50000); bench_keep(tree.nodes); });
+	s.run("bvh", "ray_nearest_1k_triangles", N, [&]() { for(unsigned i = 0; i < N; i++) { float distance; o.ri[i] = triangleTree.ray_nearest(d.lines[i], distance); } bench_keep(o.ri); });
+	s.run("bvh", "ray_any_1k_triangles", N, [&]() { for(unsigned i = 0; i < N; i++) o.ri[i] = triangleTree.ray_any(d.lines[i]); bench_keep(o.ri); });
+	s.run("bvh", "frustum_overlap_50k_aabb", 50000, [&]() { visible.clear(); sceneTree.frustum_overlap(d.camera, visible); bench_keep(visible); });
+	s.run("bvh", "camera_path_frustum_overlap_50k_aabb", 50000, [&]() { visible.clear(); sceneTree.frustum_overlap(d.cameraPath[frame++ % PATH_FRAMES], visible); bench_keep(visible); });
+	s.run("bvh", "aabb_overlap_50k_aabb", N, [&]() { for(unsigned i = 0; i < N; i++) { visible.clear(); sceneTree.aabb_overlap(aabb(d.a3[i] * 50.0f, vec3(20.0f)), visible); o.ri[i] = int(visible.size()); } bench_keep(o.ri); });
+}
+
+static void bench_octree(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	// Scenes with the same density as the scene boxes, culled with the camera in the middle
+	const unsigned counts[] = { 10000, 100000, 1000000 };
+	const char *names[] = { "10k", "100k", "1m" };
+
+	bench_random rng(23);
+
+	std::vector<aabb> objects(counts[2]);
+
+	for(unsigned i = 0; i < counts[2]; i++)
+	{
+		vec3 center(rng.uniform(-500.0f, 500.0f), rng.uniform(-500.0f, 500.0f), rng.uniform(-50.0f, 50.0f));
+
+		objects[i] = aabb(center, vec3(rng.uniform(0.5f, 5.0f), rng.uniform(0.5f, 5.0f), rng.uniform(0.5f, 5.0f)));
+	}
+
+	std::vector<unsigned> visible;
+	visible.reserve(counts[2]);
+
+	for(unsigned k = 0; k < 3; k++)
+	{
+		unsigned count = counts[k];
+
+		// Scene size grows with the object count
+		float scale = sqrtf(float(count) / float(counts[2]));
+
+		std::vector<aabb> scene(objects.begin(), objects.begin() + count);
+
+		for(unsigned i = 0; i < count; i++)
+			scene[i].center = vec3(scene[i].center.x * scale, scene[i].center.y * scale, scene[i].center.z);
+
+		// Nodes at depth 6 of the largest scene are about 4 times larger than the objects
+		octree tree(aabb(vec3(0.0f), vec3(500.0f * scale, 500.0f * scale, 50.0f)), 6);
+
+		for(unsigned i = 0; i < count; i++)
+			tree.insert(scene[i]);
+
+		std::string suffix = std::string("_") + names[k];
+
+		s.run("octree", ("frustum_overlap" + suffix).c_str(), count, [&]() { visible.clear(); tree.frustum_overlap(d.camera, visible); bench_keep(visible); });
+		s.run("octree", ("brute_force_aabb_inside_radius" + suffix).c_str(), count, [&]() { visible.clear(); for(unsigned i = 0; i < count; i++) if(d.camera.aabb_inside_radius(scene[i])) visible.push_back(i); bench_keep(visible); });
+		s.run("octree", ("brute_force_aabb_inside_indices" + suffix).c_str(), count, [&]() { visible.resize(count); visible.resize(d.camera.aabb_inside_indices(&scene[0], count, &visible[0])); bench_keep(visible); });
+
+		s.run("octree", ("aabb_overlap" + suffix).c_str(), N, [&]() { for(unsigned i = 0; i < N; i++) { visible.clear(); tree.aabb_overlap(aabb(d.a3[i] * 50.0f * scale, vec3(20.0f)), visible); } bench_keep(visible); });
+		s.run("octree", ("ray_nearest" + suffix).c_str(), N, [&]() { for(unsigned i = 0; i < N; i++) { float distance; line l = d.lines[i]; l.p = l.p * 50.0f * scale; o.ri[i] = tree.ray_nearest(l, distance, 200.0f); } bench_keep(o.ri); });
+
+		if(k != 1)
+			continue;
+
+		// Small moves mostly stay in the same node
+		float step = 0.5f;
+
+		s.run("octree", ("move" + suffix).c_str(), count, [&]() { step = -step; for(unsigned i = 0; i < count; i++) tree.move(i, aabb(tree.bounds(i).center + vec3(step, step * 0.5f, 0.0f), tree.bounds(i).size)); bench_keep(tree.nodes); });
+		s.run("octree", ("remove_insert" + suffix).c_str(), count, [&]() { for(unsigned i = 0; i < count; i++) { aabb box = tree.bounds(i); tree.remove(i); tree.insert(box); } bench_keep(tree.nodes); });
+	}
+}
+
+static void bench_aabb_tree(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	// Moving objects, each call advances them by one frame, the direction flips every 32 frames so they stay in place
+	const unsigned count = 200000;
+
+	std::vector<aabb> objects(d.sceneBoxes.begin(), d.sceneBoxes.begin() + count);
+	std::vector<vec3> velocity(count);
+
+	bench_random rng(29);
+
+	for(unsigned i = 0; i < count; i++)
+		velocity[i] = vec3(rng.uniform(-0.05f, 0.05f), rng.uniform(-0.05f, 0.05f), rng.uniform(-0.01f, 0.01f));
+
+	aabb_tree tree;
+	std::vector<unsigned> handles(count);
+
+	for(unsigned i = 0; i < count; i++)
+		handles[i] = tree.insert(objects[i], i);
+
+	std::vector<unsigned> visible;
+	visible.reserve(count);
+
+	std::vector<aabb_tree_pair> pairs;
+
+	unsigned frame = 0;
+
+	s.run("aabb_tree", "insert_200k", count, [&]() { aabb_tree t; for(unsigned i = 0; i < count; i++) t.insert(objects[i], i); bench_keep(t.nodes); });
+	s.run("aabb_tree", "move_200k", count, [&]() {
+		float direction = (frame++ & 32) ? -1.0f : 1.0f;
+		for(unsigned i = 0; i < count; i++)
+		{
+			objects[i].center += velocity[i] * direction;
+			tree.move(handles[i], objects[i], velocity[i] * direction);
+		}
+		bench_keep(tree.nodes);
+	});
+	s.run("aabb_tree", "bvh_build_200k", count, [&]() { bvh t; t.build(&objects[0], count); bench_keep(t.nodes); });
+	s.run("aabb_tree", "frustum_overlap_200k", count, [&]() { visible.clear(); tree.frustum_overlap(d.camera, visible); bench_keep(visible); });
+	s.run("aabb_tree", "self_pairs_200k", count, [&]() { pairs.clear(); tree.pair_overlap(tree, pairs); bench_keep(pairs); });
+	s.run("aabb_tree", "ray_nearest_200k", N, [&]() { for(unsigned i = 0; i < N; i++) { float distance; line l = d.lines[i]; l.p = l.p * 50.0f; o.ri[i] = tree.ray_nearest(l, distance, 200.0f); } bench_keep(o.ri); });
+}
+
+// Random tree with 64 roots, the parent of a node is any of the previous nodes, depth is 8.5 on average
+static void build_bench_hierarchy(transform_hierarchy& h, const bench_data& d)
+{
+	bench_random rng(29);
+
+	h.reserve(HIERARCHY_COUNT);
+
+	for(unsigned i = 0; i < HIERARCHY_COUNT; i++)
+		h.add(i < 64 ? ~0u : rng.next() % i, d.affine[i % N], d.boxes[i % N]);
+
+	h.update();
+}
+
+static void bench_hierarchy(bench_suite& s, const bench_data& d)
+{
+	transform_hierarchy h;
+	build_bench_hierarchy(h, d);
+
+	std::vector<mat4> world(HIERARCHY_COUNT);
+	std::vector<aabb> worldBounds(HIERARCHY_COUNT);
+
+	// 1% of the nodes move, together with their descendants that is 6% of the tree
+	bench_random rng(31);
+
+	std::vector<unsigned> moved(HIERARCHY_COUNT / 100);
+
+	for(unsigned i = 0; i < moved.size(); i++)
+		moved[i] = rng.next() % HIERARCHY_COUNT;
+
+	s.run("hierarchy", "compose_300k_loop", HIERARCHY_COUNT, [&]()
+	{
+		for(unsigned i = 0; i < HIERARCHY_COUNT; i++)
+		{
+			unsigned parent = h.parents[i];
+
+			world[i] = parent == ~0u ? h.local[i] : world[parent] * h.local[i];
+
+			worldBounds[i] = h.localBounds[i];
+			worldBounds[i].mul(world[i]);
+		}
+
+		bench_keep(world);
+		bench_keep(worldBounds);
+	});
+
+	s.run("hierarchy", "update_300k_all", HIERARCHY_COUNT, [&]() { for(unsigned i = 0; i < 64; i++) h.mark_dirty(i); h.update(); bench_keep(h.world); });
+	s.run("hierarchy", "update_300k_moved_1pct", HIERARCHY_COUNT, [&]() { for(unsigned i = 0; i < moved.size(); i++) h.set_local(moved[i], h.local[moved[i]]); h.update(); bench_keep(h.world); });
+}
+
+// Crowd of characters skinned from one palette, vertices of a character use the 64 joints of that character
+struct bench_crowd
+{
+	bench_crowd(const bench_data& d): sourcePositions(CROWD_VERTEX_COUNT), sourceNormals(CROWD_VERTEX_COUNT), positions(CROWD_VERTEX_COUNT), normals(CROWD_VERTEX_COUNT),
+		joints(CROWD_VERTEX_COUNT * 4), weights(CROWD_VERTEX_COUNT * 4, 0.25f), palette(CROWD_JOINT_COUNT), dualPalette(CROWD_JOINT_COUNT)
+	{
+		bench_random rng(41);
+
+		for(unsigned i = 0; i < CROWD_JOINT_COUNT; i++)
+		{
+			const mat4 &m = d.rigid[i % SKIN_JOINT_COUNT];
+
+			palette[i] = m;
+			dualPalette[i] = dualquat(d.qa[i % SKIN_JOINT_COUNT], vec3(m.mat[12], m.mat[13], m.mat[14]));
+		}
+
+		for(unsigned i = 0; i < CROWD_VERTEX_COUNT; i++)
+		{
+			sourcePositions[i] = d.a3[i % N];
+			sourceNormals[i] = d.normals[i % N];
+
+			unsigned character = (i / 1024) * 97 % (CROWD_JOINT_COUNT / SKIN_JOINT_COUNT);
+
+			for(unsigned k = 0; k < 4; k++)
+				joints[i * 4 + k] = (unsigned short)(character * SKIN_JOINT_COUNT + rng.next() % SKIN_JOINT_COUNT);
+		}
+	}
+
+	std::vector<vec3> sourcePositions, sourceNormals;
+	std::vector<vec3> positions, normals;
+	std::vector<unsigned short> joints;
+	std::vector<float> weights;
+	std::vector<mat4> palette;
+	std::vector<dualquat> dualPalette;
+};
+
+static void bench_jobs(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	// Scaling of the parallel batch operations, thread counts above the hardware thread count are skipped
+	std::vector<vec3> points(BOX_COUNT);
+	std::vector<vec3> transformed(BOX_COUNT);
+	std::vector<aabb> transformedBoxes(BOX_COUNT);
+
+	for(unsigned i = 0; i < BOX_COUNT; i++)
+		points[i] = d.sceneBoxes[i].center;
+
+	const aabb *boxes = &d.sceneBoxes[0];
+	const mat4 &m = d.affine[0];
+
+	// Levels of the parallel update are contiguous after the sort
+	transform_hierarchy h;
+	build_bench_hierarchy(h, d);
+
+	std::vector<unsigned> remap(HIERARCHY_COUNT);
+	h.sort_by_depth(&remap[0]);
+
+	bench_crowd crowd(d);
+
+	s.run("jobs", "serial_cull_500k_mask", BOX_COUNT, [&]() { d.camera.aabb_inside_mask(boxes, BOX_COUNT, &o.mask[0]); bench_keep(o.mask); });
+	s.run("jobs", "serial_cull_500k_indices", BOX_COUNT, [&]() { d.camera.aabb_inside_indices(boxes, BOX_COUNT, &o.indices[0]); bench_keep(o.indices); });
+	s.run("jobs", "serial_transform_points_500k", BOX_COUNT, [&]() { transform_points(&transformed[0], &points[0], BOX_COUNT, m); bench_keep(transformed); });
+	s.run("jobs", "serial_transform_aabbs_500k", BOX_COUNT, [&]() { transform_aabbs(&transformedBoxes[0], boxes, BOX_COUNT, m); bench_keep(transformedBoxes); });
+	s.run("jobs", "serial_hierarchy_update_300k", HIERARCHY_COUNT, [&]() { for(unsigned i = 0; i < 64; i++) h.mark_dirty(i); h.update(); bench_keep(h.world); });
+	s.run("jobs", "serial_skin_linear_262k", CROWD_VERTEX_COUNT, [&]() { skin_linear(&crowd.positions[0], &crowd.normals[0], &crowd.sourcePositions[0], &crowd.sourceNormals[0], &crowd.joints[0], &crowd.weights[0], 4, CROWD_VERTEX_COUNT, &crowd.palette[0]); bench_keep(crowd.positions); });
+	s.run("jobs", "serial_skin_dualquat_262k", CROWD_VERTEX_COUNT, [&]() { skin_dualquat(&crowd.positions[0], &crowd.normals[0], &crowd.sourcePositions[0], &crowd.sourceNormals[0], &crowd.joints[0], &crowd.weights[0], 4, CROWD_VERTEX_COUNT, &crowd.dualPalette[0]); bench_keep(crowd.positions); });
+
+	unsigned hardwareThreads = std::thread::hardware_concurrency();
+
+	static const unsigned threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+
+	for(unsigned k = 0; k < sizeof(threadCounts) / sizeof(threadCounts[0]); k++)
+	{
+		unsigned threads = threadCounts[k];
+
+		if(threads > 1 && threads > hardwareThreads)
+			break;
+
+		job_pool pool(threads);
+
+		char name[64];
+
+		sprintf(name, "cull_500k_mask_t%u", threads);
+		s.run("jobs", name, BOX_COUNT, [&]() { parallel_aabb_inside_mask(pool, d.camera, boxes, BOX_COUNT, &o.mask[0]); bench_keep(o.mask); });
+
+		sprintf(name, "cull_500k_indices_t%u", threads);
+		s.run("jobs", name, BOX_COUNT, [&]() { parallel_aabb_inside_indices(pool, d.camera, boxes, BOX_COUNT, &o.indices[0]); bench_keep(o.indices); });
+
+		sprintf(name, "transform_points_500k_t%u", threads);
+		s.run("jobs", name, BOX_COUNT, [&]() { parallel_transform_points(pool, &transformed[0], &points[0], BOX_COUNT, m); bench_keep(transformed); });
+
+		sprintf(name, "transform_aabbs_500k_t%u", threads);
+		s.run("jobs", name, BOX_COUNT, [&]() { parallel_transform_aabbs(pool, &transformedBoxes[0], boxes, BOX_COUNT, m); bench_keep(transformedBoxes); });
+
+		sprintf(name, "hierarchy_update_300k_t%u", threads);
+		s.run("jobs", name, HIERARCHY_COUNT, [&]() { for(unsigned i = 0; i < 64; i++) h.mark_dirty(i); parallel_update(pool, h); bench_keep(h.world); });
+
+		sprintf(name, "skin_linear_262k_t%u", threads);
+		s.run("jobs", name, CROWD_VERTEX_COUNT, [&]() { parallel_skin_linear(pool, &crowd.positions[0], &crowd.normals[0], &crowd.sourcePositions[0], &crowd.sourceNormals[0], &crowd.joints[0], &crowd.weights[0], 4, CROWD_VERTEX_COUNT, &crowd.palette[0]); bench_keep(crowd.positions); });
+
+		sprintf(name, "skin_dualquat_262k_t%u", threads);
+		s.run("jobs", name, CROWD_VERTEX_COUNT, [&]() { parallel_skin_dualquat(pool, &crowd.positions[0], &crowd.normals[0], &crowd.sourcePositions[0], &crowd.sourceNormals[0], &crowd.joints[0], &crowd.weights[0], 4, CROWD_VERTEX_COUNT, &crowd.dualPalette[0]); bench_keep(crowd.positions); });
+	}
+}
+
+static void bench_skinning(bench_suite& s, const bench_data& d)
+{
+	// Joints are the rigid matrices of the inputs, each vertex has 4 or 8 random joints with random weights
+	std::vector<mat4> matrixPalette(SKIN_JOINT_COUNT);
+	std::vector<dualquat> palette(SKIN_JOINT_COUNT);
+
+	for(unsigned i = 0; i < SKIN_JOINT_COUNT; i++)
+	{
+		matrixPalette[i] = d.rigid[i];
+		palette[i] = dualquat(d.qa[i], vec3(d.rigid[i].mat[12], d.rigid[i].mat[13], d.rigid[i].mat[14]));
+	}
+
+	std::vector<vec3> positions(SKIN_VERTEX_COUNT), normals(SKIN_VERTEX_COUNT);
+	std::vector<vec3> skinnedPositions(SKIN_VERTEX_COUNT), skinnedNormals(SKIN_VERTEX_COUNT);
+
+	bench_random rng(37);
+
+	for(unsigned i = 0; i < SKIN_VERTEX_COUNT; i++)
+	{
+		positions[i] = d.a3[i % N];
+		normals[i] = d.normals[i % N];
+	}
+
+	for(unsigned influences = 4; influences <= 8; influences += 4)
+	{
+		std::vector<unsigned short> joints(SKIN_VERTEX_COUNT * influences);
+		std::vector<float> weights(SKIN_VERTEX_COUNT * influences);
+
+		for(unsigned i = 0; i < SKIN_VERTEX_COUNT; i++)
+		{
+			float sum = 0.0f;
+
+			for(unsigned k = 0; k < influences; k++)
+			{
+				joints[i * influences + k] = (unsigned short)(rng.next() % SKIN_JOINT_COUNT);
+				weights[i * influences + k] = rng.uniform(0.1f, 1.0f);
+
+				sum += weights[i * influences + k];
+			}
+
+			for(unsigned k = 0; k < influences; k++)
+				weights[i * influences + k] /= sum;
+		}
+
+		char name[64];
+
+		// Weighted sum of the joint matrices, positions and normals are transformed with it
+		sprintf(name, "matrix_palette_%u", influences);
+		s.run("skinning", name, SKIN_VERTEX_COUNT, [&]()
+		{
+			for(unsigned i = 0; i < SKIN_VERTEX_COUNT; i++)
+			{
+				const unsigned short *joint = &joints[i * influences];
+				const float *weight = &weights[i * influences];
+
+				mat4 m = matrixPalette[joint[0]] * weight[0];
+
+				for(unsigned k = 1; k < influences; k++)
+					m = m + matrixPalette[joint[k]] * weight[k];
+
+				skinnedPositions[i] = mul_m4_v3(m, positions[i]);
+				skinnedNormals[i] = mat3(m) * normals[i];
+			}
+
+			bench_keep(skinnedPositions);
+			bench_keep(skinnedNormals);
+		});
+
+		sprintf(name, "linear_%u", influences);
+		s.run("skinning", name, SKIN_VERTEX_COUNT, [&]()
+		{
+			skin_linear(&skinnedPositions[0], &skinnedNormals[0], &positions[0], &normals[0], &joints[0], &weights[0], influences, SKIN_VERTEX_COUNT, &matrixPalette[0]);
+
+			bench_keep(skinnedPositions);
+			bench_keep(skinnedNormals);
+		});
+
+		sprintf(name, "dualquat_%u", influences);
+		s.run("skinning", name, SKIN_VERTEX_COUNT, [&]()
+		{
+			skin_dualquat(&skinnedPositions[0], &skinnedNormals[0], &positions[0], &normals[0], &joints[0], &weights[0], influences, SKIN_VERTEX_COUNT, &palette[0]);
+
+			bench_keep(skinnedPositions);
+			bench_keep(skinnedNormals);
+		});
+	}
+}
+
+static void bench_lazy(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	// Typical physics and shading expressions, with the vector operators and with lazy expressions
+	// Build with -O0 to measure debug builds
+	const float dt = 1.0f / 60.0f;
+
+	s.run("lazy", "integrate_vec3", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = d.a3[i] + d.b3[i] * dt + d.c3[i] * (0.5f * dt * dt); bench_keep(o.r3); });
+	s.run("lazy", "integrate_vec3_lazy", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = lazy(d.a3[i]) + lazy(d.b3[i]) * dt + lazy(d.c3[i]) * (0.5f * dt * dt); bench_keep(o.r3); });
+	s.run("lazy", "spring_vec3", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = (d.b3[i] - d.a3[i]) * d.f[i] - d.c3[i] * 0.1f; bench_keep(o.r3); });
+	s.run("lazy", "spring_vec3_lazy", N, [&]() { for(unsigned i = 0; i < N; i++) o.r3[i] = (lazy(d.b3[i]) - d.a3[i]) * d.f[i] - lazy(d.c3[i]) * 0.1f; bench_keep(o.r3); });
+	s.run("lazy", "shade_vec4", N, [&]() { for(unsigned i = 0; i < N; i++) o.r4[i] = d.a4[i] * (d.b4[i] * d.t[i] + d.b4[N - 1 - i]) + d.a4[N - 1 - i] * d.f[i]; bench_keep(o.r4); });
+	s.run("lazy", "shade_vec4_lazy", N, [&]() { for(unsigned i = 0; i < N; i++) o.r4[i] = lazy(d.a4[i]) * (lazy(d.b4[i]) * d.t[i] + d.b4[N - 1 - i]) + lazy(d.a4[N - 1 - i]) * d.f[i]; bench_keep(o.r4); });
+	s.run("lazy", "lerp_vec4", N, [&]() { for(unsigned i = 0; i < N; i++) o.r4[i] = d.a4[i] + (d.b4[i] - d.a4[i]) * d.t[i]; bench_keep(o.r4); });
+	s.run("lazy", "lerp_vec4_lazy", N, [&]() { for(unsigned i = 0; i < N; i++) o.r4[i] = lazy(d.a4[i]) + (lazy(d.b4[i]) - d.a4[i]) * d.t[i]; bench_keep(o.r4); });
+}
+
+static void bench_packed(bench_suite& s, const bench_data& d, bench_output& o)
+{
+	std::vector<half3> r3(N);
+	std::vector<normal16> rn(N);
+	std::vector<quat48> rq(N);
+
+	s.run("packed", "half3_pack", N, [&]() { pack(&r3[0], &d.a3[0], N); bench_keep(r3); });
+	s.run("packed", "normal16_pack", N, [&]() { pack(&rn[0], &d.normals[0], N); bench_keep(rn); });
+	s.run("packed", "quat48_pack", N, [&]() { pack(&rq[0], &d.qa[0], N); bench_keep(rq); });
+	s.run("packed", "half3_unpack", N, [&]() { unpack(&o.r3[0], &r3[0], N); bench_keep(o.r3); });
+	s.run("packed", "normal16_unpack", N, [&]() { unpack(&o.r3[0], &rn[0], N); bench_keep(o.r3); });
+	s.run("packed", "quat48_unpack", N, [&]() { unpack(&o.rq[0], &rq[0], N); bench_keep(o.rq); });
+
+	// Arrays of 6 to 12 MB, larger than the L2 cache but not always larger than the L3 cache, unpacking is compared to copying the full precision values
+	std::vector<vec3> positions(BOX_COUNT), normals(BOX_COUNT), unpacked3(BOX_COUNT);
+	std::vector<quat> rotations(BOX_COUNT), unpackedQuat(BOX_COUNT);
+	std::vector<aabb> unpackedBoxes(BOX_COUNT);
+
+	aabb scene(vec3(0.0f, 0.0f, 0.0f), vec3(505.0f, 505.0f, 55.0f));
+
+	for(unsigned i = 0; i < BOX_COUNT; i++)
+	{
+		positions[i] = d.sceneBoxes[i].center;
+		normals[i] = d.normals[i % N];
+		rotations[i] = d.qa[i % N];
+	}
+
+	std::vector<half3> packedPositions(BOX_COUNT);
+	std::vector<normal16> packedNormals(BOX_COUNT);
+	std::vector<quat48> packedRotations(BOX_COUNT);
+	std::vector<aabb16> packedBoxes(BOX_COUNT);
+
+	pack(&packedPositions[0], &positions[0], BOX_COUNT);
+	pack(&packedNormals[0], &normals[0], BOX_COUNT);
+	pack(&packedRotations[0], &rotations[0], BOX_COUNT);
+	pack(&packedBoxes[0], &d.sceneBoxes[0], BOX_COUNT, scene);
+
+	s.run("packed", "vec3_copy_500k", BOX_COUNT, [&]() { std::copy(positions.begin(), positions.end(), unpacked3.begin()); bench_keep(unpacked3); });
+	s.run("packed", "half3_unpack_500k", BOX_COUNT, [&]() { unpack(&unpacked3[0], &packedPositions[0], BOX_COUNT); bench_keep(unpacked3); });
+	s.run("packed", "normal16_unpack_500k", BOX_COUNT, [&]() { unpack(&unpacked3[0], &packedNormals[0], BOX_COUNT); bench_keep(unpacked3); });
+	s.run("packed", "quat_copy_500k", BOX_COUNT, [&]() { std::copy(rotations.begin(), rotations.end(), unpackedQuat.begin()); bench_keep(unpackedQuat); });
+	s.run("packed", "quat48_unpack_500k", BOX_COUNT, [&]() { unpack(&unpackedQuat[0], &packedRotations[0], BOX_COUNT); bench_keep(unpackedQuat); });
+	s.run("packed", "aabb_copy_500k", BOX_COUNT, [&]() { std::copy(d.sceneBoxes.begin(), d.sceneBoxes.end(), unpackedBoxes.begin()); bench_keep(unpackedBoxes); });
+	s.run("packed", "aabb16_unpack_500k", BOX_COUNT, [&]() { unpack(&unpackedBoxes[0], &packedBoxes[0], BOX_COUNT, scene); bench_keep(unpackedBoxes); });
+}
+
+/********************************************************************************/
+/*								Plane test counts								*/
+/********************************************************************************/
+
+// Number of planes tested by the culling loops in frustum, 'outside(i)' is the single plane test
+// With 'lastPlane' the cached plane is tested first and updated the same way as in the cached frustum functions
+template<typename F>
+static unsigned count_plane_tests(F outside, unsigned char* lastPlane)
+{
+	if(!lastPlane)
+	{
+		for(int i = 0; i < 6; i++)
+		{
+			if(outside(i))
+				return i + 1;
+		}
+
+		return 6;
+	}
+
+	if(outside(*lastPlane))
+		return 1;
+
+	unsigned tests = 1;
+
+	for(int i = 0; i < 6; i++)
+	{
+		if(i == *lastPlane)
+			continue;
+
+		tests++;
+
+		if(outside(i))
+		{
+			*lastPlane = (unsigned char)i;
+			break;
+		}
+	}
+
+	return tests;
+}
+
+// Average number of plane tests per box over the camera path, with and without the cached planes
+static void report_plane_tests(FILE *output)
+{
+	bench_data d;
+
+	const aabb *boxes = &d.sceneBoxes[0];
+
+	fprintf(output, "Camera path: %u frames, %u boxes\n", PATH_FRAMES, PATH_BOX_COUNT);
+	fprintf(output, "%-24s %10s %14s %14s %9s\n", "test", "visible", "planes/box", "cached", "saved");
+
+	for(int test = 0; test < 3; test++)
+	{
+		std::vector<unsigned char> lastPlane(PATH_BOX_COUNT, 0);
+
+		double visible = 0.0, tests = 0.0, cachedTests = 0.0;
+
+		// The first loop fills the cache, the second one is measured
+		for(unsigned pass = 0; pass < 2; pass++)
+		{
+			visible = tests = cachedTests = 0.0;
+
+			for(unsigned frame = 0; frame < PATH_FRAMES; frame++)
+			{
+				const frustum &f = d.cameraPath[frame];
+
+				for(unsigned i = 0; i < PATH_BOX_COUNT; i++)
+				{
+					const aabb &box = boxes[i];
+
+					float points[8][3];
+					frustum::aabb_points(box, points);
+
+					float radius = box.radius();
+
+					auto outside = [&](int plane) -> bool
+					{
+						if(test == 0)
+							return f.sphere_outside_plane(box.center, radius, plane);
+
+						if(test == 1)
+							return f.points_outside_plane(points, plane);
+
+						return f.aabb_outside_plane(box, plane);
+					};
+
+					unsigned count = count_plane_tests(outside, 0);
+
+					visible += count == 6 && !outside(5) ? 1.0 : 0.0;
+					tests += count;
+					cachedTests += count_plane_tests(outside, &lastPlane[i]);
+				}
+			}
+		}
+
+		const char *names[] = { "sphere_inside", "aabb_inside", "aabb_inside_radius" };
+
+		double total = double(PATH_FRAMES) * PATH_BOX_COUNT;
+
+		fprintf(output, "%-24s %9.1f%% %14.3f %14.3f %8.1f%%\n", names[test], visible / total * 100.0, tests / total, cachedTests / total, (1.0 - cachedTests / tests) * 100.0);
+	}
+}
+
+/********************************************************************************/
+/*								Packet intersection checks						*/
+/********************************************************************************/
+
+// Lane by lane comparison of the packet intersection with line_intersect_triangle_distance, returns the number of mismatching lanes
+// With 'single' the first line of each packet is tested against all of its triangles
+template<typename T, unsigned Lanes>
+static unsigned check_packet_lanes(const line *lines, const vec3 *a, const vec3 *b, const vec3 *c, unsigned count, bool single, unsigned &hits)
+{
+	unsigned mismatches = 0;
+
+	hits = 0;
+
+	for(unsigned i = 0; i + Lanes <= count; i += Lanes)
+	{
+		triangle_wide<T> tri = triangle_wide<T>::load(a + i, b + i, c + i);
+
+		T distance, u, v;
+		int mask = single ? line_intersect_triangle_distance(lines[i], tri, distance, u, v) : line_intersect_triangle_distance(line_wide<T>::load(lines + i), tri, distance, u, v);
+
+		float lanes[Lanes];
+		distance.store(lanes);
+
+		for(unsigned k = 0; k < Lanes; k++)
+		{
+			float reference = line_intersect_triangle_distance(lines[single ? i : i + k], a[i + k], b[i + k], c[i + k]);
+
+			bool hit = (mask >> k & 1) != 0;
+
+			hits += hit;
+
+			if(hit != (reference >= 0.0f) || memcmp(&lanes[k], &reference, sizeof(float)) != 0)
+				mismatches++;
+		}
+	}
+
+	return mismatches;
+}
+
+// Lines are aimed at the triangles, around the edges and past them, some of the triangles are degenerate
+static bool report_packet_tests(FILE *output)
+{
+	const unsigned count = 65536;
+
+	bench_random rng(29);
+
+	std::vector<vec3> a(count), b(count), c(count);
+	std::vector<line> lines(count);
+
+	for(unsigned i = 0; i < count; i++)
+	{
+		a[i] = vec3(rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f));
+		b[i] = a[i] + vec3(rng.uniform(-4.0f, 4.0f), rng.uniform(-4.0f, 4.0f), rng.uniform(-4.0f, 4.0f));
+		c[i] = i % 32 == 0 ? a[i] + (b[i] - a[i]) * 0.5f : a[i] + vec3(rng.uniform(-4.0f, 4.0f), rng.uniform(-4.0f, 4.0f), rng.uniform(-4.0f, 4.0f));
+
+		float u = rng.uniform(-0.1f, 1.1f);
+		float v = rng.uniform(-0.1f, 1.1f - u);
+
+		vec3 target = a[i] + (b[i] - a[i]) * u + (c[i] - a[i]) * v;
+		vec3 origin(rng.uniform(-20.0f, 20.0f), rng.uniform(-20.0f, 20.0f), rng.uniform(-20.0f, 20.0f));
+
+		lines[i] = line(origin, i % 16 == 0 ? origin + vec3(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f)) : target);
+	}
+
+	fprintf(output, "%-40s %10s %10s %12s\n", "test", "lanes", "hits", "mismatches");
+
+	unsigned total = 0;
+
+	for(int test = 0; test < 4; test++)
+	{
+		bool single = test >= 2;
+
+		unsigned hits = 0;
+		unsigned mismatches = test % 2 == 0 ? check_packet_lanes<floatx4, 4>(&lines[0], &a[0], &b[0], &c[0], count, single, hits) : check_packet_lanes<floatx8, 8>(&lines[0], &a[0], &b[0], &c[0], count, single, hits);
+
+		const char *names[] = { "linex4_trianglex4", "linex8_trianglex8", "line_trianglex4", "line_trianglex8" };
+
+		fprintf(output, "%-40s %10u %10u %12u\n", names[test], count, hits, mismatches);
+
+		total += mismatches;
+	}
+
+	return total == 0;
+}
+
+/********************************************************************************/
+/*								Skinning checks									*/
+/********************************************************************************/
+
+// Null 'normals' or 'sourceNormals' must not change the positions, normals skinned without 'sourceNormals' must be zero
+// The vertex count is not a multiple of 8, so both the eight-vertex groups and the padded tail are checked
+static bool report_skinning_tests(FILE *output)
+{
+	const unsigned count = 37;
+	const unsigned jointCount = 16;
+
+	bench_random rng(41);
+
+	std::vector<mat4> matrixPalette(jointCount);
+	std::vector<dualquat> palette(jointCount);
+
+	for(unsigned i = 0; i < jointCount; i++)
+	{
+		quat q;
+		q.set(bench_data::random_direction(rng), rng.uniform(-180.0f, 180.0f));
+
+		vec3 t(rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f));
+
+		matrixPalette[i] = mat4(q.to_matrix());
+		matrixPalette[i].mat[12] = t.x;
+		matrixPalette[i].mat[13] = t.y;
+		matrixPalette[i].mat[14] = t.z;
+
+		palette[i] = dualquat(q, t);
+	}
+
+	std::vector<vec3> positions(count), normals(count);
+
+	for(unsigned i = 0; i < count; i++)
+	{
+		positions[i] = vec3(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f));
+		normals[i] = bench_data::random_direction(rng);
+	}
+
+	fprintf(output, "%-40s %10s %12s\n", "test", "vertices", "mismatches");
+
+	unsigned total = 0;
+
+	for(int test = 0; test < 4; test++)
+	{
+		unsigned influences = test % 2 == 0 ? 4 : 8;
+		bool dual = test >= 2;
+
+		std::vector<unsigned short> joints(count * influences);
+		std::vector<float> weights(count * influences);
+
+		for(unsigned i = 0; i < count * influences; i++)
+		{
+			joints[i] = (unsigned short)(rng.next() % jointCount);
+			weights[i] = 1.0f / float(influences);
+		}
+
+		std::vector<vec3> reference(count), referenceNormals(count), skinned(count), skinnedNormals(count, vec3(1.0f, 1.0f, 1.0f)), positionsOnly(count);
+
+		if(dual)
+		{
+			skin_dualquat(&reference[0], &referenceNormals[0], &positions[0], &normals[0], &joints[0], &weights[0], influences, count, &palette[0]);
+			skin_dualquat(&skinned[0], &skinnedNormals[0], &positions[0], 0, &joints[0], &weights[0], influences, count, &palette[0]);
+			skin_dualquat(&positionsOnly[0], 0, &positions[0], 0, &joints[0], &weights[0], influences, count, &palette[0]);
+		}
+		else
+		{
+			skin_linear(&reference[0], &referenceNormals[0], &positions[0], &normals[0], &joints[0], &weights[0], influences, count, &matrixPalette[0]);
+			skin_linear(&skinned[0], &skinnedNormals[0], &positions[0], 0, &joints[0], &weights[0], influences, count, &matrixPalette[0]);
+			skin_linear(&positionsOnly[0], 0, &positions[0], 0, &joints[0], &weights[0], influences, count, &matrixPalette[0]);
+		}
+
+		unsigned mismatches = 0;
+
+		for(unsigned i = 0; i < count; i++)
+		{
+			bool zeroNormal = skinnedNormals[i].x == 0.0f && skinnedNormals[i].y == 0.0f && skinnedNormals[i].z == 0.0f;
+
+			if(memcmp(&skinned[i], &reference[i], sizeof(vec3)) != 0 || memcmp(&positionsOnly[i], &reference[i], sizeof(vec3)) != 0 || !zeroNormal)
+				mismatches++;
+		}
+
+		const char *names[] = { "linear_4_null_source_normals", "linear_8_null_source_normals", "dualquat_4_null_source_normals", "dualquat_8_null_source_normals" };
+
+		fprintf(output, "%-40s %10u %12u\n", names[test], count, mismatches);
+
+		total += mismatches;
+	}
+
+	return total == 0;
+}
+
+/********************************************************************************/
+/*								Fast math errors								*/
+/********************************************************************************/
+
+// Distance in units in the last place between a result and the reference rounded to float
+static double ulp_distance(float value, double reference)
+{
+	float rounded = float(reference);
+
+	int a, b;
+	memcpy(&a, &value, 4);
+	memcpy(&b, &rounded, 4);
+
+	// Negative values are mapped below zero to keep the order
+	long long ia = a < 0 ? -(long long)(a & 0x7fffffff) : a;
+	long long ib = b < 0 ? -(long long)(b & 0x7fffffff) : b;
+
+	return double(ia > ib ? ia - ib : ib - ia);
+}
+
+struct error_stat
+{
+	error_stat(const char* name): name(name), samples(0), maxAbs(0.0), maxUlp(0.0)
+	{
+	}
+
+	void add(float value, double reference)
+	{
+		double abs = fabs(double(value) - reference);
+
+		// Near zero the absolute error is more meaningful
+		double ulp = fabs(reference) >= 1e-3 ? ulp_distance(value, reference) : 0.0;
+
+		maxAbs = abs > maxAbs ? abs : maxAbs;
+		maxUlp = ulp > maxUlp ? ulp : maxUlp;
+		samples++;
+	}
+
+	void print(FILE *output) const
+	{
+		fprintf(output, "%-40s %10u %14.3g %12.0f\n", name, samples, maxAbs, maxUlp);
+	}
+
+	const char *name;
+	unsigned samples;
+	double maxAbs;
+	double maxUlp;
+};
+
+// Fast functions are compared with libm, library functions with a double precision reference
+// Library functions only use the approximations when the benchmark is built with SIMPLEMATH_FAST_MATH
+static void report_errors(FILE *output)
+{
+	const unsigned count = 1000000;
+	const double pi = 3.14159265358979323846;
+
+	bench_random rng(23);
+
+	fprintf(output, "config: %s\n", bench_config());
+	fprintf(output, "%-40s %10s %14s %12s\n", "function", "samples", "max abs error", "max ulp (|x| >= 1e-3)");
+
+	error_stat rsqrt("fast_rsqrt vs 1/sqrtf");
+	error_stat sinSmall("fast_sin vs sinf [-pi, pi]"), cosSmall("fast_cos vs cosf [-pi, pi]");
+	error_stat sinLarge("fast_sin vs sinf [-100, 100]"), cosLarge("fast_cos vs cosf [-100, 100]");
+	error_stat sinHuge("fast_sin vs sinf [-1e5, 1e5]");
+	error_stat acos("fast_acos vs acosf");
+
+	for(unsigned i = 0; i < count; i++)
+	{
+		float x = powf(2.0f, rng.uniform(-20.0f, 20.0f));
+		rsqrt.add(fast_rsqrt(x), 1.0f / sqrtf(x));
+
+		x = rng.uniform(-float(pi), float(pi));
+		sinSmall.add(fast_sin(x), sinf(x));
+		cosSmall.add(fast_cos(x), cosf(x));
+
+		x = rng.uniform(-100.0f, 100.0f);
+		sinLarge.add(fast_sin(x), sinf(x));
+		cosLarge.add(fast_cos(x), cosf(x));
+
+		x = rng.uniform(-1e5f, 1e5f);
+		sinHuge.add(fast_sin(x), sinf(x));
+
+		x = rng.uniform(-1.0f, 1.0f);
+		acos.add(fast_acos(x), acosf(x));
+	}
+
+	rsqrt.print(output);
+	sinSmall.print(output);
+	cosSmall.print(output);
+	sinLarge.print(output);
+	cosLarge.print(output);
+	sinHuge.print(output);
+	acos.print(output);
+
+	error_stat normalize3("vec3::normalize");
+	error_stat normalizeQuat("quat::normalize");
+	error_stat rotated("vec2::rotated");
+	error_stat rotate("mat3::rotate");
+	error_stat setQuat("quat::set");
+	error_stat slerp("quat::slerp");
+
+	for(unsigned i = 0; i < count / 10; i++)
+	{
+		vec3 v(rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f), rng.uniform(-10.0f, 10.0f));
+		double length = sqrt(double(v.x) * v.x + double(v.y) * v.y + double(v.z) * v.z);
+
+		vec3 n = v;
+		n.normalize();
+
+		normalize3.add(n.x, v.x / length);
+		normalize3.add(n.y, v.y / length);
+		normalize3.add(n.z, v.z / length);
+
+		quat q(rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f), rng.uniform(-1.0f, 1.0f));
+		double magnitude = sqrt(double(q.x) * q.x + double(q.y) * q.y + double(q.z) * q.z + double(q.w) * q.w);
+
+		quat nq = q;
+		nq.normalize();
+
+		normalizeQuat.add(nq.x, q.x / magnitude);
+		normalizeQuat.add(nq.w, q.w / magnitude);
+
+		float radians = rng.uniform(-10.0f, 10.0f);
+
+		vec2 r = vec2(v.x, v.y).rotated(radians);
+
+		rotated.add(r.x, v.x * cos(double(radians)) - v.y * sin(double(radians)));
+		rotated.add(r.y, v.x * sin(double(radians)) + v.y * cos(double(radians)));
+
+		// Rotation of a unit axis, the reference is the Rodrigues formula
+		float degrees = rng.uniform(-360.0f, 360.0f);
+		double angle = double(degrees * 3.1415926536f / 180.0f);
+
+		vec3 axis = bench_data::random_direction(rng);
+
+		mat3 m;
+		m.rotate(axis, degrees);
+
+		double c = cos(angle), s = sin(angle);
+
+		rotate.add(m.mat[0], (1.0 - c) * axis.x * axis.x + c);
+		rotate.add(m.mat[1], (1.0 - c) * axis.x * axis.y + axis.z * s);
+		rotate.add(m.mat[5], (1.0 - c) * axis.y * axis.z + axis.x * s);
+
+		quat sq;
+		sq.set(axis, degrees);
+
+		setQuat.add(sq.x, axis.x * sin(angle / 2.0));
+		setQuat.add(sq.w, cos(angle / 2.0));
+
+		// Interpolation between two rotations, the reference uses the same shortest path choice
+		quat q0, q1;
+		q0.set(bench_data::random_direction(rng), rng.uniform(-180.0f, 180.0f));
+		q1.set(bench_data::random_direction(rng), rng.uniform(-180.0f, 180.0f));
+
+		float t = rng.uniform(0.0f, 1.0f);
+
+		quat sl;
+		sl.slerp(q0, q1, t);
+
+		double cosomega = double(q0.x) * q1.x + double(q0.y) * q1.y + double(q0.z) * q1.z + double(q0.w) * q1.w;
+		double sign = cosomega < 0.0 ? -1.0 : 1.0;
+
+		cosomega *= sign;
+
+		if(cosomega < 0.999)
+		{
+			double omega = ::acos(cosomega);
+
+			double k0 = sin((1.0 - t) * omega) / sin(omega);
+			double k1 = sign * sin(t * omega) / sin(omega);
+
+			slerp.add(sl.x, q0.x * k0 + q1.x * k1);
+			slerp.add(sl.w, q0.w * k0 + q1.w * k1);
+		}
+	}
+
+	normalize3.print(output);
+	normalizeQuat.print(output);
+	rotated.print(output);
+	rotate.print(output);
+	setQuat.print(output);
+	slerp.print(output);
+}
+
+/********************************************************************************/
+/*								Entry point										*/
+/********************************************************************************/
+
+int main(int argc, char** argv)
+{
+	bench_suite suite;
+
+	const char *compareBase = 0;
+	const char *compareCurrent = 0;
+	double threshold = 5.0;
+	bool errors = false;
+	bool planeTests = false;
+	bool packetTests = false;
+	bool skinningTests = false;
+
+	for(int i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+
+		if(strcmp(arg, "--format=csv") == 0)
+			suite.format = bench_suite::FORMAT_CSV;
+		else if(strcmp(arg, "--format=json") == 0)
+			suite.format = bench_suite::FORMAT_JSON;
+		else if(strcmp(arg, "--format=text") == 0)
+			suite.format = bench_suite::FORMAT_TEXT;
+		else if(strncmp(arg, "--filter=", 9) == 0)
+			suite.filter = arg + 9;
+		else if(strncmp(arg, "--time=", 7) == 0)
+			suite.sampleTime = atof(arg + 7) * 0.001;
+		else if(strncmp(arg, "--samples=", 10) == 0)
+			suite.sampleCount = unsigned(atoi(arg + 10)) ? unsigned(atoi(arg + 10)) : 1;
+		else if(strncmp(arg, "--threshold=", 12) == 0)
+			threshold = atof(arg + 12);
+		else if(strncmp(arg, "--output=", 9) == 0)
+			suite.output = fopen(arg + 9, "w");
+		else if(strcmp(arg, "--errors") == 0)
+			errors = true;
+		else if(strcmp(arg, "--plane-tests") == 0)
+			planeTests = true;
+		else if(strcmp(arg, "--packet-tests") == 0)
+			packetTests = true;
+		else if(strcmp(arg, "--skinning-tests") == 0)
+			skinningTests = true;
+		else if(strcmp(arg, "--compare") == 0 && i + 2 < argc)
+			compareBase = argv[++i], compareCurrent = argv[++i];
+		else
+		{
+			fprintf(stderr, "usage: %s [--format=csv|json|text] [--filter=substring] [--time=ms] [--samples=n] [--output=file]\n", argv[0]);
+			fprintf(stderr, "       %s --errors [--output=file]\n", argv[0]);
+			fprintf(stderr, "       %s --plane-tests [--output=file]\n", argv[0]);
+			fprintf(stderr, "       %s --packet-tests [--output=file]\n", argv[0]);
+			fprintf(stderr, "       %s --skinning-tests [--output=file]\n", argv[0]);
+			fprintf(stderr, "       %s --compare base.csv current.csv [--threshold=percent]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if(!suite.output)
+	{
+		fprintf(stderr, "failed to open the output file\n");
+		return 2;
+	}
+
+	if(compareBase)
+	{
+		std::vector<bench_result> base, current;
+
+		if(!bench_read_csv(compareBase, base) || !bench_read_csv(compareCurrent, current))
+		{
+			fprintf(stderr, "failed to read '%s' or '%s'\n", compareBase, compareCurrent);
+			return 2;
+		}
+
+		return bench_compare(base, current, threshold, suite.output) ? 1 : 0;
+	}
+
+	if(errors)
+	{
+		report_errors(suite.output);
+		return 0;
+	}
+
+	if(planeTests)
+	{
+		report_plane_tests(suite.output);
+		return 0;
+	}
+
+	if(packetTests)
+		return report_packet_tests(suite.output) ? 0 : 1;
+
+	if(skinningTests)
+		return report_skinning_tests(suite.output) ? 0 : 1;
+
+	bench_data data;
+	bench_output output;
+
+	bench_fast_math(suite, data, output);
+	bench_vector(suite, data, output);
+	bench_matrix(suite, data, output);
+	bench_affine(suite, data, output);
+	bench_transform(suite, data, output);
+	bench_quat(suite, data, output);
+	bench_plane(suite, data, output);
+	bench_aabb(suite, data, output);
+	bench_frustum(suite, data, output);
+	bench_bvh(suite, data, output);
+	bench_octree(suite, data, output);
+	bench_aabb_tree(suite, data, output);
+	bench_hierarchy(suite, data);
+	bench_jobs(suite, data, output);
+	bench_skinning(suite, data);
+	bench_lazy(suite, data, output);
+	bench_packed(suite, data, output);
+
+	suite.finish();
+
+	if(suite.output != stdout)
+		fclose(suite.output);
+
+	return 0;
+}
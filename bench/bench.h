@@ -0,0 +1,329 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../config.h"
+
+/********************************************************************************/
+/*								Helpers											*/
+/********************************************************************************/
+
+// Prevents the compiler from removing the computation of a value that is never read
+template<typename T>
+inline void bench_keep(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r"(&value) : "memory");
+#else
+	static volatile unsigned char sink;
+
+	const unsigned char *bytes = (const unsigned char*)&value;
+
+	for(unsigned i = 0; i < sizeof(T); i++)
+		sink ^= bytes[i];
+#endif
+}
+
+template<typename T>
+inline void bench_keep(const std::vector<T>& values)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r"(values.data()) : "memory");
+#else
+	static volatile unsigned char sink;
+
+	const unsigned char *bytes = (const unsigned char*)values.data();
+
+	for(unsigned i = 0; i < values.size() * sizeof(T); i++)
+		sink ^= bytes[i];
+#endif
+}
+
+// Deterministic generator, the same seed produces the same inputs on every platform
+struct bench_random
+{
+	bench_random(unsigned seed = 1): state(seed ? seed : 1)
+	{
+	}
+
+	unsigned next()
+	{
+		// xorshift32
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	// Uniform in [min, max)
+	float uniform(float min, float max)
+	{
+		return min + (max - min) * float(next() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	unsigned state;
+};
+
+#if defined(SIMPLEMATH_FAST_MATH)
+	#define SIMPLEMATH_BENCH_FAST_MATH "+fast_math"
+#else
+	#define SIMPLEMATH_BENCH_FAST_MATH ""
+#endif
+
+#if defined(SIMPLEMATH_FMA)
+	#define SIMPLEMATH_BENCH_FMA "+fma"
+#else
+	#define SIMPLEMATH_BENCH_FMA ""
+#endif
+
+#define SIMPLEMATH_BENCH_MODE SIMPLEMATH_BENCH_FAST_MATH SIMPLEMATH_BENCH_FMA
+
+inline const char* bench_config()
+{
+#if defined(SIMPLEMATH_AVX512)
+	return "avx512" SIMPLEMATH_BENCH_MODE;
+#elif defined(SIMPLEMATH_AVX2)
+	return "avx2" SIMPLEMATH_BENCH_MODE;
+#elif defined(SIMPLEMATH_AVX)
+	return "avx" SIMPLEMATH_BENCH_MODE;
+#elif defined(SIMPLEMATH_SSE41)
+	return "sse41" SIMPLEMATH_BENCH_MODE;
+#else
+	return "scalar" SIMPLEMATH_BENCH_MODE;
+#endif
+}
+
+/********************************************************************************/
+/*								bench_result									*/
+/********************************************************************************/
+
+struct bench_result
+{
+	std::string name;		// "group/case"
+	double nsPerOp;			// median of all samples
+	double nsPerOpMin;		// best sample
+	double opsPerSecond;	// from the median
+	unsigned samples;
+};
+
+/********************************************************************************/
+/*								bench_suite										*/
+/********************************************************************************/
+
+struct bench_suite
+{
+	bench_suite(): sampleTime(0.002), sampleCount(9), format(FORMAT_CSV), output(stdout)
+	{
+	}
+
+	enum output_format
+	{
+		FORMAT_CSV,
+		FORMAT_JSON,
+		FORMAT_TEXT
+	};
+
+	// 'body' performs 'opsPerCall' operations, it is called repeatedly until a sample takes 'sampleTime' seconds
+	template<typename F>
+	void run(const char* group, const char* name, unsigned opsPerCall, F body)
+	{
+		std::string fullName = std::string(group) + "/" + name;
+
+		if(!filter.empty() && fullName.find(filter) == std::string::npos)
+			return;
+
+		typedef std::chrono::high_resolution_clock clock;
+
+		// Warm up caches and find the number of calls per sample
+		unsigned calls = 1;
+
+		for(;;)
+		{
+			clock::time_point start = clock::now();
+
+			for(unsigned i = 0; i < calls; i++)
+				body();
+
+			double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+
+			if(elapsed >= sampleTime || calls >= (1u << 30))
+				break;
+
+			calls = elapsed > sampleTime / 64 ? unsigned(calls * sampleTime / elapsed) + 1 : calls * 8;
+		}
+
+		std::vector<double> times(sampleCount);
+
+		for(unsigned sample = 0; sample < sampleCount; sample++)
+		{
+			clock::time_point start = clock::now();
+
+			for(unsigned i = 0; i < calls; i++)
+				body();
+
+			double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+
+			times[sample] = elapsed * 1e9 / (double(calls) * opsPerCall);
+		}
+
+		std::sort(times.begin(), times.end());
+
+		bench_result result;
+
+		result.name = fullName;
+		result.nsPerOp = times[sampleCount / 2];
+		result.nsPerOpMin = times[0];
+		result.opsPerSecond = result.nsPerOp > 0.0 ? 1e9 / result.nsPerOp : 0.0;
+		result.samples = sampleCount;
+
+		results.push_back(result);
+
+		print_result(result, results.size() == 1);
+	}
+
+	// Results are printed as soon as they are ready, 'finish' closes the output
+	void finish()
+	{
+		if(format == FORMAT_JSON)
+			fprintf(output, results.empty() ? "{\"config\": \"%s\", \"results\": [\n]}\n" : "\n]}\n", bench_config());
+
+		fflush(output);
+	}
+
+	double sampleTime;
+	unsigned sampleCount;
+
+	std::string filter;
+
+	output_format format;
+	FILE *output;
+
+	std::vector<bench_result> results;
+
+private:
+	void print_result(const bench_result& r, bool first)
+	{
+		switch(format)
+		{
+		case FORMAT_CSV:
+			if(first)
+				fprintf(output, "name,config,ns_per_op,ns_per_op_min,ops_per_second,samples\n");
+
+			fprintf(output, "%s,%s,%.4f,%.4f,%.0f,%u\n", r.name.c_str(), bench_config(), r.nsPerOp, r.nsPerOpMin, r.opsPerSecond, r.samples);
+			break;
+		case FORMAT_JSON:
+			if(first)
+				fprintf(output, "{\"config\": \"%s\", \"results\": [\n", bench_config());
+			else
+				fprintf(output, ",\n");
+
+			fprintf(output, "\t{\"name\": \"%s\", \"ns_per_op\": %.4f, \"ns_per_op_min\": %.4f, \"ops_per_second\": %.0f, \"samples\": %u}", r.name.c_str(), r.nsPerOp, r.nsPerOpMin, r.opsPerSecond, r.samples);
+			break;
+		case FORMAT_TEXT:
+			if(first)
+				fprintf(output, "%-48s %12s %12s %14s\n", "name", "ns/op", "min ns/op", "Mops/s");
+
+			fprintf(output, "%-48s %12.3f %12.3f %14.2f\n", r.name.c_str(), r.nsPerOp, r.nsPerOpMin, r.opsPerSecond * 1e-6);
+			break;
+		}
+
+		fflush(output);
+	}
+};
+
+/********************************************************************************/
+/*								Run comparison									*/
+/********************************************************************************/
+
+// Reads 'name' and 'ns_per_op' columns of a CSV file written by bench_suite
+inline bool bench_read_csv(const char* path, std::vector<bench_result>& results)
+{
+	FILE *file = fopen(path, "r");
+
+	if(!file)
+		return false;
+
+	char line[1024];
+
+	// Header
+	if(!fgets(line, sizeof(line), file))
+	{
+		fclose(file);
+		return false;
+	}
+
+	while(fgets(line, sizeof(line), file))
+	{
+		char *name = strtok(line, ",\r\n");
+		char *config = strtok(0, ",\r\n");
+		char *nsPerOp = strtok(0, ",\r\n");
+		char *nsPerOpMin = strtok(0, ",\r\n");
+
+		if(!name || !config || !nsPerOp || !nsPerOpMin)
+			continue;
+
+		bench_result r;
+
+		r.name = name;
+		r.nsPerOp = atof(nsPerOp);
+		r.nsPerOpMin = atof(nsPerOpMin);
+		r.opsPerSecond = r.nsPerOp > 0.0 ? 1e9 / r.nsPerOp : 0.0;
+		r.samples = 0;
+
+		results.push_back(r);
+	}
+
+	fclose(file);
+
+	return true;
+}
+
+// Prints the change for each benchmark present in both runs, returns the number of cases that got slower by more than 'threshold' percent
+inline unsigned bench_compare(const std::vector<bench_result>& base, const std::vector<bench_result>& current, double threshold, FILE *output)
+{
+	unsigned regressions = 0;
+
+	fprintf(output, "%-48s %12s %12s %9s\n", "name", "base ns/op", "ns/op", "change");
+
+	for(unsigned i = 0; i < current.size(); i++)
+	{
+		const bench_result *match = 0;
+
+		for(unsigned k = 0; k < base.size() && !match; k++)
+		{
+			if(base[k].name == current[i].name)
+				match = &base[k];
+		}
+
+		if(!match)
+		{
+			fprintf(output, "%-48s %12s %12.3f %9s\n", current[i].name.c_str(), "-", current[i].nsPerOp, "new");
+			continue;
+		}
+
+		double change = match->nsPerOp > 0.0 ? (current[i].nsPerOp / match->nsPerOp - 1.0) * 100.0 : 0.0;
+
+		const char *mark = "";
+
+		if(change > threshold)
+		{
+			mark = " slower";
+			regressions++;
+		}
+		else if(change < -threshold)
+		{
+			mark = " faster";
+		}
+
+		fprintf(output, "%-48s %12.3f %12.3f %+8.1f%%%s\n", current[i].name.c_str(), match->nsPerOp, current[i].nsPerOp, change, mark);
+	}
+
+	return regressions;
+}
@@ -0,0 +1,521 @@
+#pragma once
+
+#include <float.h>
+
+#include <vector>
+
+#include "plane.h"
+#include "frustum.h"
+
+/********************************************************************************/
+/*								bvh_node										*/
+/********************************************************************************/
+
+// 32 bytes, nodes are stored in depth-first order: the first child of a node immediately follows it
+struct bvh_node
+{
+	vec3 min;
+	unsigned first; // Leaf: index of the first primitive in bvh::indices, node: index of the second child
+	vec3 max;
+	unsigned count; // Leaf: number of primitives, node: 0
+};
+
+/********************************************************************************/
+/*								bvh												*/
+/********************************************************************************/
+
+// Bounding volume hierarchy built with binned SAH over an array of aabb or triangles
+// The source array is referenced, not copied, and has to stay alive while the hierarchy is used
+// Query results are indices into the source array
+struct bvh
+{
+	enum
+	{
+		BIN_COUNT = 16,
+		STACK_SIZE = 64
+	};
+
+	bvh(): boxes(0), vertices(0)
+	{
+	}
+
+	void build(const aabb* boxes, unsigned count, unsigned maxLeafSize = 4)
+	{
+		this->boxes = boxes;
+		this->vertices = 0;
+
+		std::vector<aabb> bounds(count);
+
+		for(unsigned i = 0; i < count; i++)
+			bounds[i] = boxes[i];
+
+		build_hierarchy(bounds, maxLeafSize);
+	}
+
+	// Triangle i is made of vertices[i * 3], vertices[i * 3 + 1] and vertices[i * 3 + 2]
+	void build(const vec3* vertices, unsigned triangleCount, unsigned maxLeafSize = 4)
+	{
+		this->boxes = 0;
+		this->vertices = vertices;
+
+		std::vector<aabb> bounds(triangleCount);
+
+		for(unsigned i = 0; i < triangleCount; i++)
+			bounds[i] = primitive_bounds(i);
+
+		build_hierarchy(bounds, maxLeafSize);
+	}
+
+	aabb primitive_bounds(unsigned i) const
+	{
+		if(boxes)
+			return boxes[i];
+
+		const vec3 &a = vertices[i * 3];
+		const vec3 &b = vertices[i * 3 + 1];
+		const vec3 &c = vertices[i * 3 + 2];
+
+		vec3 minp(min3(a.x, b.x, c.x), min3(a.y, b.y, c.y), min3(a.z, b.z, c.z));
+		vec3 maxp(max3(a.x, b.x, c.x), max3(a.y, b.y, c.y), max3(a.z, b.z, c.z));
+
+		return aabb((minp + maxp) * 0.5f, (maxp - minp) * 0.5f);
+	}
+
+	// Queries
+
+	// Returns the index of the closest primitive hit by the line (in the direction of 'l.n') or -1
+	// Triangles are tested with line_intersect_triangle_distance, boxes report the distance to the entry point (0 if the line starts inside)
+	int ray_nearest(const line& l, float& distance, float maxDistance = FLT_MAX) const
+	{
+		int nearest = -1;
+
+		distance = maxDistance;
+
+		if(nodes.empty())
+			return -1;
+
+		vec3 invDir = line_inverse_direction(l);
+
+		unsigned stack[STACK_SIZE];
+		unsigned stackSize = 0;
+
+		unsigned current = 0;
+
+		for(;;)
+		{
+			const bvh_node &node = nodes[current];
+
+			if(node.count)
+			{
+				for(unsigned i = node.first; i < node.first + node.count; i++)
+				{
+					float d = primitive_distance(l, invDir, indices[i], distance);
+
+					if(d >= 0.0f && d < distance)
+					{
+						distance = d;
+						nearest = int(indices[i]);
+					}
+				}
+			}
+			else
+			{
+				// Visit the closer child first
+				unsigned left = current + 1;
+				unsigned right = node.first;
+
+				float dLeft = line_intersect_aabb_distance(l.p, invDir, nodes[left].min, nodes[left].max, distance);
+				float dRight = line_intersect_aabb_distance(l.p, invDir, nodes[right].min, nodes[right].max, distance);
+
+				if(dLeft >= 0.0f && dRight >= 0.0f)
+				{
+					if(dRight < dLeft)
+					{
+						unsigned tmp = left;
+						left = right;
+						right = tmp;
+					}
+
+					stack[stackSize++] = right;
+					current = left;
+					continue;
+				}
+
+				if(dLeft >= 0.0f)
+				{
+					current = left;
+					continue;
+				}
+
+				if(dRight >= 0.0f)
+				{
+					current = right;
+					continue;
+				}
+			}
+
+			// Nodes on the stack could have been entered before a closer hit was found
+			for(;;)
+			{
+				if(!stackSize)
+					return nearest;
+
+				current = stack[--stackSize];
+
+				if(line_intersect_aabb_distance(l.p, invDir, nodes[current].min, nodes[current].max, distance) >= 0.0f)
+					break;
+			}
+		}
+	}
+
+	// Returns true if the line hits any primitive closer than 'maxDistance'
+	bool ray_any(const line& l, float maxDistance = FLT_MAX) const
+	{
+		if(nodes.empty())
+			return false;
+
+		vec3 invDir = line_inverse_direction(l);
+
+		unsigned stack[STACK_SIZE];
+		unsigned stackSize = 0;
+
+		stack[stackSize++] = 0;
+
+		while(stackSize)
+		{
+			const bvh_node &node = nodes[stack[--stackSize]];
+
+			if(line_intersect_aabb_distance(l.p, invDir, node.min, node.max, maxDistance) < 0.0f)
+				continue;
+
+			if(node.count)
+			{
+				for(unsigned i = node.first; i < node.first + node.count; i++)
+				{
+					float d = primitive_distance(l, invDir, indices[i], maxDistance);
+
+					if(d >= 0.0f && d < maxDistance)
+						return true;
+				}
+			}
+			else
+			{
+				stack[stackSize++] = node.first;
+				stack[stackSize++] = unsigned(&node - &nodes[0]) + 1;
+			}
+		}
+
+		return false;
+	}
+
+	// Appends indices of primitives with bounds that are visible in the frustum (see frustum::aabb_classify)
+	// Planes that a node is fully inside of are not tested for its children, nodes inside of the frustum are accepted without tests
+	void frustum_overlap(const frustum& f, std::vector<unsigned>& result) const
+	{
+		if(nodes.empty())
+			return;
+
+		unsigned stack[STACK_SIZE];
+		unsigned stackMask[STACK_SIZE];
+		unsigned stackSize = 0;
+
+		stack[stackSize] = 0;
+		stackMask[stackSize++] = frustum::PLANE_MASK_ALL;
+
+		while(stackSize)
+		{
+			--stackSize;
+
+			const bvh_node &node = nodes[stack[stackSize]];
+			unsigned planeMask = stackMask[stackSize];
+
+			if(planeMask && f.aabb_classify(aabb((node.min + node.max) * 0.5f, (node.max - node.min) * 0.5f), planeMask) == frustum::CULL_OUTSIDE)
+				continue;
+
+			if(node.count)
+			{
+				for(unsigned i = node.first; i < node.first + node.count; i++)
+				{
+					unsigned primitiveMask = planeMask;
+
+					if(!primitiveMask || f.aabb_classify(primitive_bounds(indices[i]), primitiveMask) != frustum::CULL_OUTSIDE)
+						result.push_back(indices[i]);
+				}
+			}
+			else
+			{
+				stack[stackSize] = node.first;
+				stackMask[stackSize++] = planeMask;
+				stack[stackSize] = unsigned(&node - &nodes[0]) + 1;
+				stackMask[stackSize++] = planeMask;
+			}
+		}
+	}
+
+	// Appends indices of primitives with bounds that overlap the box
+	void aabb_overlap(const aabb& box, std::vector<unsigned>& result) const
+	{
+		if(nodes.empty())
+			return;
+
+		vec3 minp = box.min_point();
+		vec3 maxp = box.max_point();
+
+		unsigned stack[STACK_SIZE];
+		unsigned stackSize = 0;
+
+		stack[stackSize++] = 0;
+
+		while(stackSize)
+		{
+			const bvh_node &node = nodes[stack[--stackSize]];
+
+			if(!overlap(node.min, node.max, minp, maxp))
+				continue;
+
+			if(node.count)
+			{
+				for(unsigned i = node.first; i < node.first + node.count; i++)
+				{
+					aabb bounds = primitive_bounds(indices[i]);
+
+					if(overlap(bounds.min_point(), bounds.max_point(), minp, maxp))
+						result.push_back(indices[i]);
+				}
+			}
+			else
+			{
+				stack[stackSize++] = node.first;
+				stack[stackSize++] = unsigned(&node - &nodes[0]) + 1;
+			}
+		}
+	}
+
+	std::vector<bvh_node> nodes;
+	std::vector<unsigned> indices;
+
+	const aabb *boxes;
+	const vec3 *vertices;
+
+private:
+	struct bin
+	{
+		bin(): minp(FLT_MAX), maxp(-FLT_MAX), count(0)
+		{
+		}
+
+		void add(const vec3& pmin, const vec3& pmax)
+		{
+			minp = vec3(pmin.x < minp.x ? pmin.x : minp.x, pmin.y < minp.y ? pmin.y : minp.y, pmin.z < minp.z ? pmin.z : minp.z);
+			maxp = vec3(pmax.x > maxp.x ? pmax.x : maxp.x, pmax.y > maxp.y ? pmax.y : maxp.y, pmax.z > maxp.z ? pmax.z : maxp.z);
+		}
+
+		float half_area() const
+		{
+			vec3 d = maxp - minp;
+
+			return count ? d.x * d.y + d.y * d.z + d.z * d.x : 0.0f;
+		}
+
+		vec3 minp, maxp;
+		unsigned count;
+	};
+
+	static float min3(float a, float b, float c)
+	{
+		return a < b ? (a < c ? a : c) : (b < c ? b : c);
+	}
+
+	static float max3(float a, float b, float c)
+	{
+		return a > b ? (a > c ? a : c) : (b > c ? b : c);
+	}
+
+	static bool overlap(const vec3& minA, const vec3& maxA, const vec3& minB, const vec3& maxB)
+	{
+		return minA.x <= maxB.x && maxA.x >= minB.x && minA.y <= maxB.y && maxA.y >= minB.y && minA.z <= maxB.z && maxA.z >= minB.z;
+	}
+
+	float primitive_distance(const line& l, const vec3& invDir, unsigned i, float maxDistance) const
+	{
+		if(boxes)
+			return line_intersect_aabb_distance(l.p, invDir, boxes[i].min_point(), boxes[i].max_point(), maxDistance);
+
+		return line_intersect_triangle_distance(l, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]);
+	}
+
+	void build_hierarchy(const std::vector<aabb>& bounds, unsigned maxLeafSize)
+	{
+		unsigned count = unsigned(bounds.size());
+
+		nodes.clear();
+		indices.resize(count);
+
+		if(!count)
+			return;
+
+		std::vector<vec3> pmin(count), pmax(count), centroid(count);
+
+		for(unsigned i = 0; i < count; i++)
+		{
+			indices[i] = i;
+
+			pmin[i] = bounds[i].min_point();
+			pmax[i] = bounds[i].max_point();
+			centroid[i] = bounds[i].center;
+		}
+
+		nodes.reserve(count * 2);
+		nodes.push_back(bvh_node());
+
+		build_node(0, 0, count, maxLeafSize ? maxLeafSize : 1, 0, pmin, pmax, centroid);
+	}
+
+	void build_node(unsigned nodeIndex, unsigned first, unsigned count, unsigned maxLeafSize, unsigned depth, const std::vector<vec3>& pmin, const std::vector<vec3>& pmax, const std::vector<vec3>& centroid)
+	{
+		bin bounds, centroidBounds;
+
+		for(unsigned i = first; i < first + count; i++)
+		{
+			bounds.add(pmin[indices[i]], pmax[indices[i]]);
+			centroidBounds.add(centroid[indices[i]], centroid[indices[i]]);
+		}
+
+		bounds.count = count;
+
+		nodes[nodeIndex].min = bounds.minp;
+		nodes[nodeIndex].max = bounds.maxp;
+		nodes[nodeIndex].first = first;
+		nodes[nodeIndex].count = count;
+
+		// Traversal stack has to hold one sibling per level
+		if(count <= 1 || depth + 2 >= STACK_SIZE)
+			return;
+
+		// Find the best split plane among bin boundaries on all axes
+		float bestCost = FLT_MAX;
+		int bestAxis = -1;
+		unsigned bestSplit = 0;
+
+		vec3 extent = centroidBounds.maxp - centroidBounds.minp;
+
+		for(int axis = 0; axis < 3; axis++)
+		{
+			float axisMin = (&centroidBounds.minp.x)[axis];
+			float axisExtent = (&extent.x)[axis];
+
+			if(axisExtent <= 0.0f)
+				continue;
+
+			float scale = float(BIN_COUNT) / axisExtent;
+
+			bin bins[BIN_COUNT];
+
+			for(unsigned i = first; i < first + count; i++)
+			{
+				unsigned index = indices[i];
+
+				bin &b = bins[bin_index((&centroid[index].x)[axis], axisMin, scale)];
+
+				b.add(pmin[index], pmax[index]);
+				b.count++;
+			}
+
+			// Sweep from the right to get areas and counts of the right side for each split
+			float rightArea[BIN_COUNT];
+			unsigned rightCount[BIN_COUNT];
+
+			bin right;
+
+			for(unsigned i = BIN_COUNT - 1; i > 0; i--)
+			{
+				right.add(bins[i].minp, bins[i].maxp);
+				right.count += bins[i].count;
+
+				rightArea[i] = right.half_area();
+				rightCount[i] = right.count;
+			}
+
+			bin left;
+
+			for(unsigned i = 0; i < BIN_COUNT - 1; i++)
+			{
+				left.add(bins[i].minp, bins[i].maxp);
+				left.count += bins[i].count;
+
+				if(!left.count || !rightCount[i + 1])
+					continue;
+
+				float cost = left.half_area() * left.count + rightArea[i + 1] * rightCount[i + 1];
+
+				if(cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = i + 1;
+				}
+			}
+		}
+
+		unsigned leftCount = 0;
+
+		if(bestAxis >= 0)
+		{
+			// Splitting (with the cost of visiting a node taken as one primitive test) has to be cheaper than testing all primitives
+			if(count <= maxLeafSize && bestCost + bounds.half_area() >= bounds.half_area() * count)
+				return;
+
+			float axisMin = (&centroidBounds.minp.x)[bestAxis];
+			float scale = float(BIN_COUNT) / (&extent.x)[bestAxis];
+
+			unsigned i = first;
+			unsigned j = first + count;
+
+			while(i < j)
+			{
+				if(bin_index((&centroid[indices[i]].x)[bestAxis], axisMin, scale) < bestSplit)
+				{
+					i++;
+				}
+				else
+				{
+					j--;
+
+					unsigned tmp = indices[i];
+					indices[i] = indices[j];
+					indices[j] = tmp;
+				}
+			}
+
+			leftCount = i - first;
+		}
+		else
+		{
+			// All centroids are at the same point
+			if(count <= maxLeafSize)
+				return;
+
+			leftCount = count / 2;
+		}
+
+		unsigned left = unsigned(nodes.size());
+		nodes.push_back(bvh_node());
+
+		build_node(left, first, leftCount, maxLeafSize, depth + 1, pmin, pmax, centroid);
+
+		unsigned right = unsigned(nodes.size());
+		nodes.push_back(bvh_node());
+
+		nodes[nodeIndex].first = right;
+		nodes[nodeIndex].count = 0;
+
+		build_node(right, first + leftCount, count - leftCount, maxLeafSize, depth + 1, pmin, pmax, centroid);
+	}
+
+	static unsigned bin_index(float value, float axisMin, float scale)
+	{
+		int index = int((value - axisMin) * scale);
+
+		return index < 0 ? 0 : (index >= BIN_COUNT ? BIN_COUNT - 1 : unsigned(index));
+	}
+};
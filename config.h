@@ -0,0 +1,111 @@
+#pragma once
+
+/********************************************************************************/
+/*								Configuration									*/
+/********************************************************************************/
+
+// Define before including any of the headers (or pass to the compiler) to change the library behavior
+//
+// SIMPLEMATH_SIMD	- use SSE4.1/AVX implementations of vec4, mat4 and quat operations
+//					  vec4, mat4 and quat become 16-byte aligned in this mode
+//					  Instruction sets are taken from the compiler settings (-msse4.1, -mavx, /arch:AVX, etc.)
+//					  When the compiler doesn't target SSE4.1, scalar code is used and the results are the same
+//					  Batch functions additionally use AVX2 and AVX-512 when they are enabled (-mavx2, -mavx512f, /arch:AVX2, /arch:AVX512)
+//					  Half precision unpacking uses F16C instructions when they are enabled (-mf16c, /arch:AVX2)
+//
+// SIMPLEMATH_FAST_MATH	- use approximations from fastmath.h instead of libm in normalization (rsqrt with a Newton step),
+//						  rotations (polynomial sincos) and quaternion slerp/set_from_direction (polynomial acos)
+//						  Error bounds are listed in fastmath.h, 'simplemath_bench --errors' measures them
+//
+// SIMPLEMATH_FMA	- use fused multiply-add (a * b + c with a single rounding) in vec2/vec3 dot and cross products, mat4 multiplication and plane distances
+//					  Frustum tests then get the same plane distances on every platform, results are different from the default mode
+//					  Build with -mfma or /arch:AVX2, otherwise fmaf is a slow library call
+//					  SIMPLEMATH_SIMD builds have to target FMA instructions
+//
+// Constructors and arithmetic of vectors, matrices and quaternions are constexpr in C++14 and later
+// With SIMPLEMATH_SIMD, functions that have SSE/AVX paths are constexpr only if the compiler can detect constant evaluation (C++20, GCC 9+, Clang 9+)
+
+#if defined(SIMPLEMATH_SIMD)
+	#if defined(__SSE4_1__) || defined(__AVX__)
+		#define SIMPLEMATH_SSE41
+	#endif
+
+	#if defined(__AVX__)
+		#define SIMPLEMATH_AVX
+	#endif
+
+	#if defined(__AVX2__)
+		#define SIMPLEMATH_AVX2
+	#endif
+
+	#if defined(__AVX512F__)
+		#define SIMPLEMATH_AVX512
+	#endif
+
+	#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+		#define SIMPLEMATH_F16C
+	#endif
+
+	#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+		#define SIMPLEMATH_FMA3
+	#endif
+#endif
+
+// SSE and AVX paths would have to round the products separately
+#if defined(SIMPLEMATH_FMA) && defined(SIMPLEMATH_SSE41) && !defined(SIMPLEMATH_FMA3)
+	#error SIMPLEMATH_FMA with SIMPLEMATH_SIMD requires FMA instructions (-mfma, /arch:AVX2)
+#endif
+
+#if defined(SIMPLEMATH_AVX) || defined(SIMPLEMATH_F16C) || defined(SIMPLEMATH_FMA3)
+	#include <immintrin.h>
+#elif defined(SIMPLEMATH_SSE41)
+	#include <smmintrin.h>
+#endif
+
+// a * b + c in SSE/AVX registers, fused with SIMPLEMATH_FMA
+// Shared by all matrix products, so that mat4 and affine3x4 results stay the same
+#if defined(SIMPLEMATH_FMA)
+	#define SIMPLEMATH_MUL_ADD_128(a, b, c) _mm_fmadd_ps(a, b, c)
+	#define SIMPLEMATH_MUL_ADD_256(a, b, c) _mm256_fmadd_ps(a, b, c)
+#else
+	#define SIMPLEMATH_MUL_ADD_128(a, b, c) _mm_add_ps(c, _mm_mul_ps(a, b))
+	#define SIMPLEMATH_MUL_ADD_256(a, b, c) _mm256_add_ps(c, _mm256_mul_ps(a, b))
+#endif
+
+#if defined(SIMPLEMATH_SSE41)
+	#define SIMPLEMATH_ALIGN16 alignas(16)
+#else
+	#define SIMPLEMATH_ALIGN16
+#endif
+
+#if __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+	#define SIMPLEMATH_CONSTEXPR constexpr
+#else
+	#define SIMPLEMATH_CONSTEXPR
+#endif
+
+// SIMD paths are skipped during constant evaluation
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+	#include <type_traits>
+
+	#define SIMPLEMATH_CONSTANT_EVALUATED() std::is_constant_evaluated()
+#elif __cplusplus < 201402L && !(defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+	// Nothing is evaluated at compile time before C++14
+#elif defined(__has_builtin)
+	#if __has_builtin(__builtin_is_constant_evaluated)
+		#define SIMPLEMATH_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+	#endif
+#elif defined(__GNUC__) && __GNUC__ >= 9
+	#define SIMPLEMATH_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+
+// Used on functions with SIMD paths
+#if !defined(SIMPLEMATH_SSE41) || defined(SIMPLEMATH_CONSTANT_EVALUATED)
+	#define SIMPLEMATH_CONSTEXPR_SIMD SIMPLEMATH_CONSTEXPR
+#else
+	#define SIMPLEMATH_CONSTEXPR_SIMD
+#endif
+
+#if !defined(SIMPLEMATH_CONSTANT_EVALUATED)
+	#define SIMPLEMATH_CONSTANT_EVALUATED() false
+#endif
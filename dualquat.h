@@ -0,0 +1,110 @@
+#pragma once
+
+#include <math.h>
+
+#include "vector.h"
+#include "matrix.h"
+#include "quat.h"
+
+/********************************************************************************/
+/*								dualquat										*/
+/********************************************************************************/
+
+// Rigid transformation: rotation 'real' followed by translation t, stored as dual = 0.5 * t * real
+// 32 bytes instead of 64 for mat4, and blended transforms stay rigid after the normalization
+struct dualquat
+{
+	SIMPLEMATH_CONSTEXPR dualquat(): real(), dual(0.0f, 0.0f, 0.0f, 0.0f)
+	{
+	}
+
+	SIMPLEMATH_CONSTEXPR dualquat(const quat& real, const quat& dual): real(real), dual(dual)
+	{
+	}
+
+	// 'rotation' has to be a unit quaternion
+	SIMPLEMATH_CONSTEXPR dualquat(const quat& rotation, const vec3& translation): real(rotation), dual()
+	{
+		dual.x = 0.5f * (translation.x * rotation.w + translation.y * rotation.z - translation.z * rotation.y);
+		dual.y = 0.5f * (translation.y * rotation.w + translation.z * rotation.x - translation.x * rotation.z);
+		dual.z = 0.5f * (translation.z * rotation.w + translation.x * rotation.y - translation.y * rotation.x);
+		dual.w = -0.5f * (translation.x * rotation.x + translation.y * rotation.y + translation.z * rotation.z);
+	}
+
+	explicit dualquat(uninitialized_tag): real(uninitialized), dual(uninitialized)
+	{
+	}
+
+	// Transformation 'q' followed by this one
+	dualquat operator*(const dualquat& q) const
+	{
+		quat a = real * q.dual;
+		quat b = dual * q.real;
+
+		return dualquat(real * q.real, quat(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w));
+	}
+
+	// Weighted sums of unit dual quaternions are turned back into rigid transformations
+	// Same scale factor as in each lane of skin_dualquat
+	void normalize()
+	{
+#if defined(SIMPLEMATH_FAST_MATH)
+		float magn = fast_rsqrt(real.x * real.x + real.y * real.y + real.z * real.z + real.w * real.w);
+#else
+		float magn = 1.0f / sqrtf(real.x * real.x + real.y * real.y + real.z * real.z + real.w * real.w);
+#endif
+
+		real.x *= magn; real.y *= magn; real.z *= magn; real.w *= magn;
+		dual.x *= magn; dual.y *= magn; dual.z *= magn; dual.w *= magn;
+	}
+
+	SIMPLEMATH_CONSTEXPR dualquat conjugate() const
+	{
+		return dualquat(quat(-real.x, -real.y, -real.z, real.w), quat(-dual.x, -dual.y, -dual.z, dual.w));
+	}
+
+	// Translation part, 2 * dual * conjugate(real)
+	SIMPLEMATH_CONSTEXPR vec3 translation() const
+	{
+		return vec3(2.0f * (real.w * dual.x - dual.w * real.x + real.y * dual.z - real.z * dual.y),
+					2.0f * (real.w * dual.y - dual.w * real.y + real.z * dual.x - real.x * dual.z),
+					2.0f * (real.w * dual.z - dual.w * real.z + real.x * dual.y - real.y * dual.x));
+	}
+
+	// Rotation only
+	SIMPLEMATH_CONSTEXPR vec3 transform_vector(const vec3& v) const
+	{
+		vec3 uv(real.y * v.z - real.z * v.y + real.w * v.x,
+				real.z * v.x - real.x * v.z + real.w * v.y,
+				real.x * v.y - real.y * v.x + real.w * v.z);
+
+		vec3 uuv(real.y * uv.z - real.z * uv.y,
+				 real.z * uv.x - real.x * uv.z,
+				 real.x * uv.y - real.y * uv.x);
+
+		return v + uuv * 2.0f;
+	}
+
+	SIMPLEMATH_CONSTEXPR vec3 transform_point(const vec3& v) const
+	{
+		return transform_vector(v) + translation();
+	}
+
+	SIMPLEMATH_CONSTEXPR mat4 to_matrix() const
+	{
+		mat4 ret(real.to_matrix());
+
+		vec3 t = translation();
+
+		ret.mat[12] = t.x;
+		ret.mat[13] = t.y;
+		ret.mat[14] = t.z;
+
+		return ret;
+	}
+
+	quat real;
+	quat dual;
+};
+
+SIMPLEMATH_ASSERT_PLAIN_TYPE(dualquat, 32);
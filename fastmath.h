@@ -0,0 +1,118 @@
+#pragma once
+
+#include <math.h>
+#include <string.h>
+
+#include "config.h"
+
+// Approximations used by the library functions when SIMPLEMATH_FAST_MATH is defined
+// They are always available, so the results can be compared with the libm versions
+//
+// Measured errors against the float libm functions:
+//	fast_rsqrt	- 3 ulp (rsqrtss and a Newton step), exact without SSE
+//	fast_sincos	- 1.2e-7 absolute (2 ulp) for |x| < 100, 9.6e-7 absolute for |x| < 1e5, accuracy is lost at larger values
+//	fast_acos	- 4.8e-7 absolute (3 ulp)
+
+/********************************************************************************/
+/*								Fast functions									*/
+/********************************************************************************/
+
+// 1 / sqrt(x) for x > 0
+inline float fast_rsqrt(float x)
+{
+#if defined(SIMPLEMATH_SSE41)
+	float r = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+
+	return r * (1.5f - 0.5f * x * r * r);
+#else
+	// Software estimates need more refinement steps than a division and a hardware square root take
+	return 1.0f / sqrtf(x);
+#endif
+}
+
+// Sine and cosine from the same range reduction, without branches
+inline void fast_sincos(float x, float &s, float &c)
+{
+	// Nearest multiple of pi/2, the quadrant selects the polynomial and the sign
+	float q = x * 0.636619772f;
+
+#if defined(__FAST_MATH__)
+	int quadrant = int(q + (q >= 0.0f ? 0.5f : -0.5f));
+
+	float j = float(quadrant);
+#else
+	// Adding 1.5 * 2^23 rounds to an integer that ends up in the low bits of the mantissa, it avoids slow conversions
+	float rounded = q + 12582912.0f;
+	float j = rounded - 12582912.0f;
+
+	int quadrant;
+	memcpy(&quadrant, &rounded, 4);
+#endif
+
+	// pi/2 is split in three parts, products with the first two are exact
+	float r = ((x - j * 1.5703125f) - j * 4.837512969970703125e-4f) - j * 7.54978995489188216e-8f;
+	float r2 = r * r;
+
+	// Polynomials for [-pi/4, pi/4] from Cephes
+	float sr = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+	float cr = 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+
+	// Odd quadrants swap the functions, sine is negative in quadrants 2 and 3, cosine in 1 and 2
+	bool swap = (quadrant & 1) != 0;
+
+	float sv = swap ? cr : sr;
+	float cv = swap ? sr : cr;
+
+	unsigned sinBits, cosBits;
+	memcpy(&sinBits, &sv, 4);
+	memcpy(&cosBits, &cv, 4);
+
+	sinBits ^= unsigned(quadrant & 2) << 30;
+	cosBits ^= unsigned((quadrant + 1) & 2) << 30;
+
+	memcpy(&s, &sinBits, 4);
+	memcpy(&c, &cosBits, 4);
+}
+
+inline float fast_sin(float x)
+{
+	float s, c;
+	fast_sincos(x, s, c);
+	return s;
+}
+
+inline float fast_cos(float x)
+{
+	float s, c;
+	fast_sincos(x, s, c);
+	return c;
+}
+
+// Input is clamped to [-1, 1]
+inline float fast_acos(float x)
+{
+	float a = x < 0.0f ? -x : x;
+
+	a = a < 1.0f ? a : 1.0f;
+
+	// Abramowitz and Stegun 4.4.46
+	float p = 1.5707963050f + a * (-0.2145988016f + a * (0.0889789874f + a * (-0.0501743046f + a * (0.0308918810f + a * (-0.0170881256f + a * (0.0066700901f + a * -0.0012624911f))))));
+	float r = sqrtf(1.0f - a) * p;
+
+	return x < 0.0f ? 3.14159265f - r : r;
+}
+
+/********************************************************************************/
+/*								Mode selection									*/
+/********************************************************************************/
+
+// Sine and cosine for the rotation functions, fast_sincos in SIMPLEMATH_FAST_MATH mode and the libm functions otherwise
+inline void math_sincos(float x, float &s, float &c)
+{
+#if defined(SIMPLEMATH_FAST_MATH)
+	fast_sincos(x, s, c);
+#else
+	s = sinf(x);
+	c = cosf(x);
+#endif
+}
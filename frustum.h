@@ -2,6 +2,7 @@
 
 #include "plane.h"
 #include "aabb.h"
+#include "soa.h"
 
 struct frustum
 {
@@ -15,24 +16,28 @@ struct frustum
 		PLANE_FAR
 	};
 
+	// Results of the tri-state tests
+	enum
+	{
+		CULL_OUTSIDE,
+		CULL_INTERSECT,
+		CULL_INSIDE
+	};
+
+	enum
+	{
+		PLANE_MASK_ALL = 0x3f
+	};
+
 	void calculate_points(const mat4& viewProjection, float minz = 0.0f)
 	{
 		mat4 m = viewProjection.inverse();
 
-		vec3	minp(-1.0, -1.0, minz);
-		vec3	maxp(1.0, 1.0, 1.0);
-
-		pt[0] = vec3(minp.x, minp.y, minp.z);
-		pt[1] = vec3(maxp.x, minp.y, minp.z);
-		pt[2] = vec3(minp.x, maxp.y, minp.z);
-		pt[3] = vec3(maxp.x, maxp.y, minp.z);
-		pt[4] = vec3(minp.x, minp.y, maxp.z);
-		pt[5] = vec3(maxp.x, minp.y, maxp.z);
-		pt[6] = vec3(minp.x, maxp.y, maxp.z);
-		pt[7] = vec3(maxp.x, maxp.y, maxp.z);
+		// NDC corners of the near and far faces
+		const float corners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { -1.0f, 1.0f }, { 1.0f, 1.0f } };
 
 		for(int i = 0; i < 8; i++)
-			pt[i] = m * pt[i];
+			pt[i] = m * vec3(corners[i & 3][0], corners[i & 3][1], i < 4 ? minz : 1.0f);
 	}
 
 	void calculate_planes(const mat4& viewProjection)
@@ -57,7 +62,7 @@ struct frustum
 	{
 		for(int i = 0; i < 6; i++)
 		{
-			if(pos.x * p[i].pl.x + pos.y * p[i].pl.y + pos.z * p[i].pl.z + p[i].pl.w <= 0.0f)
+			if(dot(pos, p[i].pl) <= 0.0f)
 				return false;
 		}
 
@@ -68,7 +73,7 @@ struct frustum
 	{
 		for(int i = 0; i < 6; i++)
 		{
-			if(pos.x * p[i].pl.x + pos.y * p[i].pl.y + pos.z * p[i].pl.z + p[i].pl.w <= 0.0f)
+			if(dot(pos.xyz(), p[i].pl) <= 0.0f)
 				return false;
 		}
 
@@ -79,7 +84,7 @@ struct frustum
 	{
 		for(int i = 0; i < 6; i++)
 		{
-			if(pos.x * p[i].pl.x + pos.y * p[i].pl.y + pos.z * p[i].pl.z + p[i].pl.w <= 0.0f)
+			if(dot(pos, p[i].pl) <= 0.0f)
 				return i;
 		}
 
@@ -90,7 +95,7 @@ struct frustum
 	{
 		for(int i = 0; i < 6; i++)
 		{
-			if(pos.x * p[i].pl.x + pos.y * p[i].pl.y + pos.z * p[i].pl.z + p[i].pl.w <= 0.0f)
+			if(dot(pos.xyz(), p[i].pl) <= 0.0f)
 				return i;
 		}
 
@@ -101,13 +106,127 @@ struct frustum
 	{
 		for(int i = 0; i < 6; i++)
 		{
-			if(pos.x * p[i].pl.x + pos.y * p[i].pl.y + pos.z * p[i].pl.z + p[i].pl.w <= -radius)
+			if(dot(pos, p[i].pl) <= -radius)
+				return false;
+		}
+
+		return true;
+	}
+
+	// Temporal coherence
+	// Objects that were culled in the last frame are usually culled by the same plane in the next one
+	// 'lastPlane' is stored with each object (initialized to 0), the plane it refers to is tested first and it is updated when another plane rejects the object
+	// Results are the same as the tests without the cached plane
+
+	bool sphere_inside(const vec3& pos, float radius, unsigned char& lastPlane) const
+	{
+		if(sphere_outside_plane(pos, radius, lastPlane))
+			return false;
+
+		for(int i = 0; i < 6; i++)
+		{
+			if(i != lastPlane && sphere_outside_plane(pos, radius, i))
+			{
+				lastPlane = (unsigned char)i;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool aabb_inside(const aabb& box, unsigned char& lastPlane) const
+	{
+		float points[8][3];
+		aabb_points(box, points);
+
+		if(points_outside_plane(points, lastPlane))
+			return false;
+
+		for(int i = 0; i < 6; i++)
+		{
+			if(i != lastPlane && points_outside_plane(points, i))
+			{
+				lastPlane = (unsigned char)i;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool aabb_inside_radius(const aabb& box, unsigned char& lastPlane) const
+	{
+		if(aabb_outside_plane(box, lastPlane))
+			return false;
+
+		for(int i = 0; i < 6; i++)
+		{
+			if(i != lastPlane && aabb_outside_plane(box, i))
+			{
+				lastPlane = (unsigned char)i;
 				return false;
+			}
 		}
 
 		return true;
 	}
 
+	// Tri-state tests for hierarchies
+	// Bit i of 'planeMask' is set if the plane i has to be tested, the root of a hierarchy starts with PLANE_MASK_ALL
+	// Planes that the volume is fully inside of are removed from the mask, it is then passed to the children of the volume
+	// With CULL_INSIDE the mask becomes 0 and the children don't need to be tested, with CULL_OUTSIDE the mask is not changed
+	// Bounds of the children have to be inside of the parent bounds, results match sphere_inside and aabb_inside_radius up to rounding
+
+	int sphere_classify(const vec3& pos, float radius, unsigned& planeMask) const
+	{
+		unsigned mask = planeMask;
+
+		for(int i = 0; i < 6; i++)
+		{
+			if(!(mask & (1u << i)))
+				continue;
+
+			float dist = dot(pos, p[i].pl);
+
+			if(dist <= -radius)
+				return CULL_OUTSIDE;
+
+			if(dist > radius)
+				mask &= ~(1u << i);
+		}
+
+		planeMask = mask;
+
+		return mask ? CULL_INTERSECT : CULL_INSIDE;
+	}
+
+	int aabb_classify(const aabb& box, unsigned& planeMask) const
+	{
+		unsigned mask = planeMask;
+
+		for(int i = 0; i < 6; i++)
+		{
+			if(!(mask & (1u << i)))
+				continue;
+
+			const vec4 &pl = p[i].pl;
+
+			float dist = dot(box.center, pl);
+			float radius = dot(box.size, vec3(fabsf(pl.x), fabsf(pl.y), fabsf(pl.z)));
+
+			if(!(dist + radius > 0.0f))
+				return CULL_OUTSIDE;
+
+			if(dist - radius > 0.0f)
+				mask &= ~(1u << i);
+		}
+
+		planeMask = mask;
+
+		return mask ? CULL_INTERSECT : CULL_INSIDE;
+	}
+
 	bool sprite_inside(const vec3& p1, const vec3& p2, const vec3& p3, const vec3& p4)
 	{
 		for(int i = 0; i < 6; i++)
@@ -132,48 +251,151 @@ struct frustum
 
 	bool aabb_inside(const aabb& box)
 	{
-		float minX = box.center.x - box.size.x;
-		float minY = box.center.y - box.size.y;
-		float minZ = box.center.z - box.size.z;
+		float points[8][3];
+		aabb_points(box, points);
 
-		float maxX = box.center.x + box.size.x;
-		float maxY = box.center.y + box.size.y;
-		float maxZ = box.center.z + box.size.z;
+		for(int i = 0; i < 6; i++)
+		{
+			if(points_outside_plane(points, i))
+				return false;
+		}
 
-		// Get aabb points
-		float points[][3] =
+		return true;
+	}
+
+	// Batch visibility tests
+	// A box is outside of a plane if the distance from its center is below the box extent projected on the plane normal
+	// This is the same condition as "all corners are outside" in aabb_inside, up to rounding
+	// 'boxes' can point to aabb members of larger structures, 'stride' is the distance between them in bytes
+
+	// Bit (i % 32) of mask[i / 32] is set if boxes[i] is visible
+	void aabb_inside_mask(const aabb* boxes, unsigned count, unsigned* mask, unsigned stride = sizeof(aabb)) const
+	{
+		for(unsigned i = 0; i < (count + 31) / 32; i++)
+			mask[i] = 0;
+
+		unsigned i = 0;
+
+		for(; i + 8 <= count; i += 8)
+			mask[i / 32] |= unsigned(aabb_inside_x8((const aabb*)((const char*)boxes + i * stride), stride)) << (i % 32);
+
+		for(; i < count; i++)
 		{
-			{ minX, minY, minZ },
-			{ maxX, minY, minZ },
-			{ maxX, maxY, minZ },
-			{ minX, maxY, minZ },
+			if(aabb_inside_radius(*(const aabb*)((const char*)boxes + i * stride)))
+				mask[i / 32] |= 1u << (i % 32);
+		}
+	}
 
-			{ minX, minY, maxZ },
-			{ maxX, minY, maxZ },
-			{ maxX, maxY, maxZ },
-			{ minX, maxY, maxZ }
-		};
+	// Indices of the visible boxes are written to 'visible', their number is returned
+	unsigned aabb_inside_indices(const aabb* boxes, unsigned count, unsigned* visible, unsigned stride = sizeof(aabb)) const
+	{
+		unsigned visibleCount = 0;
 
-		for(int i = 0; i < 6; i++)
+		unsigned i = 0;
+
+		for(; i + 8 <= count; i += 8)
 		{
-			bool inside = false;
+			unsigned bits = aabb_inside_x8((const aabb*)((const char*)boxes + i * stride), stride);
 
-			for(int j = 0; j < 8; j++)
+			for(unsigned k = 0; bits; k++, bits >>= 1)
 			{
-				if(points[j][0] * p[i].pl.x + points[j][1] * p[i].pl.y + points[j][2] * p[i].pl.z + p[i].pl.w > 0)
-				{
-					inside = true;
-					break;
-				}
+				if(bits & 1)
+					visible[visibleCount++] = i + k;
 			}
+		}
 
-			if(!inside)
+		for(; i < count; i++)
+		{
+			if(aabb_inside_radius(*(const aabb*)((const char*)boxes + i * stride)))
+				visible[visibleCount++] = i;
+		}
+
+		return visibleCount;
+	}
+
+	// Tests 8 boxes, bit k of the result is set if the box k is visible
+	int aabb_inside_x8(const aabb* boxes, unsigned stride = sizeof(aabb)) const
+	{
+		vec3x8 center = load_vec3x8(&boxes->center, stride);
+		vec3x8 size = load_vec3x8(&boxes->size, stride);
+
+		floatx8 visible = floatx8(0.0f) == floatx8(0.0f);
+
+		for(int i = 0; i < 6; i++)
+		{
+			const vec4 &pl = p[i].pl;
+
+			floatx8 dist = dot(center, pl);
+			floatx8 radius = dot(size, vec3x8(vec3(fabsf(pl.x), fabsf(pl.y), fabsf(pl.z))));
+
+			visible = visible & (dist + radius > floatx8(0.0f));
+
+			if(!visible.mask())
+				return 0;
+		}
+
+		return visible.mask();
+	}
+
+	// Same test as aabb_inside_x8 for a single box
+	bool aabb_inside_radius(const aabb& box) const
+	{
+		for(int i = 0; i < 6; i++)
+		{
+			if(aabb_outside_plane(box, i))
 				return false;
 		}
 
 		return true;
 	}
 
+	// Single plane tests
+	bool sphere_outside_plane(const vec3& pos, float radius, int i) const
+	{
+		return dot(pos, p[i].pl) <= -radius;
+	}
+
+	bool aabb_outside_plane(const aabb& box, int i) const
+	{
+		const vec4 &pl = p[i].pl;
+
+		float dist = dot(box.center, pl);
+		float radius = dot(box.size, vec3(fabsf(pl.x), fabsf(pl.y), fabsf(pl.z)));
+
+		return !(dist + radius > 0.0f);
+	}
+
+	// All points are outside
+	bool points_outside_plane(const float points[8][3], int i) const
+	{
+		for(int j = 0; j < 8; j++)
+		{
+			if(dot(vec3(points[j][0], points[j][1], points[j][2]), p[i].pl) > 0)
+				return false;
+		}
+
+		return true;
+	}
+
+	static void aabb_points(const aabb& box, float points[8][3])
+	{
+		float minX = box.center.x - box.size.x;
+		float minY = box.center.y - box.size.y;
+		float minZ = box.center.z - box.size.z;
+
+		float maxX = box.center.x + box.size.x;
+		float maxY = box.center.y + box.size.y;
+		float maxZ = box.center.z + box.size.z;
+
+		// Bottom face quad, then the top face quad
+		for(int j = 0; j < 8; j++)
+		{
+			points[j][0] = ((j + 1) & 2) ? maxX : minX;
+			points[j][1] = (j & 2) ? maxY : minY;
+			points[j][2] = (j & 4) ? maxZ : minZ;
+		}
+	}
+
 	vec3 pt[8];
 	plane p[6];
 };
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <vector>
+
+#include "matrix.h"
+#include "aabb.h"
+
+/********************************************************************************/
+/*								transform_hierarchy								*/
+/********************************************************************************/
+
+// Scene nodes with local transforms that are composed into world transforms and world bounds
+// Nodes are stored in flat arrays where a parent always has a smaller index than its children
+// Only the nodes that were changed since the last update and their descendants are recomputed
+// 'world' and 'worldBounds' are contiguous and can be passed to the batch culling functions directly
+struct transform_hierarchy
+{
+	transform_hierarchy(): firstDirty(~0u), maxDepth(0)
+	{
+	}
+
+	void clear()
+	{
+		parents.clear();
+		depths.clear();
+		dirty.clear();
+		local.clear();
+		localBounds.clear();
+		world.clear();
+		worldBounds.clear();
+		updates.clear();
+		levels.clear();
+
+		firstDirty = ~0u;
+		maxDepth = 0;
+	}
+
+	void reserve(unsigned count)
+	{
+		parents.reserve(count);
+		depths.reserve(count);
+		dirty.reserve(count);
+		local.reserve(count);
+		localBounds.reserve(count);
+		world.reserve(count);
+		worldBounds.reserve(count);
+		updates.reserve(count);
+	}
+
+	unsigned size() const
+	{
+		return unsigned(local.size());
+	}
+
+	// 'parent' is ~0u for root nodes, otherwise an index of an already added node
+	// 'bounds' are in the local space of the node
+	unsigned add(unsigned parent, const mat4& transform, const aabb& bounds = aabb())
+	{
+		unsigned index = unsigned(local.size());
+		unsigned depth = parent == ~0u ? 0 : depths[parent] + 1;
+
+		parents.push_back(parent);
+		depths.push_back(depth);
+		dirty.push_back(1);
+		local.push_back(transform);
+		localBounds.push_back(bounds);
+		world.push_back(transform);
+		worldBounds.push_back(bounds);
+
+		if(depth > maxDepth)
+			maxDepth = depth;
+
+		if(index < firstDirty)
+			firstDirty = index;
+
+		return index;
+	}
+
+	void set_local(unsigned node, const mat4& transform)
+	{
+		local[node] = transform;
+
+		mark_dirty(node);
+	}
+
+	void set_bounds(unsigned node, const aabb& bounds)
+	{
+		localBounds[node] = bounds;
+
+		mark_dirty(node);
+	}
+
+	void mark_dirty(unsigned node)
+	{
+		dirty[node] = 1;
+
+		if(node < firstDirty)
+			firstDirty = node;
+	}
+
+	// Reorders the nodes by depth, so that the nodes of a level are next to each other in memory
+	// Levels are updated one after another by parallel_update, without this the level passes jump over the whole arrays
+	// The node at index i is moved to remap[i], 'remap' must have space for size() indices
+	void sort_by_depth(unsigned* remap)
+	{
+		unsigned count = unsigned(parents.size());
+
+		std::vector<unsigned> position(maxDepth + 2, 0);
+
+		for(unsigned i = 0; i < count; i++)
+			position[depths[i] + 1]++;
+
+		for(unsigned i = 1; i < position.size(); i++)
+			position[i] += position[i - 1];
+
+		for(unsigned i = 0; i < count; i++)
+			remap[i] = position[depths[i]]++;
+
+		std::vector<unsigned> newParents(count);
+		std::vector<unsigned> newDepths(count);
+		std::vector<unsigned char> newDirty(count);
+		std::vector<mat4> newLocal(count);
+		std::vector<aabb> newLocalBounds(count);
+		std::vector<mat4> newWorld(count);
+		std::vector<aabb> newWorldBounds(count);
+
+		firstDirty = ~0u;
+
+		for(unsigned i = 0; i < count; i++)
+		{
+			unsigned target = remap[i];
+
+			newParents[target] = parents[i] == ~0u ? ~0u : remap[parents[i]];
+			newDepths[target] = depths[i];
+			newDirty[target] = dirty[i];
+			newLocal[target] = local[i];
+			newLocalBounds[target] = localBounds[i];
+			newWorld[target] = world[i];
+			newWorldBounds[target] = worldBounds[i];
+
+			if(dirty[i] && target < firstDirty)
+				firstDirty = target;
+		}
+
+		parents.swap(newParents);
+		depths.swap(newDepths);
+		dirty.swap(newDirty);
+		local.swap(newLocal);
+		localBounds.swap(newLocalBounds);
+		world.swap(newWorld);
+		worldBounds.swap(newWorldBounds);
+	}
+
+	// Recomputes world transforms and bounds of the changed nodes and their descendants
+	void update()
+	{
+		collect_updates(false);
+
+		update_nodes(0, unsigned(updates.size()));
+	}
+
+	// Fills 'updates' with the nodes that have to be recomputed and clears the dirty flags
+	// Parents come before their children, with 'byLevel' the nodes are also grouped by depth in 'levels'
+	// Nodes of the same level don't depend on each other and can be updated in parallel
+	void collect_updates(bool byLevel)
+	{
+		updates.clear();
+		levels.clear();
+
+		if(firstDirty == ~0u)
+			return;
+
+		unsigned count = unsigned(parents.size());
+
+		// Nodes before the first changed node can't be affected
+		for(unsigned i = firstDirty; i < count; i++)
+		{
+			unsigned parent = parents[i];
+
+			if(dirty[i] || (parent != ~0u && dirty[parent]))
+			{
+				dirty[i] = 1;
+
+				updates.push_back(i);
+			}
+		}
+
+		for(unsigned i = 0; i < updates.size(); i++)
+			dirty[updates[i]] = 0;
+
+		firstDirty = ~0u;
+
+		if(!byLevel)
+			return;
+
+		// Counting sort by depth keeps the index order inside of a level
+		levels.resize(maxDepth + 2, 0);
+
+		for(unsigned i = 0; i < updates.size(); i++)
+			levels[depths[updates[i]] + 1]++;
+
+		for(unsigned i = 1; i < levels.size(); i++)
+			levels[i] += levels[i - 1];
+
+		std::vector<unsigned> sorted(updates.size());
+		std::vector<unsigned> position(levels.begin(), levels.end() - 1);
+
+		for(unsigned i = 0; i < updates.size(); i++)
+			sorted[position[depths[updates[i]]]++] = updates[i];
+
+		updates.swap(sorted);
+	}
+
+	// Recomputes the nodes updates[first] to updates[last - 1], parents have to be up to date
+	void update_nodes(unsigned first, unsigned last)
+	{
+		for(unsigned k = first; k < last; k++)
+		{
+			unsigned i = updates[k];
+			unsigned parent = parents[i];
+
+			if(parent == ~0u)
+				world[i] = local[i];
+			else
+				mul(world[i], world[parent], local[i]);
+
+			aabb box = localBounds[i];
+			box.mul(world[i]);
+			worldBounds[i] = box;
+		}
+	}
+
+	std::vector<unsigned> parents;
+	std::vector<unsigned> depths;
+	std::vector<unsigned char> dirty;
+
+	std::vector<mat4> local;
+	std::vector<aabb> localBounds;
+
+	std::vector<mat4> world;
+	std::vector<aabb> worldBounds;
+
+	std::vector<unsigned> updates;	// Nodes recomputed by the last update
+	std::vector<unsigned> levels;	// Level i is updates[levels[i]] to updates[levels[i + 1] - 1], filled by collect_updates(true)
+
+private:
+	unsigned firstDirty;
+	unsigned maxDepth;
+};
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/********************************************************************************/
+/*								job_pool										*/
+/********************************************************************************/
+
+// Thread pool for data-parallel loops
+// Chunks of a loop are split evenly between the threads, a thread that runs out of its chunks steals from the end of the other queues
+struct job_pool
+{
+	// Thread count includes the calling thread, 0 selects the number of hardware threads
+	explicit job_pool(unsigned threadCount = 0): queues(threadCount ? threadCount : (std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1))
+	{
+		invoke = 0;
+		context = 0;
+		count = 0;
+		chunkSize = 0;
+
+		generation = 0;
+		active = 0;
+		stop = false;
+
+		remaining = 0;
+
+		for(unsigned i = 1; i < queues.size(); i++)
+			workers.push_back(std::thread(&job_pool::worker, this, i));
+	}
+
+	~job_pool()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+
+			stop = true;
+		}
+
+		wake.notify_all();
+
+		for(unsigned i = 0; i < workers.size(); i++)
+			workers[i].join();
+	}
+
+	unsigned thread_count() const
+	{
+		return unsigned(queues.size());
+	}
+
+	// Calls body(begin, end) for every chunk of [0, count), the calling thread takes part in the work
+	// Chunks start at multiples of 'chunkSize' and can run in any order, the function returns when all of them are complete
+	// Loops can't be started from inside of the body
+	template<typename F>
+	void parallel_for(unsigned count, unsigned chunkSize, const F& body)
+	{
+		if(count == 0)
+			return;
+
+		unsigned chunkCount = (count + chunkSize - 1) / chunkSize;
+
+		if(queues.size() == 1 || chunkCount == 1)
+		{
+			for(unsigned begin = 0; begin < count; begin += chunkSize)
+				body(begin, count - begin < chunkSize ? count : begin + chunkSize);
+
+			return;
+		}
+
+		{
+			std::unique_lock<std::mutex> guard(lock);
+
+			// Workers that are late to the previous loop can still be looking at the queues
+			while(active != 0)
+				idle.wait(guard);
+
+			this->invoke = &job_pool::call<F>;
+			this->context = &body;
+			this->count = count;
+			this->chunkSize = chunkSize;
+
+			unsigned threadCount = unsigned(queues.size());
+
+			for(unsigned i = 0; i < threadCount; i++)
+			{
+				queues[i].first = unsigned((unsigned long long)chunkCount * i / threadCount);
+				queues[i].last = unsigned((unsigned long long)chunkCount * (i + 1) / threadCount);
+			}
+
+			remaining = chunkCount;
+
+			generation++;
+		}
+
+		wake.notify_all();
+
+		execute(0);
+
+		while(remaining.load() != 0)
+			std::this_thread::yield();
+	}
+
+private:
+	job_pool(const job_pool&);
+	job_pool& operator=(const job_pool&);
+
+	// Range of chunk indices, padded to keep the queues on separate cache lines
+	struct job_queue
+	{
+		job_queue()
+		{
+			first = 0;
+			last = 0;
+		}
+
+		std::mutex lock;
+
+		unsigned first;
+		unsigned last;
+
+		char padding[64];
+	};
+
+	template<typename F>
+	static void call(const void* context, unsigned begin, unsigned end)
+	{
+		(*(const F*)context)(begin, end);
+	}
+
+	bool pop_front(unsigned index, unsigned& chunk)
+	{
+		job_queue &queue = queues[index];
+
+		std::lock_guard<std::mutex> guard(queue.lock);
+
+		if(queue.first == queue.last)
+			return false;
+
+		chunk = queue.first++;
+		return true;
+	}
+
+	bool pop_back(unsigned index, unsigned& chunk)
+	{
+		job_queue &queue = queues[index];
+
+		std::lock_guard<std::mutex> guard(queue.lock);
+
+		if(queue.first == queue.last)
+			return false;
+
+		chunk = --queue.last;
+		return true;
+	}
+
+	void execute(unsigned index)
+	{
+		unsigned threadCount = unsigned(queues.size());
+
+		for(;;)
+		{
+			unsigned chunk;
+
+			// Own chunks are taken in order, they are next to each other in memory
+			bool found = pop_front(index, chunk);
+
+			for(unsigned i = 1; i < threadCount && !found; i++)
+				found = pop_back((index + i) % threadCount, chunk);
+
+			if(!found)
+				return;
+
+			unsigned begin = chunk * chunkSize;
+			unsigned end = count - begin < chunkSize ? count : begin + chunkSize;
+
+			invoke(context, begin, end);
+
+			remaining.fetch_sub(1);
+		}
+	}
+
+	void worker(unsigned index)
+	{
+		unsigned seen = 0;
+
+		for(;;)
+		{
+			{
+				std::unique_lock<std::mutex> guard(lock);
+
+				while(!stop && generation == seen)
+					wake.wait(guard);
+
+				if(stop)
+					return;
+
+				seen = generation;
+				active++;
+			}
+
+			execute(index);
+
+			{
+				std::lock_guard<std::mutex> guard(lock);
+
+				if(--active == 0)
+					idle.notify_one();
+			}
+		}
+	}
+
+	std::vector<job_queue> queues;
+	std::vector<std::thread> workers;
+
+	// Current loop, only changed when no worker is active
+	void (*invoke)(const void* context, unsigned begin, unsigned end);
+	const void *context;
+	unsigned count;
+	unsigned chunkSize;
+
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable idle;
+
+	unsigned generation;
+	unsigned active;
+	bool stop;
+
+	std::atomic<unsigned> remaining;
+};
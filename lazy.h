@@ -0,0 +1,244 @@
+#pragma once
+
+#include "vector.h"
+
+// Lazy vector expressions
+// lazy(v) wraps a vec3 or a vec4, operators with the wrapped value build an expression instead of a temporary vector
+// The expression is evaluated in a single pass when it's converted to vec3/vec4:
+//	vec3 p = lazy(pos) + lazy(vel) * dt + lazy(acc) * (0.5f * dt * dt);
+// Each component gets the same operations as with the vec3/vec4 operators, so the results are identical
+// Expressions keep references to the wrapped vectors, they have to be converted in the same statement (don't store them in 'auto' variables)
+
+// Expression functions are inlined in debug builds too, otherwise every component of every node is a function call
+#if defined(__GNUC__)
+	#define SIMPLEMATH_LAZY_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+	#define SIMPLEMATH_LAZY_INLINE __forceinline
+#else
+	#define SIMPLEMATH_LAZY_INLINE inline
+#endif
+
+/********************************************************************************/
+/*								Expression nodes								*/
+/********************************************************************************/
+
+template<unsigned N>
+struct lazy_vec_type;
+
+template<>
+struct lazy_vec_type<3>
+{
+	typedef vec3 type;
+};
+
+template<>
+struct lazy_vec_type<4>
+{
+	typedef vec4 type;
+};
+
+template<typename E>
+SIMPLEMATH_LAZY_INLINE vec3 lazy_evaluate(const E& e, const vec3*)
+{
+	return vec3(e.template get<0>(), e.template get<1>(), e.template get<2>());
+}
+
+template<typename E>
+SIMPLEMATH_LAZY_INLINE vec4 lazy_evaluate(const E& e, const vec4*)
+{
+#if defined(SIMPLEMATH_SSE41)
+	return vec4(e.simd());
+#else
+	return vec4(e.template get<0>(), e.template get<1>(), e.template get<2>(), e.template get<3>());
+#endif
+}
+
+// Base of all nodes, 'E' is the node type and 'N' is the number of components
+// Nodes provide get<I>() for component I and simd() for all four components of a vec4 expression in SIMPLEMATH_SIMD builds
+// 'stored' is the type used to keep the node as an operand: operations keep references to the temporaries of the same statement, leaves are copied
+template<typename E, unsigned N>
+struct lazy_expr
+{
+	typedef typename lazy_vec_type<N>::type vec_type;
+
+	SIMPLEMATH_LAZY_INLINE const E& self() const
+	{
+		return static_cast<const E&>(*this);
+	}
+
+	SIMPLEMATH_LAZY_INLINE operator vec_type() const
+	{
+		return lazy_evaluate(self(), (const vec_type*)0);
+	}
+};
+
+// Wrapped vector
+template<unsigned N>
+struct lazy_ref: lazy_expr<lazy_ref<N>, N>
+{
+	typedef typename lazy_vec_type<N>::type vec_type;
+	typedef lazy_ref stored;
+
+	SIMPLEMATH_LAZY_INLINE explicit lazy_ref(const vec_type& v): v(v)
+	{
+	}
+
+	template<unsigned I>
+	SIMPLEMATH_LAZY_INLINE float get() const
+	{
+		return (&v.x)[I];
+	}
+
+#if defined(SIMPLEMATH_SSE41)
+	SIMPLEMATH_LAZY_INLINE __m128 simd() const
+	{
+		return v.simd();
+	}
+#endif
+
+	const vec_type &v;
+};
+
+// Scalar operand, same value in every component
+template<unsigned N>
+struct lazy_scalar: lazy_expr<lazy_scalar<N>, N>
+{
+	typedef lazy_scalar stored;
+
+	SIMPLEMATH_LAZY_INLINE explicit lazy_scalar(float f): f(f)
+	{
+	}
+
+	template<unsigned I>
+	SIMPLEMATH_LAZY_INLINE float get() const
+	{
+		return f;
+	}
+
+#if defined(SIMPLEMATH_SSE41)
+	SIMPLEMATH_LAZY_INLINE __m128 simd() const
+	{
+		return _mm_set1_ps(f);
+	}
+#endif
+
+	float f;
+};
+
+template<typename A, unsigned N>
+struct lazy_negate: lazy_expr<lazy_negate<A, N>, N>
+{
+	typedef const lazy_negate& stored;
+
+	SIMPLEMATH_LAZY_INLINE explicit lazy_negate(const A& a): a(a)
+	{
+	}
+
+	template<unsigned I>
+	SIMPLEMATH_LAZY_INLINE float get() const
+	{
+		return -a.template get<I>();
+	}
+
+#if defined(SIMPLEMATH_SSE41)
+	SIMPLEMATH_LAZY_INLINE __m128 simd() const
+	{
+		return _mm_xor_ps(a.simd(), _mm_set1_ps(-0.0f));
+	}
+#endif
+
+	typename A::stored a;
+};
+
+template<typename Op, typename A, typename B, unsigned N>
+struct lazy_binary: lazy_expr<lazy_binary<Op, A, B, N>, N>
+{
+	typedef const lazy_binary& stored;
+
+	SIMPLEMATH_LAZY_INLINE lazy_binary(const A& a, const B& b): a(a), b(b)
+	{
+	}
+
+	template<unsigned I>
+	SIMPLEMATH_LAZY_INLINE float get() const
+	{
+		return Op::apply(a.template get<I>(), b.template get<I>());
+	}
+
+#if defined(SIMPLEMATH_SSE41)
+	SIMPLEMATH_LAZY_INLINE __m128 simd() const
+	{
+		return Op::apply(a.simd(), b.simd());
+	}
+#endif
+
+	typename A::stored a;
+	typename B::stored b;
+};
+
+#if defined(SIMPLEMATH_SSE41)
+	#define SIMPLEMATH_LAZY_OP(name, op, intrinsic) struct name { static SIMPLEMATH_LAZY_INLINE float apply(float a, float b) { return a op b; } static SIMPLEMATH_LAZY_INLINE __m128 apply(__m128 a, __m128 b) { return intrinsic(a, b); } };
+#else
+	#define SIMPLEMATH_LAZY_OP(name, op, intrinsic) struct name { static SIMPLEMATH_LAZY_INLINE float apply(float a, float b) { return a op b; } };
+#endif
+
+SIMPLEMATH_LAZY_OP(lazy_add, +, _mm_add_ps)
+SIMPLEMATH_LAZY_OP(lazy_sub, -, _mm_sub_ps)
+SIMPLEMATH_LAZY_OP(lazy_mul, *, _mm_mul_ps)
+SIMPLEMATH_LAZY_OP(lazy_div, /, _mm_div_ps)
+
+#undef SIMPLEMATH_LAZY_OP
+
+/********************************************************************************/
+/*								Operators										*/
+/********************************************************************************/
+
+SIMPLEMATH_LAZY_INLINE lazy_ref<3> lazy(const vec3& v)
+{
+	return lazy_ref<3>(v);
+}
+
+SIMPLEMATH_LAZY_INLINE lazy_ref<4> lazy(const vec4& v)
+{
+	return lazy_ref<4>(v);
+}
+
+// Explicit conversion for the places where the vector type is not known
+template<typename E, unsigned N>
+SIMPLEMATH_LAZY_INLINE typename lazy_vec_type<N>::type eval(const lazy_expr<E, N>& e)
+{
+	return e;
+}
+
+template<typename A, unsigned N>
+SIMPLEMATH_LAZY_INLINE lazy_negate<A, N> operator-(const lazy_expr<A, N>& a)
+{
+	return lazy_negate<A, N>(a.self());
+}
+
+// Expression with an expression, a vector or a scalar on either side
+#define SIMPLEMATH_LAZY_OPERATOR(op, Op) \
+	template<typename A, typename B, unsigned N> SIMPLEMATH_LAZY_INLINE lazy_binary<Op, A, B, N> operator op(const lazy_expr<A, N>& a, const lazy_expr<B, N>& b) { return lazy_binary<Op, A, B, N>(a.self(), b.self()); } \
+	template<typename A, unsigned N> SIMPLEMATH_LAZY_INLINE lazy_binary<Op, A, lazy_ref<N>, N> operator op(const lazy_expr<A, N>& a, const typename lazy_vec_type<N>::type& b) { return lazy_binary<Op, A, lazy_ref<N>, N>(a.self(), lazy_ref<N>(b)); } \
+	template<typename B, unsigned N> SIMPLEMATH_LAZY_INLINE lazy_binary<Op, lazy_ref<N>, B, N> operator op(const typename lazy_vec_type<N>::type& a, const lazy_expr<B, N>& b) { return lazy_binary<Op, lazy_ref<N>, B, N>(lazy_ref<N>(a), b.self()); } \
+	template<typename A, unsigned N> SIMPLEMATH_LAZY_INLINE lazy_binary<Op, A, lazy_scalar<N>, N> operator op(const lazy_expr<A, N>& a, float b) { return lazy_binary<Op, A, lazy_scalar<N>, N>(a.self(), lazy_scalar<N>(b)); } \
+	template<typename B, unsigned N> SIMPLEMATH_LAZY_INLINE lazy_binary<Op, lazy_scalar<N>, B, N> operator op(float a, const lazy_expr<B, N>& b) { return lazy_binary<Op, lazy_scalar<N>, B, N>(lazy_scalar<N>(a), b.self()); }
+
+SIMPLEMATH_LAZY_OPERATOR(+, lazy_add)
+SIMPLEMATH_LAZY_OPERATOR(-, lazy_sub)
+SIMPLEMATH_LAZY_OPERATOR(*, lazy_mul)
+SIMPLEMATH_LAZY_OPERATOR(/, lazy_div)
+
+#undef SIMPLEMATH_LAZY_OPERATOR
+
+// 'v op= expression' is evaluated in a single pass, 'v' can be a part of the expression
+#define SIMPLEMATH_LAZY_ASSIGNMENT(op, Op) \
+	template<typename B> SIMPLEMATH_LAZY_INLINE vec3& operator op(vec3& a, const lazy_expr<B, 3>& b) { return a = lazy_binary<Op, lazy_ref<3>, B, 3>(lazy_ref<3>(a), b.self()); } \
+	template<typename B> SIMPLEMATH_LAZY_INLINE vec4& operator op(vec4& a, const lazy_expr<B, 4>& b) { return a = lazy_binary<Op, lazy_ref<4>, B, 4>(lazy_ref<4>(a), b.self()); }
+
+SIMPLEMATH_LAZY_ASSIGNMENT(+=, lazy_add)
+SIMPLEMATH_LAZY_ASSIGNMENT(-=, lazy_sub)
+SIMPLEMATH_LAZY_ASSIGNMENT(*=, lazy_mul)
+SIMPLEMATH_LAZY_ASSIGNMENT(/=, lazy_div)
+
+#undef SIMPLEMATH_LAZY_ASSIGNMENT
@@ -9,44 +9,43 @@
 struct mat3;
 struct mat4;
 
+inline SIMPLEMATH_CONSTEXPR_SIMD void mul(mat4 &ret, const mat4 &n, const mat4 &m);
+
 /********************************************************************************/
 /*								mat3											*/
 /********************************************************************************/
 
 struct mat3
 {
-	mat3()
+	SIMPLEMATH_CONSTEXPR mat3(): mat()
 	{
 		mat[0] = 1.0; mat[3] = 0.0; mat[6] = 0.0;
 		mat[1] = 0.0; mat[4] = 1.0; mat[7] = 0.0;
 		mat[2] = 0.0; mat[5] = 0.0; mat[8] = 1.0;
 	}
 
-	explicit mat3(const float* m)
+	SIMPLEMATH_CONSTEXPR explicit mat3(const float* m): mat()
 	{
 		mat[0] = m[0]; mat[3] = m[3]; mat[6] = m[6];
 		mat[1] = m[1]; mat[4] = m[4]; mat[7] = m[7];
 		mat[2] = m[2]; mat[5] = m[5]; mat[8] = m[8];
 	}
 
-	mat3(const mat3& m)
+	explicit mat3(uninitialized_tag)
 	{
-		mat[0] = m.mat[0]; mat[3] = m.mat[3]; mat[6] = m.mat[6];
-		mat[1] = m.mat[1]; mat[4] = m.mat[4]; mat[7] = m.mat[7];
-		mat[2] = m.mat[2]; mat[5] = m.mat[5]; mat[8] = m.mat[8];
 	}
 
-	mat3(const vec3& row1, const vec3& row2, const vec3& row3)
+	SIMPLEMATH_CONSTEXPR mat3(const vec3& row1, const vec3& row2, const vec3& row3): mat()
 	{
 		mat[0] = row1.x; mat[3] = row2.x; mat[6] = row3.x;
 		mat[1] = row1.y; mat[4] = row2.y; mat[7] = row3.y;
 		mat[2] = row1.z; mat[5] = row2.z; mat[8] = row3.z;
 	}
 
-	explicit mat3(const mat4& m);
+	SIMPLEMATH_CONSTEXPR explicit mat3(const mat4& m);
 
 	// Binary operators
-	vec3 operator*(const vec3& v) const
+	SIMPLEMATH_CONSTEXPR vec3 operator*(const vec3& v) const
 	{
 		vec3 ret;
 		ret.x = mat[0] * v.x + mat[3] * v.y + mat[6] * v.z;
@@ -55,7 +54,7 @@ struct mat3
 		return ret;
 	}
 
-	vec4 operator*(const vec4& v) const
+	SIMPLEMATH_CONSTEXPR vec4 operator*(const vec4& v) const
 	{
 		vec4 ret;
 		ret.x = mat[0] * v.x + mat[3] * v.y + mat[6] * v.z;
@@ -65,7 +64,7 @@ struct mat3
 		return ret;
 	}
 
-	mat3 operator*(float f) const
+	SIMPLEMATH_CONSTEXPR mat3 operator*(float f) const
 	{
 		mat3 ret;
 		ret.mat[0] = mat[0] * f; ret.mat[3] = mat[3] * f; ret.mat[6] = mat[6] * f;
@@ -74,7 +73,7 @@ struct mat3
 		return ret;
 	}
 
-	mat3 operator*(const mat3& m) const
+	SIMPLEMATH_CONSTEXPR mat3 operator*(const mat3& m) const
 	{
 		mat3 ret;
 		ret.mat[0] = mat[0] * m.mat[0] + mat[3] * m.mat[1] + mat[6] * m.mat[2];
@@ -89,7 +88,7 @@ struct mat3
 		return ret;
 	}
 
-	mat3 operator+(const mat3& m) const
+	SIMPLEMATH_CONSTEXPR mat3 operator+(const mat3& m) const
 	{
 		mat3 ret;
 		ret.mat[0] = mat[0] + m.mat[0]; ret.mat[3] = mat[3] + m.mat[3]; ret.mat[6] = mat[6] + m.mat[6];
@@ -98,7 +97,7 @@ struct mat3
 		return ret;
 	}
 
-	mat3 operator-(const mat3& m) const
+	SIMPLEMATH_CONSTEXPR mat3 operator-(const mat3& m) const
 	{
 		mat3 ret;
 		ret.mat[0] = mat[0] - m.mat[0]; ret.mat[3] = mat[3] - m.mat[3]; ret.mat[6] = mat[6] - m.mat[6];
@@ -108,28 +107,28 @@ struct mat3
 	}
 
 	// Assignment operators
-	mat3& operator*=(float f)
+	SIMPLEMATH_CONSTEXPR mat3& operator*=(float f)
 	{
 		return *this = *this * f;
 	}
 
-	mat3& operator*=(const mat3& m)
+	SIMPLEMATH_CONSTEXPR mat3& operator*=(const mat3& m)
 	{
 		return *this = *this * m;
 	}
 
-	mat3& operator+=(const mat3& m)
+	SIMPLEMATH_CONSTEXPR mat3& operator+=(const mat3& m)
 	{
 		return *this = *this + m;
 	}
 
-	mat3& operator-=(const mat3& m)
+	SIMPLEMATH_CONSTEXPR mat3& operator-=(const mat3& m)
 	{
 		return *this = *this - m;
 	}
 
 	// Functions
-	mat3 transpose() const
+	SIMPLEMATH_CONSTEXPR mat3 transpose() const
 	{
 		mat3 ret;
 		ret.mat[0] = mat[0]; ret.mat[3] = mat[1]; ret.mat[6] = mat[2];
@@ -138,10 +137,9 @@ struct mat3
 		return ret;
 	}
 
-	float det() const
+	SIMPLEMATH_CONSTEXPR float det() const
 	{
-		float det;
-		det = mat[0] * mat[4] * mat[8];
+		float det = mat[0] * mat[4] * mat[8];
 		det += mat[3] * mat[7] * mat[2];
 		det += mat[6] * mat[1] * mat[5];
 		det -= mat[6] * mat[4] * mat[2];
@@ -150,7 +148,7 @@ struct mat3
 		return det;
 	}
 
-	mat3 inverse() const
+	SIMPLEMATH_CONSTEXPR mat3 inverse() const
 	{
 		mat3 ret;
 
@@ -169,14 +167,14 @@ struct mat3
 		return ret;
 	}
 
-	void zero()
+	SIMPLEMATH_CONSTEXPR void zero()
 	{
 		mat[0] = 0.0; mat[3] = 0.0; mat[6] = 0.0;
 		mat[1] = 0.0; mat[4] = 0.0; mat[7] = 0.0;
 		mat[2] = 0.0; mat[5] = 0.0; mat[8] = 0.0;
 	}
 
-	void identity()
+	SIMPLEMATH_CONSTEXPR void identity()
 	{
 		mat[0] = 1.0; mat[3] = 0.0; mat[6] = 0.0;
 		mat[1] = 0.0; mat[4] = 1.0; mat[7] = 0.0;
@@ -186,8 +184,8 @@ struct mat3
 	void rotate(const vec3& axis, float angle)
 	{
 		float rad = DegToRad(angle);
-		float c = cosf(rad);
-		float s = sinf(rad);
+		float s, c;
+		math_sincos(rad, s, c);
 
 		vec3 v = axis;
 
@@ -211,8 +209,8 @@ struct mat3
 	void rotate_x(float angle)
 	{
 		float rad = DegToRad(angle);
-		float c = cosf(rad);
-		float s = sinf(rad);
+		float s, c;
+		math_sincos(rad, s, c);
 
 		mat3 m;
 
@@ -226,8 +224,8 @@ struct mat3
 	void rotate_y(float angle)
 	{
 		float rad = DegToRad(angle);
-		float c = cosf(rad);
-		float s = sinf(rad);
+		float s, c;
+		math_sincos(rad, s, c);
 
 		mat3 m;
 
@@ -241,8 +239,8 @@ struct mat3
 	void rotate_z(float angle)
 	{
 		float rad = DegToRad(angle);
-		float c = cosf(rad);
-		float s = sinf(rad);
+		float s, c;
+		math_sincos(rad, s, c);
 
 		mat3 m;
 
@@ -253,7 +251,7 @@ struct mat3
 		this->operator*=(m);
 	}
 
-	void scale(const vec3 &v)
+	SIMPLEMATH_CONSTEXPR void scale(const vec3 &v)
 	{
 		mat3 m;
 
@@ -288,9 +286,9 @@ struct mat3
 /*								mat4											*/
 /********************************************************************************/
 
-struct mat4
+struct SIMPLEMATH_ALIGN16 mat4
 {
-	mat4()
+	SIMPLEMATH_CONSTEXPR mat4(): mat()
 	{
 		mat[0] = 1.0; mat[4] = 0.0; mat[8] = 0.0; mat[12] = 0.0;
 		mat[1] = 0.0; mat[5] = 1.0; mat[9] = 0.0; mat[13] = 0.0;
@@ -298,7 +296,7 @@ struct mat4
 		mat[3] = 0.0; mat[7] = 0.0; mat[11] = 0.0; mat[15] = 1.0;
 	}
 
-	mat4(const vec4& row1, const vec4& row2, const vec4& row3, const vec4& row4)
+	SIMPLEMATH_CONSTEXPR mat4(const vec4& row1, const vec4& row2, const vec4& row3, const vec4& row4): mat()
 	{
 		mat[0] = row1.x; mat[4] = row2.x; mat[8] = row3.x; mat[12] = row4.x;
 		mat[1] = row1.y; mat[5] = row2.y; mat[9] = row3.y; mat[13] = row4.y;
@@ -306,7 +304,7 @@ struct mat4
 		mat[3] = row1.w; mat[7] = row2.w; mat[11] = row3.w; mat[15] = row4.w;
 	}
 
-	explicit mat4(const mat3& m)
+	SIMPLEMATH_CONSTEXPR explicit mat4(const mat3& m): mat()
 	{
 		mat[0] = m.mat[0]; mat[4] = m.mat[3]; mat[8] = m.mat[6]; mat[12] = 0.0;
 		mat[1] = m.mat[1]; mat[5] = m.mat[4]; mat[9] = m.mat[7]; mat[13] = 0.0;
@@ -314,7 +312,7 @@ struct mat4
 		mat[3] = 0.0;  mat[7] = 0.0;  mat[11] = 0.0;  mat[15] = 1.0;
 	}
 
-	explicit mat4(const float* m)
+	SIMPLEMATH_CONSTEXPR explicit mat4(const float* m): mat()
 	{
 		mat[0] = m[0]; mat[4] = m[4]; mat[8] = m[8]; mat[12] = m[12];
 		mat[1] = m[1]; mat[5] = m[5]; mat[9] = m[9]; mat[13] = m[13];
@@ -322,17 +320,26 @@ struct mat4
 		mat[3] = m[3]; mat[7] = m[7]; mat[11] = m[11]; mat[15] = m[15];
 	}
 
-	mat4(const mat4& m)
+	explicit mat4(uninitialized_tag)
 	{
-		mat[0] = m.mat[0]; mat[4] = m.mat[4]; mat[8] = m.mat[8]; mat[12] = m.mat[12];
-		mat[1] = m.mat[1]; mat[5] = m.mat[5]; mat[9] = m.mat[9]; mat[13] = m.mat[13];
-		mat[2] = m.mat[2]; mat[6] = m.mat[6]; mat[10] = m.mat[10]; mat[14] = m.mat[14];
-		mat[3] = m.mat[3]; mat[7] = m.mat[7]; mat[11] = m.mat[11]; mat[15] = m.mat[15];
 	}
 
 	// Binary operators
-	vec3 operator*(const vec3& v) const
-	{
+	SIMPLEMATH_CONSTEXPR_SIMD vec3 operator*(const vec3& v) const
+	{
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		{
+			__m128 r = _mm_mul_ps(_mm_load_ps(&mat[0]), _mm_set1_ps(v.x));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(&mat[4]), _mm_set1_ps(v.y)));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(&mat[8]), _mm_set1_ps(v.z)));
+			r = _mm_add_ps(r, _mm_load_ps(&mat[12]));
+			r = _mm_div_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3)));
+
+			vec4 ret(r);
+			return vec3(ret.x, ret.y, ret.z);
+		}
+#endif
 		vec3 ret;
 		ret.x = mat[0] * v.x + mat[4] * v.y + mat[8] * v.z + mat[12];
 		ret.y = mat[1] * v.x + mat[5] * v.y + mat[9] * v.z + mat[13];
@@ -342,8 +349,18 @@ struct mat4
 		return ret;
 	}
 
-	vec4 operator*(const vec4& v) const
+	SIMPLEMATH_CONSTEXPR_SIMD vec4 operator*(const vec4& v) const
 	{
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		{
+			__m128 r = _mm_mul_ps(_mm_load_ps(&mat[0]), _mm_set1_ps(v.x));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(&mat[4]), _mm_set1_ps(v.y)));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(&mat[8]), _mm_set1_ps(v.z)));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_load_ps(&mat[12]), _mm_set1_ps(v.w)));
+			return vec4(r);
+		}
+#endif
 		vec4 ret;
 		ret.x = mat[0] * v.x + mat[4] * v.y + mat[8] * v.z + mat[12] * v.w;
 		ret.y = mat[1] * v.x + mat[5] * v.y + mat[9] * v.z + mat[13] * v.w;
@@ -352,9 +369,19 @@ struct mat4
 		return ret;
 	}
 
-	mat4 operator*(float f) const
+	SIMPLEMATH_CONSTEXPR_SIMD mat4 operator*(float f) const
 	{
 		mat4 ret;
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		{
+			__m128 s = _mm_set1_ps(f);
+
+			for(unsigned i = 0; i < 16; i += 4)
+				_mm_store_ps(&ret.mat[i], _mm_mul_ps(_mm_load_ps(&mat[i]), s));
+			return ret;
+		}
+#endif
 		ret.mat[0] = mat[0] * f; ret.mat[4] = mat[4] * f; ret.mat[8] = mat[8] * f; ret.mat[12] = mat[12] * f;
 		ret.mat[1] = mat[1] * f; ret.mat[5] = mat[5] * f; ret.mat[9] = mat[9] * f; ret.mat[13] = mat[13] * f;
 		ret.mat[2] = mat[2] * f; ret.mat[6] = mat[6] * f; ret.mat[10] = mat[10] * f; ret.mat[14] = mat[14] * f;
@@ -362,9 +389,19 @@ struct mat4
 		return ret;
 	}
 
-	mat4 operator*(const mat4 &m) const
+	SIMPLEMATH_CONSTEXPR_SIMD mat4 operator*(const mat4 &m) const
 	{
 		mat4 ret;
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		{
+			mul(ret, *this, m);
+			return ret;
+		}
+#endif
+#if defined(SIMPLEMATH_FMA)
+		mul(ret, *this, m);
+#else
 		ret.mat[0] = mat[0] * m.mat[0] + mat[4] * m.mat[1] + mat[8] * m.mat[2] + mat[12] * m.mat[3];
 		ret.mat[1] = mat[1] * m.mat[0] + mat[5] * m.mat[1] + mat[9] * m.mat[2] + mat[13] * m.mat[3];
 		ret.mat[2] = mat[2] * m.mat[0] + mat[6] * m.mat[1] + mat[10] * m.mat[2] + mat[14] * m.mat[3];
@@ -381,12 +418,21 @@ struct mat4
 		ret.mat[13] = mat[1] * m.mat[12] + mat[5] * m.mat[13] + mat[9] * m.mat[14] + mat[13] * m.mat[15];
 		ret.mat[14] = mat[2] * m.mat[12] + mat[6] * m.mat[13] + mat[10] * m.mat[14] + mat[14] * m.mat[15];
 		ret.mat[15] = mat[3] * m.mat[12] + mat[7] * m.mat[13] + mat[11] * m.mat[14] + mat[15] * m.mat[15];
+#endif
 		return ret;
 	}
 
-	mat4 operator+(const mat4& m) const
+	SIMPLEMATH_CONSTEXPR_SIMD mat4 operator+(const mat4& m) const
 	{
 		mat4 ret;
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		{
+			for(unsigned i = 0; i < 16; i += 4)
+				_mm_store_ps(&ret.mat[i], _mm_add_ps(_mm_load_ps(&mat[i]), _mm_load_ps(&m.mat[i])));
+			return ret;
+		}
+#endif
 		ret.mat[0] = mat[0] + m.mat[0]; ret.mat[4] = mat[4] + m.mat[4]; ret.mat[8] = mat[8] + m.mat[8]; ret.mat[12] = mat[12] + m.mat[12];
 		ret.mat[1] = mat[1] + m.mat[1]; ret.mat[5] = mat[5] + m.mat[5]; ret.mat[9] = mat[9] + m.mat[9]; ret.mat[13] = mat[13] + m.mat[13];
 		ret.mat[2] = mat[2] + m.mat[2]; ret.mat[6] = mat[6] + m.mat[6]; ret.mat[10] = mat[10] + m.mat[10]; ret.mat[14] = mat[14] + m.mat[14];
@@ -394,9 +440,17 @@ struct mat4
 		return ret;
 	}
 
-	mat4 operator-(const mat4& m) const
+	SIMPLEMATH_CONSTEXPR_SIMD mat4 operator-(const mat4& m) const
 	{
 		mat4 ret;
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		{
+			for(unsigned i = 0; i < 16; i += 4)
+				_mm_store_ps(&ret.mat[i], _mm_sub_ps(_mm_load_ps(&mat[i]), _mm_load_ps(&m.mat[i])));
+			return ret;
+		}
+#endif
 		ret.mat[0] = mat[0] - m.mat[0]; ret.mat[4] = mat[4] - m.mat[4]; ret.mat[8] = mat[8] - m.mat[8]; ret.mat[12] = mat[12] - m.mat[12];
 		ret.mat[1] = mat[1] - m.mat[1]; ret.mat[5] = mat[5] - m.mat[5]; ret.mat[9] = mat[9] - m.mat[9]; ret.mat[13] = mat[13] - m.mat[13];
 		ret.mat[2] = mat[2] - m.mat[2]; ret.mat[6] = mat[6] - m.mat[6]; ret.mat[10] = mat[10] - m.mat[10]; ret.mat[14] = mat[14] - m.mat[14];
@@ -405,28 +459,28 @@ struct mat4
 	}
 
 	// Assignment operators
-	mat4& operator*=(float f)
+	SIMPLEMATH_CONSTEXPR_SIMD mat4& operator*=(float f)
 	{
 		return *this = *this * f;
 	}
 
-	mat4& operator*=(const mat4& m)
+	SIMPLEMATH_CONSTEXPR_SIMD mat4& operator*=(const mat4& m)
 	{
 		return *this = *this * m;
 	}
 
-	mat4& operator+=(const mat4& m)
+	SIMPLEMATH_CONSTEXPR_SIMD mat4& operator+=(const mat4& m)
 	{
 		return *this = *this + m;
 	}
 
-	mat4& operator-=(const mat4& m)
+	SIMPLEMATH_CONSTEXPR_SIMD mat4& operator-=(const mat4& m)
 	{
 		return *this = *this - m;
 	}
 
 	// Functions
-	mat4 rotation() const
+	SIMPLEMATH_CONSTEXPR mat4 rotation() const
 	{
 		mat4 ret;
 		ret.mat[0] = mat[0]; ret.mat[4] = mat[4]; ret.mat[8] = mat[8]; ret.mat[12] = 0.0f;
@@ -436,9 +490,26 @@ struct mat4
 		return ret;
 	}
 
-	mat4 transpose() const
+	SIMPLEMATH_CONSTEXPR_SIMD mat4 transpose() const
 	{
 		mat4 ret;
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		{
+			__m128 c0 = _mm_load_ps(&mat[0]);
+			__m128 c1 = _mm_load_ps(&mat[4]);
+			__m128 c2 = _mm_load_ps(&mat[8]);
+			__m128 c3 = _mm_load_ps(&mat[12]);
+
+			_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+			_mm_store_ps(&ret.mat[0], c0);
+			_mm_store_ps(&ret.mat[4], c1);
+			_mm_store_ps(&ret.mat[8], c2);
+			_mm_store_ps(&ret.mat[12], c3);
+			return ret;
+		}
+#endif
 		ret.mat[0] = mat[0]; ret.mat[4] = mat[1]; ret.mat[8] = mat[2]; ret.mat[12] = mat[3];
 		ret.mat[1] = mat[4]; ret.mat[5] = mat[5]; ret.mat[9] = mat[6]; ret.mat[13] = mat[7];
 		ret.mat[2] = mat[8]; ret.mat[6] = mat[9]; ret.mat[10] = mat[10]; ret.mat[14] = mat[11];
@@ -446,17 +517,17 @@ struct mat4
 		return ret;
 	}
 
-	mat4 transpose_rotation() const
+	SIMPLEMATH_CONSTEXPR mat4 transpose_rotation() const
 	{
 		mat4 ret;
 		ret.mat[0] = mat[0]; ret.mat[4] = mat[1]; ret.mat[8] = mat[2]; ret.mat[12] = mat[12];
 		ret.mat[1] = mat[4]; ret.mat[5] = mat[5]; ret.mat[9] = mat[6]; ret.mat[13] = mat[13];
 		ret.mat[2] = mat[8]; ret.mat[6] = mat[9]; ret.mat[10] = mat[10]; ret.mat[14] = mat[14];
-		ret.mat[3] = mat[3]; ret.mat[7] = mat[7]; ret.mat[14] = mat[14]; ret.mat[15] = mat[15];
+		ret.mat[3] = mat[3]; ret.mat[7] = mat[7]; ret.mat[11] = mat[11]; ret.mat[15] = mat[15];
 		return ret;
 	}
 
-	float det() const
+	SIMPLEMATH_CONSTEXPR float det() const
 	{
 		return mat[0] * (mat[5] * (mat[10] * mat[15] - mat[11] * mat[14]) + mat[6] * (mat[11] * mat[13] - mat[9] * mat[15]) +
 						 mat[7] * (mat[9] * mat[14] - mat[10] * mat[13])) -
@@ -468,51 +539,179 @@ struct mat4
 					  mat[6] * (mat[8] * mat[13] - mat[9] * mat[12]));
 	}
 
-	mat4 inverse() const
+	// General inverse, the determinant is assembled from the same 2x2 sub-determinants as the adjugate
+	SIMPLEMATH_CONSTEXPR_SIMD mat4 inverse() const
 	{
 		mat4 ret;
-		float idet = 1.0f / det();
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		{
+			// Block matrix inversion over 2x2 sub-matrices (columns are used as rows, inverse commutes with transpose)
+			__m128 c0 = _mm_load_ps(&mat[0]);
+			__m128 c1 = _mm_load_ps(&mat[4]);
+			__m128 c2 = _mm_load_ps(&mat[8]);
+			__m128 c3 = _mm_load_ps(&mat[12]);
+
+			__m128 a = _mm_movelh_ps(c0, c1);
+			__m128 b = _mm_movehl_ps(c1, c0);
+			__m128 c = _mm_movelh_ps(c2, c3);
+			__m128 d = _mm_movehl_ps(c3, c2);
+
+			// |A| |B| |C| |D|
+			__m128 detSub = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(c0, c2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(c1, c3, _MM_SHUFFLE(3, 1, 3, 1))),
+				_mm_mul_ps(_mm_shuffle_ps(c0, c2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(c1, c3, _MM_SHUFFLE(2, 0, 2, 0))));
+
+			__m128 detA = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(0, 0, 0, 0));
+			__m128 detB = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(1, 1, 1, 1));
+			__m128 detC = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(2, 2, 2, 2));
+			__m128 detD = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(3, 3, 3, 3));
+
+			// adj(D) * C and adj(A) * B
+			__m128 dc = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(d, d, _MM_SHUFFLE(0, 0, 3, 3)), c), _mm_mul_ps(_mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(1, 0, 3, 2))));
+			__m128 ab = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b), _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+
+			// Adjugates of the result blocks: X = |D|A - B(adj(D)C), W = |A|D - C(adj(A)B)
+			__m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), _mm_add_ps(_mm_mul_ps(b, _mm_shuffle_ps(dc, dc, _MM_SHUFFLE(3, 0, 3, 0))), _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(dc, dc, _MM_SHUFFLE(1, 2, 1, 2)))));
+			__m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), _mm_add_ps(_mm_mul_ps(c, _mm_shuffle_ps(ab, ab, _MM_SHUFFLE(3, 0, 3, 0))), _mm_mul_ps(_mm_shuffle_ps(c, c, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(ab, ab, _MM_SHUFFLE(1, 2, 1, 2)))));
+
+			// Y = |B|C - D adj(adj(A)B), Z = |C|B - A adj(adj(D)C)
+			__m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), _mm_sub_ps(_mm_mul_ps(d, _mm_shuffle_ps(ab, ab, _MM_SHUFFLE(0, 3, 0, 3))), _mm_mul_ps(_mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(ab, ab, _MM_SHUFFLE(1, 2, 1, 2)))));
+			__m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), _mm_sub_ps(_mm_mul_ps(a, _mm_shuffle_ps(dc, dc, _MM_SHUFFLE(0, 3, 0, 3))), _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(dc, dc, _MM_SHUFFLE(1, 2, 1, 2)))));
+
+			// |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+			__m128 tr = _mm_mul_ps(ab, _mm_shuffle_ps(dc, dc, _MM_SHUFFLE(3, 1, 2, 0)));
+			tr = _mm_hadd_ps(tr, tr);
+			tr = _mm_hadd_ps(tr, tr);
+
+			__m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+			__m128 idet = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+
+			x = _mm_mul_ps(x, idet);
+			y = _mm_mul_ps(y, idet);
+			z = _mm_mul_ps(z, idet);
+			w = _mm_mul_ps(w, idet);
+
+			_mm_store_ps(&ret.mat[0], _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 3, 1, 3)));
+			_mm_store_ps(&ret.mat[4], _mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 2, 0, 2)));
+			_mm_store_ps(&ret.mat[8], _mm_shuffle_ps(z, w, _MM_SHUFFLE(1, 3, 1, 3)));
+			_mm_store_ps(&ret.mat[12], _mm_shuffle_ps(z, w, _MM_SHUFFLE(0, 2, 0, 2)));
+			return ret;
+		}
+#endif
+		float s0 = mat[0] * mat[5] - mat[4] * mat[1];
+		float s1 = mat[0] * mat[6] - mat[4] * mat[2];
+		float s2 = mat[0] * mat[7] - mat[4] * mat[3];
+		float s3 = mat[1] * mat[6] - mat[5] * mat[2];
+		float s4 = mat[1] * mat[7] - mat[5] * mat[3];
+		float s5 = mat[2] * mat[7] - mat[6] * mat[3];
+
+		float c5 = mat[10] * mat[15] - mat[14] * mat[11];
+		float c4 = mat[9] * mat[15] - mat[13] * mat[11];
+		float c3 = mat[9] * mat[14] - mat[13] * mat[10];
+		float c2 = mat[8] * mat[15] - mat[12] * mat[11];
+		float c1 = mat[8] * mat[14] - mat[12] * mat[10];
+		float c0 = mat[8] * mat[13] - mat[12] * mat[9];
+
+		float idet = 1.0f / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+		ret.mat[0] = (mat[5] * c5 - mat[6] * c4 + mat[7] * c3) * idet;
+		ret.mat[1] = (-mat[1] * c5 + mat[2] * c4 - mat[3] * c3) * idet;
+		ret.mat[2] = (mat[13] * s5 - mat[14] * s4 + mat[15] * s3) * idet;
+		ret.mat[3] = (-mat[9] * s5 + mat[10] * s4 - mat[11] * s3) * idet;
+
+		ret.mat[4] = (-mat[4] * c5 + mat[6] * c2 - mat[7] * c1) * idet;
+		ret.mat[5] = (mat[0] * c5 - mat[2] * c2 + mat[3] * c1) * idet;
+		ret.mat[6] = (-mat[12] * s5 + mat[14] * s2 - mat[15] * s1) * idet;
+		ret.mat[7] = (mat[8] * s5 - mat[10] * s2 + mat[11] * s1) * idet;
+
+		ret.mat[8] = (mat[4] * c4 - mat[5] * c2 + mat[7] * c0) * idet;
+		ret.mat[9] = (-mat[0] * c4 + mat[1] * c2 - mat[3] * c0) * idet;
+		ret.mat[10] = (mat[12] * s4 - mat[13] * s2 + mat[15] * s0) * idet;
+		ret.mat[11] = (-mat[8] * s4 + mat[9] * s2 - mat[11] * s0) * idet;
+
+		ret.mat[12] = (-mat[4] * c3 + mat[5] * c1 - mat[6] * c0) * idet;
+		ret.mat[13] = (mat[0] * c3 - mat[1] * c1 + mat[2] * c0) * idet;
+		ret.mat[14] = (-mat[12] * s3 + mat[13] * s1 - mat[14] * s0) * idet;
+		ret.mat[15] = (mat[8] * s3 - mat[9] * s1 + mat[10] * s0) * idet;
+		return ret;
+	}
 
-		ret.mat[0] = (mat[5] * mat[10] * mat[15] + mat[9] * mat[14] * mat[7] + mat[13] * mat[6] * mat[11] -
-					  mat[5] * mat[14] * mat[11] - mat[9] * mat[6] * mat[15] - mat[13] * mat[10] * mat[7]) * idet;
-		ret.mat[1] = -(mat[1] * mat[10] * mat[15] + mat[9] * mat[14] * mat[3] + mat[13] * mat[2] * mat[11] -
-					   mat[1] * mat[14] * mat[11] - mat[9] * mat[2] * mat[15] - mat[13] * mat[10] * mat[3]) * idet;
-		ret.mat[2] = (mat[1] * mat[6] * mat[15] + mat[5] * mat[14] * mat[3] + mat[13] * mat[2] * mat[7] -
-					  mat[1] * mat[14] * mat[7] - mat[5] * mat[2] * mat[15] - mat[13] * mat[6] * mat[3]) * idet;
-		ret.mat[3] = -(mat[1] * mat[6] * mat[11] + mat[5] * mat[10] * mat[3] + mat[9] * mat[2] * mat[7] -
-					   mat[1] * mat[10] * mat[7] - mat[5] * mat[2] * mat[11] - mat[9] * mat[6] * mat[3]) * idet;
-
-		ret.mat[4] = -(mat[4] * mat[10] * mat[15] + mat[8] * mat[14] * mat[7] + mat[12] * mat[6] * mat[11] -
-					   mat[4] * mat[14] * mat[11] - mat[8] * mat[6] * mat[15] - mat[12] * mat[10] * mat[7]) * idet;
-		ret.mat[5] = (mat[0] * mat[10] * mat[15] + mat[8] * mat[14] * mat[3] + mat[12] * mat[2] * mat[11] -
-					  mat[0] * mat[14] * mat[11] - mat[8] * mat[2] * mat[15] - mat[12] * mat[10] * mat[3]) * idet;
-		ret.mat[6] = -(mat[0] * mat[6] * mat[15] + mat[4] * mat[14] * mat[3] + mat[12] * mat[2] * mat[7] -
-					   mat[0] * mat[14] * mat[7] - mat[4] * mat[2] * mat[15] - mat[12] * mat[6] * mat[3]) * idet;
-		ret.mat[7] = (mat[0] * mat[6] * mat[11] + mat[4] * mat[10] * mat[3] + mat[8] * mat[2] * mat[7] -
-					  mat[0] * mat[10] * mat[7] - mat[4] * mat[2] * mat[11] - mat[8] * mat[6] * mat[3]) * idet;
-
-		ret.mat[8] = (mat[4] * mat[9] * mat[15] + mat[8] * mat[13] * mat[7] + mat[12] * mat[5] * mat[11] -
-					  mat[4] * mat[13] * mat[11] - mat[8] * mat[5] * mat[15] - mat[12] * mat[9] * mat[7]) * idet,
-		ret.mat[9] = -(mat[0] * mat[9] * mat[15] + mat[8] * mat[13] * mat[3] + mat[12] * mat[1] * mat[11] -
-						   mat[0] * mat[13] * mat[11] - mat[8] * mat[1] * mat[15] - mat[12] * mat[9] * mat[3]) * idet;
-		ret.mat[10] = (mat[0] * mat[5] * mat[15] + mat[4] * mat[13] * mat[3] + mat[12] * mat[1] * mat[7] -
-					   mat[0] * mat[13] * mat[7] - mat[4] * mat[1] * mat[15] - mat[12] * mat[5] * mat[3]) * idet;
-		ret.mat[11] = -(mat[0] * mat[5] * mat[11] + mat[4] * mat[9] * mat[3] + mat[8] * mat[1] * mat[7] -
-						mat[0] * mat[9] * mat[7] - mat[4] * mat[1] * mat[11] - mat[8] * mat[5] * mat[3]) * idet;
-
-		ret.mat[12] = -(mat[4] * mat[9] * mat[14] + mat[8] * mat[13] * mat[6] + mat[12] * mat[5] * mat[10] -
-						mat[4] * mat[13] * mat[10] - mat[8] * mat[5] * mat[14] - mat[12] * mat[9] * mat[6]) * idet;
-		ret.mat[13] = (mat[0] * mat[9] * mat[14] + mat[8] * mat[13] * mat[2] + mat[12] * mat[1] * mat[10] -
-					   mat[0] * mat[13] * mat[10] - mat[8] * mat[1] * mat[14] - mat[12] * mat[9] * mat[2]) * idet;
-		ret.mat[14] = -(mat[0] * mat[5] * mat[14] + mat[4] * mat[13] * mat[2] + mat[12] * mat[1] * mat[6] -
-						mat[0] * mat[13] * mat[6] - mat[4] * mat[1] * mat[14] - mat[12] * mat[5] * mat[2]) * idet;
-		ret.mat[15] = (mat[0] * mat[5] * mat[10] + mat[4] * mat[9] * mat[2] + mat[8] * mat[1] * mat[6] -
-					   mat[0] * mat[9] * mat[6] - mat[4] * mat[1] * mat[10] - mat[8] * mat[5] * mat[2]) * idet;
+	// Inverse of a matrix with the last row equal to (0, 0, 0, 1): 3x3 inverse and an inverse translation
+	SIMPLEMATH_CONSTEXPR_SIMD mat4 inverse_affine() const
+	{
+		mat4 ret;
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		{
+			__m128 c0 = _mm_load_ps(&mat[0]);
+			__m128 c1 = _mm_load_ps(&mat[4]);
+			__m128 c2 = _mm_load_ps(&mat[8]);
+			__m128 t = _mm_load_ps(&mat[12]);
+
+			// Rows of the inverse are cross products of the columns divided by the determinant
+			__m128 r0 = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(c1, c1, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(c2, c2, _MM_SHUFFLE(3, 1, 0, 2))), _mm_mul_ps(_mm_shuffle_ps(c1, c1, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(c2, c2, _MM_SHUFFLE(3, 0, 2, 1))));
+			__m128 r1 = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(c2, c2, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(c0, c0, _MM_SHUFFLE(3, 1, 0, 2))), _mm_mul_ps(_mm_shuffle_ps(c2, c2, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(c0, c0, _MM_SHUFFLE(3, 0, 2, 1))));
+			__m128 r2 = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(c0, c0, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(c1, c1, _MM_SHUFFLE(3, 1, 0, 2))), _mm_mul_ps(_mm_shuffle_ps(c0, c0, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(c1, c1, _MM_SHUFFLE(3, 0, 2, 1))));
+			__m128 r3 = _mm_setzero_ps();
+
+			__m128 idet = _mm_div_ps(_mm_set1_ps(1.0f), _mm_dp_ps(c0, r0, 0x7f));
+
+			r0 = _mm_mul_ps(r0, idet);
+			r1 = _mm_mul_ps(r1, idet);
+			r2 = _mm_mul_ps(r2, idet);
+
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+			__m128 rt = _mm_mul_ps(r0, _mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 0, 0, 0)));
+			rt = _mm_add_ps(rt, _mm_mul_ps(r1, _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1))));
+			rt = _mm_add_ps(rt, _mm_mul_ps(r2, _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 2, 2, 2))));
+			rt = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), rt);
+
+			_mm_store_ps(&ret.mat[0], r0);
+			_mm_store_ps(&ret.mat[4], r1);
+			_mm_store_ps(&ret.mat[8], r2);
+			_mm_store_ps(&ret.mat[12], rt);
+			return ret;
+		}
+#endif
+		float idet = 1.0f / (mat[0] * (mat[5] * mat[10] - mat[6] * mat[9]) + mat[1] * (mat[6] * mat[8] - mat[4] * mat[10]) + mat[2] * (mat[4] * mat[9] - mat[5] * mat[8]));
+
+		ret.mat[0] = (mat[5] * mat[10] - mat[6] * mat[9]) * idet;
+		ret.mat[1] = (mat[2] * mat[9] - mat[1] * mat[10]) * idet;
+		ret.mat[2] = (mat[1] * mat[6] - mat[2] * mat[5]) * idet;
+		ret.mat[3] = 0.0f;
+
+		ret.mat[4] = (mat[6] * mat[8] - mat[4] * mat[10]) * idet;
+		ret.mat[5] = (mat[0] * mat[10] - mat[2] * mat[8]) * idet;
+		ret.mat[6] = (mat[2] * mat[4] - mat[0] * mat[6]) * idet;
+		ret.mat[7] = 0.0f;
+
+		ret.mat[8] = (mat[4] * mat[9] - mat[5] * mat[8]) * idet;
+		ret.mat[9] = (mat[1] * mat[8] - mat[0] * mat[9]) * idet;
+		ret.mat[10] = (mat[0] * mat[5] - mat[1] * mat[4]) * idet;
+		ret.mat[11] = 0.0f;
+
+		ret.mat[12] = -(ret.mat[0] * mat[12] + ret.mat[4] * mat[13] + ret.mat[8] * mat[14]);
+		ret.mat[13] = -(ret.mat[1] * mat[12] + ret.mat[5] * mat[13] + ret.mat[9] * mat[14]);
+		ret.mat[14] = -(ret.mat[2] * mat[12] + ret.mat[6] * mat[13] + ret.mat[10] * mat[14]);
+		ret.mat[15] = 1.0f;
+		return ret;
+	}
+
+	// Inverse of a rotation and translation matrix: transposed rotation and an inverse translation
+	SIMPLEMATH_CONSTEXPR mat4 inverse_rigid() const
+	{
+		mat4 ret = transpose_rotation();
+
+		ret.mat[12] = -(mat[0] * mat[12] + mat[1] * mat[13] + mat[2] * mat[14]);
+		ret.mat[13] = -(mat[4] * mat[12] + mat[5] * mat[13] + mat[6] * mat[14]);
+		ret.mat[14] = -(mat[8] * mat[12] + mat[9] * mat[13] + mat[10] * mat[14]);
 
 		return ret;
 	}
 
-	void zero()
+	SIMPLEMATH_CONSTEXPR void zero()
 	{
 		mat[0] = 0.0; mat[4] = 0.0; mat[8] = 0.0; mat[12] = 0.0;
 		mat[1] = 0.0; mat[5] = 0.0; mat[9] = 0.0; mat[13] = 0.0;
@@ -520,7 +719,7 @@ struct mat4
 		mat[3] = 0.0; mat[7] = 0.0; mat[11] = 0.0; mat[15] = 0.0;
 	}
 
-	void identity()
+	SIMPLEMATH_CONSTEXPR void identity()
 	{
 		mat[0] = 1.0; mat[4] = 0.0; mat[8] = 0.0; mat[12] = 0.0;
 		mat[1] = 0.0; mat[5] = 1.0; mat[9] = 0.0; mat[13] = 0.0;
@@ -531,8 +730,8 @@ struct mat4
 	void rotate(const vec3& axis, float angle)
 	{
 		float rad = DegToRad(angle);
-		float c = cosf(rad);
-		float s = sinf(rad);
+		float s, c;
+		math_sincos(rad, s, c);
 
 		vec3 v = axis;
 		v.normalize();
@@ -556,8 +755,8 @@ struct mat4
 	void rotate_x(float angle)
 	{
 		float rad = DegToRad(angle);
-		float c = cosf(rad);
-		float s = sinf(rad);
+		float s, c;
+		math_sincos(rad, s, c);
 
 		mat4 m;
 
@@ -572,8 +771,8 @@ struct mat4
 	void rotate_y(float angle)
 	{
 		float rad = DegToRad(angle);
-		float c = cosf(rad);
-		float s = sinf(rad);
+		float s, c;
+		math_sincos(rad, s, c);
 
 		mat4 m;
 
@@ -588,8 +787,8 @@ struct mat4
 	void rotate_z(float angle)
 	{
 		float rad = DegToRad(angle);
-		float c = cosf(rad);
-		float s = sinf(rad);
+		float s, c;
+		math_sincos(rad, s, c);
 
 		mat4 m;
 
@@ -601,7 +800,7 @@ struct mat4
 		this->operator*=(m);
 	}
 
-	void scale(const vec3& v)
+	SIMPLEMATH_CONSTEXPR_SIMD void scale(const vec3& v)
 	{
 		mat4 m;
 		m.mat[0] = v.x; m.mat[4] = 0.0; m.mat[8] = 0.0; m.mat[12] = 0.0;
@@ -611,7 +810,7 @@ struct mat4
 		this->operator*=(m);
 	}
 
-	void translate(const vec3& v)
+	SIMPLEMATH_CONSTEXPR_SIMD void translate(const vec3& v)
 	{
 		mat4 m;
 		m.mat[0] = 1.0; m.mat[4] = 0.0; m.mat[8] = 0.0; m.mat[12] = v.x;
@@ -621,7 +820,7 @@ struct mat4
 		this->operator*=(m);
 	}
 
-	void reflect(const vec4 &plane)
+	SIMPLEMATH_CONSTEXPR_SIMD void reflect(const vec4 &plane)
 	{
 		float x = plane.x;
 		float y = plane.y;
@@ -678,7 +877,7 @@ struct mat4
 		0    2/h  0           0
 		0    0    1/(zf-zn)   0
 		0    0    zn/(zn-zf)  1*/
-	void ortho(float w, float h, float znear, float zfar)
+	SIMPLEMATH_CONSTEXPR void ortho(float w, float h, float znear, float zfar)
 	{
 		mat4 m0;
 		m0.mat[0] = 2 / w; m0.mat[4] = 0.0; m0.mat[8] = 0.0; m0.mat[12] = 0.0;
@@ -694,7 +893,7 @@ struct mat4
 	0            0            1/(zf-zn)   0
 	(l+r)/(l-r)  (t+b)/(b-t)  zn/(zn-zf)  l
 	*/
-	void ortho_lh(float l, float r, float b, float t, float znear, float zfar)
+	SIMPLEMATH_CONSTEXPR void ortho_lh(float l, float r, float b, float t, float znear, float zfar)
 	{
 		mat4 m0;
 		m0.mat[0] = 2 / (r - l); m0.mat[4] = 0.0; m0.mat[8] = 0.0; m0.mat[12] = (l + r) / (l - r);
@@ -704,7 +903,7 @@ struct mat4
 		*this = m0;
 	}
 
-	void ortho_rh(float l, float r, float b, float t, float znear, float zfar)
+	SIMPLEMATH_CONSTEXPR void ortho_rh(float l, float r, float b, float t, float znear, float zfar)
 	{
 		mat4 m0;
 		m0.mat[0] = 2 / (r - l); m0.mat[4] = 0.0; m0.mat[8] = 0.0; m0.mat[12] = (l + r) / (l - r);
@@ -718,17 +917,29 @@ struct mat4
 	{
 		float intLen;
 
+#if defined(SIMPLEMATH_FAST_MATH)
+		intLen = fast_rsqrt(mat[0] * mat[0] + mat[1] * mat[1] + mat[2] * mat[2]);
+#else
 		intLen = 1.0f / sqrtf(mat[0] * mat[0] + mat[1] * mat[1] + mat[2] * mat[2]);
+#endif
 		mat[0] *= intLen;
 		mat[1] *= intLen;
 		mat[2] *= intLen;
 
+#if defined(SIMPLEMATH_FAST_MATH)
+		intLen = fast_rsqrt(mat[4] * mat[4] + mat[5] * mat[5] + mat[6] * mat[6]);
+#else
 		intLen = 1.0f / sqrtf(mat[4] * mat[4] + mat[5] * mat[5] + mat[6] * mat[6]);
+#endif
 		mat[4] *= intLen;
 		mat[5] *= intLen;
 		mat[6] *= intLen;
 
+#if defined(SIMPLEMATH_FAST_MATH)
+		intLen = fast_rsqrt(mat[8] * mat[8] + mat[9] * mat[9] + mat[10] * mat[10]);
+#else
 		intLen = 1.0f / sqrtf(mat[8] * mat[8] + mat[9] * mat[9] + mat[10] * mat[10]);
+#endif
 		mat[8] *= intLen;
 		mat[9] *= intLen;
 		mat[10] *= intLen;
@@ -757,15 +968,72 @@ struct mat4
 	float mat[16];
 };
 
-inline mat3::mat3(const mat4 &m)
+SIMPLEMATH_ASSERT_PLAIN_TYPE(mat3, 36);
+SIMPLEMATH_ASSERT_PLAIN_TYPE(mat4, 64);
+
+inline SIMPLEMATH_CONSTEXPR mat3::mat3(const mat4 &m): mat()
 {
 	mat[0] = m.mat[0]; mat[3] = m.mat[4]; mat[6] = m.mat[8];
 	mat[1] = m.mat[1]; mat[4] = m.mat[5]; mat[7] = m.mat[9];
 	mat[2] = m.mat[2]; mat[5] = m.mat[6]; mat[8] = m.mat[10];
 }
 
-inline void mul(mat4 &ret, const mat4 &n, const mat4 &m)
+// Each element is 'n0 * m0 + n1 * m1 + n2 * m2 + n3 * m3' summed from the left, the sums are fused with SIMPLEMATH_FMA
+inline SIMPLEMATH_CONSTEXPR_SIMD void mul(mat4 &ret, const mat4 &n, const mat4 &m)
 {
+#if defined(SIMPLEMATH_AVX)
+	if(!SIMPLEMATH_CONSTANT_EVALUATED())
+	{
+		// Two result columns at a time, both halves hold the same column of 'n'
+		__m256 c0 = _mm256_broadcast_ps((const __m128*)&n.mat[0]);
+		__m256 c1 = _mm256_broadcast_ps((const __m128*)&n.mat[4]);
+		__m256 c2 = _mm256_broadcast_ps((const __m128*)&n.mat[8]);
+		__m256 c3 = _mm256_broadcast_ps((const __m128*)&n.mat[12]);
+
+		__m256 m01 = _mm256_loadu_ps(&m.mat[0]);
+		__m256 m23 = _mm256_loadu_ps(&m.mat[8]);
+
+		__m256 r01 = _mm256_mul_ps(c0, _mm256_shuffle_ps(m01, m01, _MM_SHUFFLE(0, 0, 0, 0)));
+		r01 = SIMPLEMATH_MUL_ADD_256(c1, _mm256_shuffle_ps(m01, m01, _MM_SHUFFLE(1, 1, 1, 1)), r01);
+		r01 = SIMPLEMATH_MUL_ADD_256(c2, _mm256_shuffle_ps(m01, m01, _MM_SHUFFLE(2, 2, 2, 2)), r01);
+		r01 = SIMPLEMATH_MUL_ADD_256(c3, _mm256_shuffle_ps(m01, m01, _MM_SHUFFLE(3, 3, 3, 3)), r01);
+
+		__m256 r23 = _mm256_mul_ps(c0, _mm256_shuffle_ps(m23, m23, _MM_SHUFFLE(0, 0, 0, 0)));
+		r23 = SIMPLEMATH_MUL_ADD_256(c1, _mm256_shuffle_ps(m23, m23, _MM_SHUFFLE(1, 1, 1, 1)), r23);
+		r23 = SIMPLEMATH_MUL_ADD_256(c2, _mm256_shuffle_ps(m23, m23, _MM_SHUFFLE(2, 2, 2, 2)), r23);
+		r23 = SIMPLEMATH_MUL_ADD_256(c3, _mm256_shuffle_ps(m23, m23, _MM_SHUFFLE(3, 3, 3, 3)), r23);
+
+		_mm256_storeu_ps(&ret.mat[0], r01);
+		_mm256_storeu_ps(&ret.mat[8], r23);
+		return;
+	}
+#elif defined(SIMPLEMATH_SSE41)
+	if(!SIMPLEMATH_CONSTANT_EVALUATED())
+	{
+		__m128 c0 = _mm_load_ps(&n.mat[0]);
+		__m128 c1 = _mm_load_ps(&n.mat[4]);
+		__m128 c2 = _mm_load_ps(&n.mat[8]);
+		__m128 c3 = _mm_load_ps(&n.mat[12]);
+
+		for(unsigned i = 0; i < 16; i += 4)
+		{
+			__m128 r = _mm_mul_ps(c0, _mm_set1_ps(m.mat[i]));
+			r = SIMPLEMATH_MUL_ADD_128(c1, _mm_set1_ps(m.mat[i + 1]), r);
+			r = SIMPLEMATH_MUL_ADD_128(c2, _mm_set1_ps(m.mat[i + 2]), r);
+			r = SIMPLEMATH_MUL_ADD_128(c3, _mm_set1_ps(m.mat[i + 3]), r);
+
+			_mm_store_ps(&ret.mat[i], r);
+		}
+		return;
+	}
+#endif
+#if defined(SIMPLEMATH_FMA)
+	for(unsigned i = 0; i < 16; i += 4)
+	{
+		for(unsigned j = 0; j < 4; j++)
+			ret.mat[i + j] = mul_add(n.mat[12 + j], m.mat[i + 3], mul_add(n.mat[8 + j], m.mat[i + 2], mul_add(n.mat[4 + j], m.mat[i + 1], n.mat[j] * m.mat[i])));
+	}
+#else
 	ret.mat[0] = n.mat[0] * m.mat[0] + n.mat[4] * m.mat[1] + n.mat[8] * m.mat[2] + n.mat[12] * m.mat[3];
 	ret.mat[1] = n.mat[1] * m.mat[0] + n.mat[5] * m.mat[1] + n.mat[9] * m.mat[2] + n.mat[13] * m.mat[3];
 	ret.mat[2] = n.mat[2] * m.mat[0] + n.mat[6] * m.mat[1] + n.mat[10] * m.mat[2] + n.mat[14] * m.mat[3];
@@ -782,9 +1050,10 @@ inline void mul(mat4 &ret, const mat4 &n, const mat4 &m)
 	ret.mat[13] = n.mat[1] * m.mat[12] + n.mat[5] * m.mat[13] + n.mat[9] * m.mat[14] + n.mat[13] * m.mat[15];
 	ret.mat[14] = n.mat[2] * m.mat[12] + n.mat[6] * m.mat[13] + n.mat[10] * m.mat[14] + n.mat[14] * m.mat[15];
 	ret.mat[15] = n.mat[3] * m.mat[12] + n.mat[7] * m.mat[13] + n.mat[11] * m.mat[14] + n.mat[15] * m.mat[15];
+#endif
 }
 
-inline vec3 mul_m4_v3(const mat4 &m, const vec3 &v)
+inline SIMPLEMATH_CONSTEXPR vec3 mul_m4_v3(const mat4 &m, const vec3 &v)
 {
 	vec3 ret;
 	ret.x = m.mat[0] * v.x + m.mat[4] * v.y + m.mat[8] * v.z + m.mat[12];
@@ -793,7 +1062,7 @@ inline vec3 mul_m4_v3(const mat4 &m, const vec3 &v)
 	return ret;
 }
 
-inline vec3 mul_m4_v3(const vec3 &v, const mat4 &m)
+inline SIMPLEMATH_CONSTEXPR vec3 mul_m4_v3(const vec3 &v, const mat4 &m)
 {
 	vec3 ret;
 	ret.x = m.mat[0] * v.x + m.mat[1] * v.y + m.mat[2] * v.z + m.mat[3];
@@ -802,21 +1071,21 @@ inline vec3 mul_m4_v3(const vec3 &v, const mat4 &m)
 	return ret;
 }
 
-inline void mul_m4_v3(vec3 &ret, const vec3 &v, const mat4 &m)
+inline SIMPLEMATH_CONSTEXPR void mul_m4_v3(vec3 &ret, const vec3 &v, const mat4 &m)
 {
 	ret.x = m.mat[0] * v.x + m.mat[1] * v.y + m.mat[2] * v.z + m.mat[3];
 	ret.y = m.mat[4] * v.x + m.mat[5] * v.y + m.mat[6] * v.z + m.mat[7];
 	ret.z = m.mat[8] * v.x + m.mat[9] * v.y + m.mat[10] * v.z + m.mat[11];
 }
 
-inline void mul_m4_v3_trans(vec3 &ret, const vec3 &v, const mat4 &m)
+inline SIMPLEMATH_CONSTEXPR void mul_m4_v3_trans(vec3 &ret, const vec3 &v, const mat4 &m)
 {
 	ret.x = m.mat[0] * v.x + m.mat[4] * v.y + m.mat[8] * v.z + m.mat[12];
 	ret.y = m.mat[1] * v.x + m.mat[5] * v.y + m.mat[9] * v.z + m.mat[13];
 	ret.z = m.mat[2] * v.x + m.mat[6] * v.y + m.mat[10] * v.z + m.mat[14];
 }
 
-inline void mul_m4_v3(vec4 &ret, const vec3 &v, const mat4 &m)
+inline SIMPLEMATH_CONSTEXPR void mul_m4_v3(vec4 &ret, const vec3 &v, const mat4 &m)
 {
 	ret.x = m.mat[0] * v.x + m.mat[1] * v.y + m.mat[2] * v.z + m.mat[3];
 	ret.y = m.mat[4] * v.x + m.mat[5] * v.y + m.mat[6] * v.z + m.mat[7];
@@ -824,6 +1093,193 @@ inline void mul_m4_v3(vec4 &ret, const vec3 &v, const mat4 &m)
 	ret.w = m.mat[12] * v.x + m.mat[13] * v.y + m.mat[14] * v.z + m.mat[15];
 }
 
+/********************************************************************************/
+/*								Batch transformations							*/
+/********************************************************************************/
+
+// Strides are in bytes, so positions can be read from and written to interleaved vertex buffers
+// Input and output can be the same array if the strides match
+// Each element gets exactly the same result as the matching single vector function
+// Gathers index floats, strides that are not multiples of 4 bytes are transformed by the scalar loop
+
+template<bool translate, bool project>
+inline void transform_vec3_array(vec3 *ret, unsigned retStride, const vec3 *v, unsigned vStride, unsigned count, const mat4 &m)
+{
+	unsigned i = 0;
+
+#if defined(SIMPLEMATH_AVX512)
+	if(vStride % sizeof(float) == 0 && retStride % sizeof(float) == 0)
+	{
+		__m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+		__m512i vIndex = _mm512_mullo_epi32(lanes, _mm512_set1_epi32(int(vStride / sizeof(float))));
+		__m512i retIndex = _mm512_mullo_epi32(lanes, _mm512_set1_epi32(int(retStride / sizeof(float))));
+
+		for(; i + 16 <= count; i += 16)
+		{
+			const float *src = (const float*)((const char*)v + i * vStride);
+			float *dst = (float*)((char*)ret + i * retStride);
+
+			__m512 x = _mm512_i32gather_ps(vIndex, src, 4);
+			__m512 y = _mm512_i32gather_ps(vIndex, src + 1, 4);
+			__m512 z = _mm512_i32gather_ps(vIndex, src + 2, 4);
+
+			__m512 rx = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(m.mat[0]), x), _mm512_mul_ps(_mm512_set1_ps(m.mat[4]), y)), _mm512_mul_ps(_mm512_set1_ps(m.mat[8]), z));
+			__m512 ry = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(m.mat[1]), x), _mm512_mul_ps(_mm512_set1_ps(m.mat[5]), y)), _mm512_mul_ps(_mm512_set1_ps(m.mat[9]), z));
+			__m512 rz = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(m.mat[2]), x), _mm512_mul_ps(_mm512_set1_ps(m.mat[6]), y)), _mm512_mul_ps(_mm512_set1_ps(m.mat[10]), z));
+
+			if(translate)
+			{
+				rx = _mm512_add_ps(rx, _mm512_set1_ps(m.mat[12]));
+				ry = _mm512_add_ps(ry, _mm512_set1_ps(m.mat[13]));
+				rz = _mm512_add_ps(rz, _mm512_set1_ps(m.mat[14]));
+			}
+
+			if(project)
+			{
+				__m512 rw = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(m.mat[3]), x), _mm512_mul_ps(_mm512_set1_ps(m.mat[7]), y)), _mm512_mul_ps(_mm512_set1_ps(m.mat[11]), z));
+				rw = _mm512_add_ps(rw, _mm512_set1_ps(m.mat[15]));
+
+				rx = _mm512_div_ps(rx, rw);
+				ry = _mm512_div_ps(ry, rw);
+				rz = _mm512_div_ps(rz, rw);
+			}
+
+			_mm512_i32scatter_ps(dst, retIndex, rx, 4);
+			_mm512_i32scatter_ps(dst + 1, retIndex, ry, 4);
+			_mm512_i32scatter_ps(dst + 2, retIndex, rz, 4);
+		}
+	}
+#endif
+
+#if defined(SIMPLEMATH_AVX2)
+	if(vStride % sizeof(float) == 0)
+	{
+		__m256i vIndex = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(int(vStride / sizeof(float))));
+
+		for(; i + 8 <= count; i += 8)
+		{
+			const float *src = (const float*)((const char*)v + i * vStride);
+
+			__m256 x = _mm256_i32gather_ps(src, vIndex, 4);
+			__m256 y = _mm256_i32gather_ps(src + 1, vIndex, 4);
+			__m256 z = _mm256_i32gather_ps(src + 2, vIndex, 4);
+
+			__m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m.mat[0]), x), _mm256_mul_ps(_mm256_set1_ps(m.mat[4]), y)), _mm256_mul_ps(_mm256_set1_ps(m.mat[8]), z));
+			__m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m.mat[1]), x), _mm256_mul_ps(_mm256_set1_ps(m.mat[5]), y)), _mm256_mul_ps(_mm256_set1_ps(m.mat[9]), z));
+			__m256 rz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m.mat[2]), x), _mm256_mul_ps(_mm256_set1_ps(m.mat[6]), y)), _mm256_mul_ps(_mm256_set1_ps(m.mat[10]), z));
+
+			if(translate)
+			{
+				rx = _mm256_add_ps(rx, _mm256_set1_ps(m.mat[12]));
+				ry = _mm256_add_ps(ry, _mm256_set1_ps(m.mat[13]));
+				rz = _mm256_add_ps(rz, _mm256_set1_ps(m.mat[14]));
+			}
+
+			if(project)
+			{
+				__m256 rw = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(m.mat[3]), x), _mm256_mul_ps(_mm256_set1_ps(m.mat[7]), y)), _mm256_mul_ps(_mm256_set1_ps(m.mat[11]), z));
+				rw = _mm256_add_ps(rw, _mm256_set1_ps(m.mat[15]));
+
+				rx = _mm256_div_ps(rx, rw);
+				ry = _mm256_div_ps(ry, rw);
+				rz = _mm256_div_ps(rz, rw);
+			}
+
+			// There is no scatter in AVX2
+			float out[3][8];
+
+			_mm256_storeu_ps(out[0], rx);
+			_mm256_storeu_ps(out[1], ry);
+			_mm256_storeu_ps(out[2], rz);
+
+			for(unsigned k = 0; k < 8; k++)
+			{
+				vec3 &dst = *(vec3*)((char*)ret + (i + k) * retStride);
+
+				dst.x = out[0][k];
+				dst.y = out[1][k];
+				dst.z = out[2][k];
+			}
+		}
+	}
+#endif
+
+	for(; i < count; i++)
+	{
+		const vec3 &src = *(const vec3*)((const char*)v + i * vStride);
+		vec3 &dst = *(vec3*)((char*)ret + i * retStride);
+
+		if(project)
+		{
+			dst = m * src;
+		}
+		else if(translate)
+		{
+			mul_m4_v3_trans(dst, vec3(src), m);
+		}
+		else
+		{
+			float x = src.x, y = src.y, z = src.z;
+
+			dst.x = m.mat[0] * x + m.mat[4] * y + m.mat[8] * z;
+			dst.y = m.mat[1] * x + m.mat[5] * y + m.mat[9] * z;
+			dst.z = m.mat[2] * x + m.mat[6] * y + m.mat[10] * z;
+		}
+	}
+}
+
+// Affine point transformation (w = 1), same as mul_m4_v3_trans
+inline void transform_points(vec3 *ret, unsigned retStride, const vec3 *v, unsigned vStride, unsigned count, const mat4 &m)
+{
+	transform_vec3_array<true, false>(ret, retStride, v, vStride, count, m);
+}
+
+inline void transform_points(vec3 *ret, const vec3 *v, unsigned count, const mat4 &m)
+{
+	transform_vec3_array<true, false>(ret, sizeof(vec3), v, sizeof(vec3), count, m);
+}
+
+// Direction transformation (w = 0), translation is ignored
+inline void transform_directions(vec3 *ret, unsigned retStride, const vec3 *v, unsigned vStride, unsigned count, const mat4 &m)
+{
+	transform_vec3_array<false, false>(ret, retStride, v, vStride, count, m);
+}
+
+inline void transform_directions(vec3 *ret, const vec3 *v, unsigned count, const mat4 &m)
+{
+	transform_vec3_array<false, false>(ret, sizeof(vec3), v, sizeof(vec3), count, m);
+}
+
+// Point transformation with perspective divide, same as mat4::operator*(const vec3&)
+inline void project_points(vec3 *ret, unsigned retStride, const vec3 *v, unsigned vStride, unsigned count, const mat4 &m)
+{
+	transform_vec3_array<true, true>(ret, retStride, v, vStride, count, m);
+}
+
+inline void project_points(vec3 *ret, const vec3 *v, unsigned count, const mat4 &m)
+{
+	transform_vec3_array<true, true>(ret, sizeof(vec3), v, sizeof(vec3), count, m);
+}
+
+// Batch matrix inversion, 'ret' and 'm' can be the same array
+inline void inverse(mat4 *ret, const mat4 *m, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i] = m[i].inverse();
+}
+
+inline void inverse_affine(mat4 *ret, const mat4 *m, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i] = m[i].inverse_affine();
+}
+
+inline void inverse_rigid(mat4 *ret, const mat4 *m, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i] = m[i].inverse_rigid();
+}
+
 inline vec4 project_vector(const mat4& m, vec4 point)
 {
 	point = m * point;
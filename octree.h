@@ -0,0 +1,583 @@
+#pragma once
+
+#include <float.h>
+
+#include <vector>
+
+#include "plane.h"
+#include "frustum.h"
+
+/********************************************************************************/
+/*								octree_node										*/
+/********************************************************************************/
+
+// Cube of the octree grid
+// Objects stored in a node are not larger than its half size and are contained in its loose bounds: the cube extended by the half size on every side
+struct octree_node
+{
+	vec3 center;
+	float halfSize;
+
+	unsigned children[8];	// 0 if there is no child, the root is never a child
+	unsigned parent;
+	unsigned depth;
+
+	unsigned firstBlock;	// ~0u if the node has no objects
+	unsigned objectCount;	// Objects stored in the node
+	unsigned count;			// Objects in the subtree, empty nodes are released
+};
+
+// Objects of a node are stored in a list of blocks, only the first block can be partially filled
+struct octree_block
+{
+	enum
+	{
+		SIZE = 8
+	};
+
+	aabb boxes[SIZE];
+	unsigned objects[SIZE];
+
+	unsigned next;	// ~0u terminates the list
+};
+
+// Location of an object
+struct octree_object
+{
+	unsigned node;	// ~0u for a free handle
+	unsigned block;	// Next free handle for free handles
+	unsigned slot;
+};
+
+/********************************************************************************/
+/*								octree											*/
+/********************************************************************************/
+
+// Loose octree over dynamic objects with aabb bounds
+// Insert, remove and move take O(depth) steps, a move inside of the loose bounds of the current node only updates the box
+// Nodes, object blocks and handles are stored in flat arrays with free lists, handles returned by insert stay valid until the object is removed
+// Objects outside of the octree bounds are stored in the root, they are still found by the queries
+// Query results are object handles
+struct octree
+{
+	enum
+	{
+		MAX_DEPTH = 16,
+		STACK_SIZE = 7 * MAX_DEPTH + 1
+	};
+
+	// 'bounds' are extended to a cube, nodes at 'maxDepth' have the size of the cube divided by 2^maxDepth
+	// Queries are faster when the nodes at 'maxDepth' hold several objects, deeper levels with one or two objects per node add more traversal than they save
+	octree(const aabb& bounds = aabb(vec3(0.0f), vec3(1.0f)), unsigned maxDepth = 8)
+	{
+		reset(bounds, maxDepth);
+	}
+
+	// Removes all objects
+	void reset(const aabb& bounds, unsigned maxDepth = 8)
+	{
+		this->maxDepth = maxDepth < unsigned(MAX_DEPTH) ? maxDepth : unsigned(MAX_DEPTH);
+
+		float halfSize = bounds.size.x > bounds.size.y ? bounds.size.x : bounds.size.y;
+		halfSize = bounds.size.z > halfSize ? bounds.size.z : halfSize;
+
+		nodes.clear();
+		blocks.clear();
+		objects.clear();
+
+		freeNode = 0;
+		freeBlock = ~0u;
+		freeObject = ~0u;
+
+		nodes.push_back(octree_node());
+		init_node(nodes[0], bounds.center, halfSize, 0, 0);
+	}
+
+	unsigned insert(const aabb& box)
+	{
+		unsigned index;
+
+		if(freeObject != ~0u)
+		{
+			index = freeObject;
+			freeObject = objects[index].block;
+		}
+		else
+		{
+			index = unsigned(objects.size());
+			objects.push_back(octree_object());
+		}
+
+		link(index, find_node(box), box);
+
+		return index;
+	}
+
+	void remove(unsigned object)
+	{
+		unlink(object);
+
+		objects[object].node = ~0u;
+		objects[object].block = freeObject;
+		freeObject = object;
+	}
+
+	void move(unsigned object, const aabb& box)
+	{
+		const octree_object &obj = objects[object];
+
+		if(node_keeps(nodes[obj.node], box))
+		{
+			blocks[obj.block].boxes[obj.slot] = box;
+			return;
+		}
+
+		unlink(object);
+
+		link(object, find_node(box), box);
+	}
+
+	const aabb& bounds(unsigned object) const
+	{
+		return blocks[objects[object].block].boxes[objects[object].slot];
+	}
+
+	// Queries
+
+	// Appends handles of objects with bounds that overlap the box
+	void aabb_overlap(const aabb& box, std::vector<unsigned>& result) const
+	{
+		vec3 minp = box.min_point();
+		vec3 maxp = box.max_point();
+
+		unsigned stack[STACK_SIZE];
+		unsigned stackSize = 0;
+
+		stack[stackSize++] = 0;
+
+		while(stackSize)
+		{
+			const octree_node &node = nodes[stack[--stackSize]];
+
+			// Objects in the root can be outside of its bounds
+			if(node.depth && !overlap(node.center - vec3(node.halfSize * 2.0f), node.center + vec3(node.halfSize * 2.0f), minp, maxp))
+				continue;
+
+			for(unsigned b = node.firstBlock, count = first_block_count(node); b != ~0u; b = blocks[b].next, count = octree_block::SIZE)
+			{
+				const octree_block &block = blocks[b];
+
+				for(unsigned i = 0; i < count; i++)
+				{
+					if(overlap(block.boxes[i].min_point(), block.boxes[i].max_point(), minp, maxp))
+						result.push_back(block.objects[i]);
+				}
+			}
+
+			push_children(node, stack, stackSize);
+		}
+	}
+
+	// Appends handles of objects with bounds that overlap the sphere
+	void sphere_overlap(const vec3& center, float radius, std::vector<unsigned>& result) const
+	{
+		unsigned stack[STACK_SIZE];
+		unsigned stackSize = 0;
+
+		stack[stackSize++] = 0;
+
+		while(stackSize)
+		{
+			const octree_node &node = nodes[stack[--stackSize]];
+
+			if(node.depth && distance_squared(center, node.center, vec3(node.halfSize * 2.0f)) > radius * radius)
+				continue;
+
+			for(unsigned b = node.firstBlock, count = first_block_count(node); b != ~0u; b = blocks[b].next, count = octree_block::SIZE)
+			{
+				const octree_block &block = blocks[b];
+
+				for(unsigned i = 0; i < count; i++)
+				{
+					if(distance_squared(center, block.boxes[i].center, block.boxes[i].size) <= radius * radius)
+						result.push_back(block.objects[i]);
+				}
+			}
+
+			push_children(node, stack, stackSize);
+		}
+	}
+
+	// Appends handles of objects with bounds that are visible in the frustum (see frustum::aabb_classify)
+	// Nodes inside of the frustum are accepted without tests
+	void frustum_overlap(const frustum& f, std::vector<unsigned>& result) const
+	{
+		unsigned stack[STACK_SIZE];
+		unsigned stackMask[STACK_SIZE];
+		unsigned stackSize = 0;
+
+		stack[stackSize] = 0;
+		stackMask[stackSize++] = frustum::PLANE_MASK_ALL;
+
+		while(stackSize)
+		{
+			--stackSize;
+
+			const octree_node &node = nodes[stack[stackSize]];
+			unsigned planeMask = stackMask[stackSize];
+
+			if(node.depth && planeMask && f.aabb_classify(aabb(node.center, vec3(node.halfSize * 2.0f)), planeMask) == frustum::CULL_OUTSIDE)
+				continue;
+
+			for(unsigned b = node.firstBlock, count = first_block_count(node); b != ~0u; b = blocks[b].next, count = octree_block::SIZE)
+			{
+				const octree_block &block = blocks[b];
+
+				for(unsigned i = 0; i < count; i++)
+				{
+					unsigned objectMask = planeMask;
+
+					if(!objectMask || f.aabb_classify(block.boxes[i], objectMask) != frustum::CULL_OUTSIDE)
+						result.push_back(block.objects[i]);
+				}
+			}
+
+			for(unsigned i = 0; i < 8; i++)
+			{
+				if(node.children[i])
+				{
+					stack[stackSize] = node.children[i];
+					stackMask[stackSize++] = planeMask;
+				}
+			}
+		}
+	}
+
+	// Returns the handle of the object with the closest entry point of the line (in the direction of 'l.n') or -1
+	// The distance is 0 if the line starts inside of the box
+	int ray_nearest(const line& l, float& distance, float maxDistance = FLT_MAX) const
+	{
+		int nearest = -1;
+
+		distance = maxDistance;
+
+		vec3 invDir = line_inverse_direction(l);
+
+		unsigned stack[STACK_SIZE];
+		unsigned stackSize = 0;
+
+		stack[stackSize++] = 0;
+
+		while(stackSize)
+		{
+			const octree_node &node = nodes[stack[--stackSize]];
+
+			if(node.depth && line_intersect_aabb_distance(l.p, invDir, node.center - vec3(node.halfSize * 2.0f), node.center + vec3(node.halfSize * 2.0f), distance) < 0.0f)
+				continue;
+
+			for(unsigned b = node.firstBlock, count = first_block_count(node); b != ~0u; b = blocks[b].next, count = octree_block::SIZE)
+			{
+				const octree_block &block = blocks[b];
+
+				for(unsigned i = 0; i < count; i++)
+				{
+					float d = line_intersect_aabb_distance(l.p, invDir, block.boxes[i].min_point(), block.boxes[i].max_point(), distance);
+
+					if(d >= 0.0f && d < distance)
+					{
+						distance = d;
+						nearest = int(block.objects[i]);
+					}
+				}
+			}
+
+			push_children(node, stack, stackSize);
+		}
+
+		return nearest;
+	}
+
+	// Returns true if the line hits any object closer than 'maxDistance'
+	bool ray_any(const line& l, float maxDistance = FLT_MAX) const
+	{
+		vec3 invDir = line_inverse_direction(l);
+
+		unsigned stack[STACK_SIZE];
+		unsigned stackSize = 0;
+
+		stack[stackSize++] = 0;
+
+		while(stackSize)
+		{
+			const octree_node &node = nodes[stack[--stackSize]];
+
+			if(node.depth && line_intersect_aabb_distance(l.p, invDir, node.center - vec3(node.halfSize * 2.0f), node.center + vec3(node.halfSize * 2.0f), maxDistance) < 0.0f)
+				continue;
+
+			for(unsigned b = node.firstBlock, count = first_block_count(node); b != ~0u; b = blocks[b].next, count = octree_block::SIZE)
+			{
+				const octree_block &block = blocks[b];
+
+				for(unsigned i = 0; i < count; i++)
+				{
+					if(line_intersect_aabb_distance(l.p, invDir, block.boxes[i].min_point(), block.boxes[i].max_point(), maxDistance) >= 0.0f)
+						return true;
+				}
+			}
+
+			push_children(node, stack, stackSize);
+		}
+
+		return false;
+	}
+
+	std::vector<octree_node> nodes;
+	std::vector<octree_block> blocks;
+	std::vector<octree_object> objects;
+
+	unsigned maxDepth;
+
+private:
+	static void init_node(octree_node& node, const vec3& center, float halfSize, unsigned parent, unsigned depth)
+	{
+		node.center = center;
+		node.halfSize = halfSize;
+
+		for(unsigned i = 0; i < 8; i++)
+			node.children[i] = 0;
+
+		node.parent = parent;
+		node.depth = depth;
+
+		node.firstBlock = ~0u;
+		node.objectCount = 0;
+		node.count = 0;
+	}
+
+	// Loose bounds of the node contain the box
+	static bool node_contains(const octree_node& node, const aabb& box)
+	{
+		vec3 d = box.center - node.center;
+
+		float limit = node.halfSize * 2.0f;
+
+		return fabsf(d.x) + box.size.x <= limit && fabsf(d.y) + box.size.y <= limit && fabsf(d.z) + box.size.z <= limit;
+	}
+
+	static float max_extent(const aabb& box)
+	{
+		float extent = box.size.x > box.size.y ? box.size.x : box.size.y;
+
+		return box.size.z > extent ? box.size.z : extent;
+	}
+
+	// The box is contained in the node and doesn't belong to a deeper level
+	bool node_keeps(const octree_node& node, const aabb& box) const
+	{
+		float extent = max_extent(box);
+
+		return extent <= node.halfSize && (extent > node.halfSize * 0.5f || node.depth == maxDepth) && node_contains(node, box);
+	}
+
+	// Deepest node that is not smaller than the box and contains it, nodes on the path are created
+	unsigned find_node(const aabb& box)
+	{
+		float extent = max_extent(box);
+
+		unsigned current = 0;
+
+		while(nodes[current].depth < maxDepth && extent <= nodes[current].halfSize * 0.5f)
+		{
+			const octree_node &node = nodes[current];
+
+			unsigned octant = (box.center.x >= node.center.x ? 1 : 0) | (box.center.y >= node.center.y ? 2 : 0) | (box.center.z >= node.center.z ? 4 : 0);
+
+			unsigned child = node.children[octant];
+
+			if(!child)
+			{
+				float childHalfSize = node.halfSize * 0.5f;
+
+				vec3 childCenter = node.center + vec3(octant & 1 ? childHalfSize : -childHalfSize, octant & 2 ? childHalfSize : -childHalfSize, octant & 4 ? childHalfSize : -childHalfSize);
+
+				octree_node childNode;
+				init_node(childNode, childCenter, childHalfSize, current, node.depth + 1);
+
+				// Objects outside of the octree bounds stop at the last node that contains them
+				if(!node_contains(childNode, box))
+					break;
+
+				child = allocate_node(childNode);
+
+				nodes[current].children[octant] = child;
+			}
+			else if(!node_contains(nodes[child], box))
+			{
+				break;
+			}
+
+			current = child;
+		}
+
+		return current;
+	}
+
+	unsigned allocate_node(const octree_node& node)
+	{
+		if(freeNode)
+		{
+			unsigned index = freeNode;
+			freeNode = nodes[index].parent;
+
+			nodes[index] = node;
+			return index;
+		}
+
+		nodes.push_back(node);
+
+		return unsigned(nodes.size() - 1);
+	}
+
+	// Objects are added to the first block of the node
+	void link(unsigned object, unsigned node, const aabb& box)
+	{
+		octree_node &target = nodes[node];
+
+		unsigned slot = target.objectCount % octree_block::SIZE;
+
+		if(slot == 0)
+		{
+			unsigned block;
+
+			if(freeBlock != ~0u)
+			{
+				block = freeBlock;
+				freeBlock = blocks[block].next;
+			}
+			else
+			{
+				block = unsigned(blocks.size());
+				blocks.push_back(octree_block());
+			}
+
+			blocks[block].next = target.firstBlock;
+			target.firstBlock = block;
+		}
+
+		blocks[target.firstBlock].boxes[slot] = box;
+		blocks[target.firstBlock].objects[slot] = object;
+
+		target.objectCount++;
+
+		objects[object].node = node;
+		objects[object].block = target.firstBlock;
+		objects[object].slot = slot;
+
+		for(unsigned i = node; ; i = nodes[i].parent)
+		{
+			nodes[i].count++;
+
+			if(!i)
+				break;
+		}
+	}
+
+	// The last object of the first block takes the place of the removed one
+	// Empty blocks and nodes are added to the free lists, nodes are linked through octree_node::parent
+	void unlink(unsigned object)
+	{
+		const octree_object &obj = objects[object];
+
+		octree_node &source = nodes[obj.node];
+
+		octree_block &first = blocks[source.firstBlock];
+
+		unsigned last = (source.objectCount - 1) % octree_block::SIZE;
+
+		if(source.firstBlock != obj.block || last != obj.slot)
+		{
+			unsigned moved = first.objects[last];
+
+			blocks[obj.block].boxes[obj.slot] = first.boxes[last];
+			blocks[obj.block].objects[obj.slot] = moved;
+
+			objects[moved].block = obj.block;
+			objects[moved].slot = obj.slot;
+		}
+
+		source.objectCount--;
+
+		if(last == 0)
+		{
+			unsigned next = first.next;
+
+			first.next = freeBlock;
+			freeBlock = source.firstBlock;
+
+			source.firstBlock = next;
+		}
+
+		for(unsigned i = obj.node; i; )
+		{
+			octree_node &node = nodes[i];
+
+			unsigned parent = node.parent;
+
+			if(--node.count == 0)
+			{
+				for(unsigned k = 0; k < 8; k++)
+				{
+					if(nodes[parent].children[k] == i)
+						nodes[parent].children[k] = 0;
+				}
+
+				node.parent = freeNode;
+				freeNode = i;
+			}
+
+			i = parent;
+		}
+
+		nodes[0].count--;
+	}
+
+	// Number of objects in the first block of a node
+	static unsigned first_block_count(const octree_node& node)
+	{
+		return (node.objectCount + octree_block::SIZE - 1) % octree_block::SIZE + 1;
+	}
+
+	void push_children(const octree_node& node, unsigned* stack, unsigned& stackSize) const
+	{
+		for(unsigned i = 0; i < 8; i++)
+		{
+			if(node.children[i])
+				stack[stackSize++] = node.children[i];
+		}
+	}
+
+	static bool overlap(const vec3& minA, const vec3& maxA, const vec3& minB, const vec3& maxB)
+	{
+		return minA.x <= maxB.x && maxA.x >= minB.x && minA.y <= maxB.y && maxA.y >= minB.y && minA.z <= maxB.z && maxA.z >= minB.z;
+	}
+
+	// Squared distance from the point to the box
+	static float distance_squared(const vec3& pos, const vec3& center, const vec3& size)
+	{
+		vec3 d = pos - center;
+
+		float dx = fabsf(d.x) - size.x;
+		float dy = fabsf(d.y) - size.y;
+		float dz = fabsf(d.z) - size.z;
+
+		dx = dx > 0.0f ? dx : 0.0f;
+		dy = dy > 0.0f ? dy : 0.0f;
+		dz = dz > 0.0f ? dz : 0.0f;
+
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	unsigned freeNode;
+	unsigned freeBlock;
+	unsigned freeObject;
+};
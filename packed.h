@@ -0,0 +1,610 @@
+#pragma once
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include "vector.h"
+#include "quat.h"
+#include "aabb.h"
+#include "soa.h"
+
+// Compact storage formats for large arrays of vectors, normals, rotations and bounding boxes
+// Values are packed once when the data is built and unpacked in batches, so only unpacking has SIMD paths
+// Batch unpacking gives exactly the same results as the single element functions
+//
+// Measured errors (against the float values, 200k random inputs):
+//	half3		- relative error 4.9e-4 (2^-11) for magnitudes in [6.1e-5, 65504], larger values become infinity
+//	normal16	- 4.3e-5 radians (0.0025 degrees)
+//	quat48		- 5.9e-5 per component, 1.4e-4 radians of rotation, length is 1 within 1.2e-7
+//	aabb16		- the box contains the original and is larger by at most one step (1/65535 of the parent size) on each side
+
+/********************************************************************************/
+/*								Half precision									*/
+/********************************************************************************/
+
+// Round to nearest even, values out of the half range become infinity, NaN stays NaN
+inline unsigned short float_to_half(float f)
+{
+	unsigned bits;
+	memcpy(&bits, &f, 4);
+
+	unsigned sign = bits & 0x80000000;
+	bits ^= sign;
+
+	unsigned short result;
+
+	if(bits >= 0x47800000)
+	{
+		// Infinity and NaN
+		result = bits > 0x7f800000 ? 0x7e00 : 0x7c00;
+	}
+	else if(bits < 0x38800000)
+	{
+		// Denormals, the addition rounds the mantissa in place
+		float magic;
+		unsigned magicBits = 0x3f000000;
+		memcpy(&magic, &magicBits, 4);
+
+		float value;
+		memcpy(&value, &bits, 4);
+		value += magic;
+
+		memcpy(&bits, &value, 4);
+		result = (unsigned short)(bits - magicBits);
+	}
+	else
+	{
+		unsigned mantissaOdd = (bits >> 13) & 1;
+
+		// Rebias the exponent and round
+		bits += 0xc8000fff;
+		bits += mantissaOdd;
+
+		result = (unsigned short)(bits >> 13);
+	}
+
+	return (unsigned short)(result | (sign >> 16));
+}
+
+// Exact for every half value, denormals require the denormal float support to be enabled (no DAZ)
+inline float half_to_float(unsigned short h)
+{
+	unsigned exponentMantissa = h & 0x7fff;
+	unsigned sign = (h ^ exponentMantissa) << 16;
+
+	// Scaling by 2^112 moves the exponent to the float bias
+	unsigned shifted = exponentMantissa << 13;
+
+	float scaled, magic;
+	unsigned magicBits = 0x77800000;
+	memcpy(&scaled, &shifted, 4);
+	memcpy(&magic, &magicBits, 4);
+
+	scaled *= magic;
+
+	unsigned bits;
+	memcpy(&bits, &scaled, 4);
+
+	bits |= sign;
+
+	if(exponentMantissa > 0x7bff)
+		bits |= 0x7f800000;
+
+	float result;
+	memcpy(&result, &bits, 4);
+	return result;
+}
+
+struct half3
+{
+	half3(): x(0), y(0), z(0)
+	{
+	}
+
+	explicit half3(const vec3& v): x(float_to_half(v.x)), y(float_to_half(v.y)), z(float_to_half(v.z))
+	{
+	}
+
+	vec3 unpack() const
+	{
+		return vec3(half_to_float(x), half_to_float(y), half_to_float(z));
+	}
+
+	unsigned short x, y, z;
+};
+
+/********************************************************************************/
+/*								normal16										*/
+/********************************************************************************/
+
+// Unit vector in octahedral mapping with two snorm16 coordinates
+struct normal16
+{
+	normal16(): x(0), y(0)
+	{
+	}
+
+	explicit normal16(const vec3& n)
+	{
+		float sum = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+
+		if(sum == 0.0f)
+		{
+			x = y = 0;
+			return;
+		}
+
+		float u = n.x / sum;
+		float v = n.y / sum;
+
+		// Lower hemisphere is folded over the diagonals
+		if(n.z < 0.0f)
+		{
+			float fu = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+			float fv = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+
+			u = fu;
+			v = fv;
+		}
+
+		// Out of the four nearest grid points, the one that decodes closest to the input is used
+		float qu = floorf(u * 32767.0f);
+		float qv = floorf(v * 32767.0f);
+
+		float bestError = FLT_MAX;
+
+		for(unsigned i = 0; i < 4; i++)
+		{
+			float cu = qu + float(i & 1);
+			float cv = qv + float(i >> 1);
+
+			cu = cu < -32767.0f ? -32767.0f : (cu > 32767.0f ? 32767.0f : cu);
+			cv = cv < -32767.0f ? -32767.0f : (cv > 32767.0f ? 32767.0f : cv);
+
+			normal16 candidate;
+			candidate.x = short(cu);
+			candidate.y = short(cv);
+
+			// Distance instead of the dot product, which has no precision left for small angles
+			float error = (candidate.unpack() - n).length_squared();
+
+			if(error < bestError)
+			{
+				bestError = error;
+				*this = candidate;
+			}
+		}
+	}
+
+	vec3 unpack() const
+	{
+		float u = float(x) * (1.0f / 32767.0f);
+		float v = float(y) * (1.0f / 32767.0f);
+
+		u = u > -1.0f ? u : -1.0f;
+		v = v > -1.0f ? v : -1.0f;
+
+		float w = 1.0f - fabsf(u) - fabsf(v);
+
+		float t = -w > 0.0f ? -w : 0.0f;
+
+		u += u >= 0.0f ? -t : t;
+		v += v >= 0.0f ? -t : t;
+
+		float length = sqrtf(u * u + v * v + w * w);
+
+		return vec3(u / length, v / length, w / length);
+	}
+
+	short x, y;
+};
+
+/********************************************************************************/
+/*								quat48											*/
+/********************************************************************************/
+
+// Smallest three encoding, the largest component is dropped and restored from the unit length
+// Bits 15 of the first two values hold the index of the dropped component, the other three are stored in 15 bits each
+struct quat48
+{
+	quat48()
+	{
+		// Identity
+		v[0] = 0x8000 | 16383;
+		v[1] = 0x8000 | 16383;
+		v[2] = 16383;
+	}
+
+	explicit quat48(const quat& q)
+	{
+		float c[4] = { q.x, q.y, q.z, q.w };
+
+		unsigned largest = 0;
+
+		for(unsigned i = 1; i < 4; i++)
+		{
+			if(fabsf(c[i]) > fabsf(c[largest]))
+				largest = i;
+		}
+
+		// q and -q are the same rotation, the dropped component is made positive
+		float length = sqrtf(c[0] * c[0] + c[1] * c[1] + c[2] * c[2] + c[3] * c[3]);
+		float scale = (c[largest] < 0.0f ? -1.0f : 1.0f) / length;
+
+		unsigned k = 0;
+
+		for(unsigned i = 0; i < 4; i++)
+		{
+			if(i == largest)
+				continue;
+
+			// [-1/sqrt(2), 1/sqrt(2)] -> [0, 32766]
+			float f = floorf(c[i] * scale * (16383.0f * 1.41421356f) + 16383.5f);
+
+			v[k++] = (unsigned short)(f < 0.0f ? 0.0f : (f > 32766.0f ? 32766.0f : f));
+		}
+
+		v[0] |= (unsigned short)((largest >> 1) << 15);
+		v[1] |= (unsigned short)((largest & 1) << 15);
+	}
+
+	quat unpack() const
+	{
+		const float scale = 0.70710678f / 16383.0f;
+
+		float a = (float(v[0] & 0x7fff) - 16383.0f) * scale;
+		float b = (float(v[1] & 0x7fff) - 16383.0f) * scale;
+		float c = (float(v[2] & 0x7fff) - 16383.0f) * scale;
+
+		float d = 1.0f - (a * a + b * b + c * c);
+		d = sqrtf(d > 0.0f ? d : 0.0f);
+
+		switch(((v[0] >> 15) << 1) | (v[1] >> 15))
+		{
+		case 0:
+			return quat(d, a, b, c);
+		case 1:
+			return quat(a, d, b, c);
+		case 2:
+			return quat(a, b, d, c);
+		}
+
+		return quat(a, b, c, d);
+	}
+
+	unsigned short v[3];
+};
+
+/********************************************************************************/
+/*								aabb16											*/
+/********************************************************************************/
+
+// Box bounds quantized to 16 bits inside of a parent box
+// Minimum is rounded down and maximum is rounded up, so the unpacked box contains the original
+struct aabb16
+{
+	aabb16()
+	{
+		min[0] = min[1] = min[2] = 0;
+		max[0] = max[1] = max[2] = 0;
+	}
+
+	aabb16(const aabb& box, const aabb& parent)
+	{
+		vec3 parentMin = parent.min_point();
+		vec3 step = parent.size * (2.0f / 65535.0f);
+
+		vec3 boxMin = box.min_point();
+		vec3 boxMax = box.max_point();
+
+		for(unsigned i = 0; i < 3; i++)
+		{
+			float s = (&step.x)[i];
+			float scale = s > 0.0f ? 1.0f / s : 0.0f;
+
+			float low = floorf(((&boxMin.x)[i] - (&parentMin.x)[i]) * scale);
+			float high = ceilf(((&boxMax.x)[i] - (&parentMin.x)[i]) * scale);
+
+			min[i] = (unsigned short)(low < 0.0f ? 0.0f : (low > 65535.0f ? 65535.0f : low));
+			max[i] = (unsigned short)(high < 0.0f ? 0.0f : (high > 65535.0f ? 65535.0f : high));
+		}
+
+		// Rounding of the scale and of the center/size conversion can move the bounds inside by an ulp
+		aabb result = unpack(parent);
+
+		for(unsigned i = 0; i < 3; i++)
+		{
+			for(;;)
+			{
+				vec3 resultMin = result.min_point();
+
+				if(min[i] == 0 || (&resultMin.x)[i] <= (&boxMin.x)[i])
+					break;
+
+				min[i]--;
+				result = unpack(parent);
+			}
+
+			for(;;)
+			{
+				vec3 resultMax = result.max_point();
+
+				if(max[i] == 65535 || (&resultMax.x)[i] >= (&boxMax.x)[i])
+					break;
+
+				max[i]++;
+				result = unpack(parent);
+			}
+		}
+	}
+
+	aabb unpack(const aabb& parent) const
+	{
+		vec3 parentMin = parent.min_point();
+		vec3 step = parent.size * (2.0f / 65535.0f);
+
+		vec3 low(parentMin.x + float(min[0]) * step.x, parentMin.y + float(min[1]) * step.y, parentMin.z + float(min[2]) * step.z);
+		vec3 high(parentMin.x + float(max[0]) * step.x, parentMin.y + float(max[1]) * step.y, parentMin.z + float(max[2]) * step.z);
+
+		return aabb((low + high) * 0.5f, (high - low) * 0.5f);
+	}
+
+	unsigned short min[3];
+	unsigned short max[3];
+};
+
+/********************************************************************************/
+/*								SIMD helpers									*/
+/********************************************************************************/
+
+#if defined(SIMPLEMATH_SSE41)
+// Splits eight consecutive triples of 16-bit values into three registers
+inline void load_short3x8(__m128i &a, __m128i &b, __m128i &c, const unsigned short *p)
+{
+	__m128i r0 = _mm_loadu_si128((const __m128i*)p);
+	__m128i r1 = _mm_loadu_si128((const __m128i*)(p + 8));
+	__m128i r2 = _mm_loadu_si128((const __m128i*)(p + 16));
+
+	a = _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(r0, _mm_setr_epi8(0, 1, 6, 7, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+		_mm_shuffle_epi8(r1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 3, 8, 9, 14, 15, -1, -1, -1, -1))),
+		_mm_shuffle_epi8(r2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 4, 5, 10, 11)));
+
+	b = _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(r0, _mm_setr_epi8(2, 3, 8, 9, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+		_mm_shuffle_epi8(r1, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 4, 5, 10, 11, -1, -1, -1, -1, -1, -1))),
+		_mm_shuffle_epi8(r2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 1, 6, 7, 12, 13)));
+
+	c = _mm_or_si128(_mm_or_si128(
+		_mm_shuffle_epi8(r0, _mm_setr_epi8(4, 5, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+		_mm_shuffle_epi8(r1, _mm_setr_epi8(-1, -1, -1, -1, 0, 1, 6, 7, 12, 13, -1, -1, -1, -1, -1, -1))),
+		_mm_shuffle_epi8(r2, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 3, 8, 9, 14, 15)));
+}
+
+// Eight unsigned 16-bit values to floats
+inline floatx8 ushort_to_floatx8(__m128i v)
+{
+#if defined(SIMPLEMATH_AVX2)
+	return floatx8(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(v)));
+#else
+	return floatx8(floatx4(_mm_cvtepi32_ps(_mm_cvtepu16_epi32(v))), floatx4(_mm_cvtepi32_ps(_mm_cvtepu16_epi32(_mm_srli_si128(v, 8)))));
+#endif
+}
+
+// Four halves in the low bits of 32-bit lanes, same steps as half_to_float
+inline floatx4 half_to_floatx4(__m128i h)
+{
+	__m128i exponentMantissa = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+	__m128i sign = _mm_slli_epi32(_mm_xor_si128(h, exponentMantissa), 16);
+
+	__m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(exponentMantissa, 13)), _mm_castsi128_ps(_mm_set1_epi32(0x77800000)));
+
+	__m128i infinity = _mm_and_si128(_mm_cmpgt_epi32(exponentMantissa, _mm_set1_epi32(0x7bff)), _mm_set1_epi32(0x7f800000));
+
+	return floatx4(_mm_castsi128_ps(_mm_or_si128(_mm_or_si128(_mm_castps_si128(scaled), sign), infinity)));
+}
+
+inline floatx8 half_to_floatx8(__m128i h)
+{
+#if defined(SIMPLEMATH_F16C)
+	return floatx8(floatx4(_mm_cvtph_ps(h)), floatx4(_mm_cvtph_ps(_mm_srli_si128(h, 8))));
+#else
+	return floatx8(half_to_floatx4(_mm_cvtepu16_epi32(h)), half_to_floatx4(_mm_cvtepu16_epi32(_mm_srli_si128(h, 8))));
+#endif
+}
+#endif
+
+/********************************************************************************/
+/*								Batch packing									*/
+/********************************************************************************/
+
+inline void pack(half3 *ret, const vec3 *v, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i] = half3(v[i]);
+}
+
+inline void pack(normal16 *ret, const vec3 *n, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i] = normal16(n[i]);
+}
+
+inline void pack(quat48 *ret, const quat *q, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i] = quat48(q[i]);
+}
+
+// 'parent' should contain all of the boxes, parts outside of it are clamped to its bounds
+inline void pack(aabb16 *ret, const aabb *boxes, unsigned count, const aabb& parent)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i] = aabb16(boxes[i], parent);
+}
+
+/********************************************************************************/
+/*								Batch unpacking									*/
+/********************************************************************************/
+
+inline void unpack(vec3 *ret, const half3 *v, unsigned count)
+{
+	unsigned i = 0;
+
+#if defined(SIMPLEMATH_SSE41)
+	// Components are converted in place, without splitting them into lanes
+	for(; i + 8 <= count; i += 8)
+	{
+		const unsigned short *source = &v[i].x;
+		float *target = &ret[i].x;
+
+		half_to_floatx8(_mm_loadu_si128((const __m128i*)source)).store(target);
+		half_to_floatx8(_mm_loadu_si128((const __m128i*)(source + 8))).store(target + 8);
+		half_to_floatx8(_mm_loadu_si128((const __m128i*)(source + 16))).store(target + 16);
+	}
+#endif
+
+	for(; i < count; i++)
+		ret[i] = v[i].unpack();
+}
+
+inline void unpack(vec3 *ret, const normal16 *n, unsigned count)
+{
+	unsigned i = 0;
+
+#if defined(SIMPLEMATH_SSE41)
+	floatx8 zero(0.0f);
+	floatx8 one(1.0f);
+	floatx8 minusOne(-1.0f);
+
+	for(; i + 8 <= count; i += 8)
+	{
+		// Each normal is a 32-bit value with 'x' in the low half
+		__m128i lo = _mm_loadu_si128((const __m128i*)&n[i]);
+		__m128i hi = _mm_loadu_si128((const __m128i*)&n[i + 4]);
+
+		floatx8 u(floatx4(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(lo, 16), 16))), floatx4(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(hi, 16), 16))));
+		floatx8 v(floatx4(_mm_cvtepi32_ps(_mm_srai_epi32(lo, 16))), floatx4(_mm_cvtepi32_ps(_mm_srai_epi32(hi, 16))));
+
+		u = u * floatx8(1.0f / 32767.0f);
+		v = v * floatx8(1.0f / 32767.0f);
+
+		u = select(u > minusOne, u, minusOne);
+		v = select(v > minusOne, v, minusOne);
+
+		floatx8 w = one - abs(u) - abs(v);
+
+		floatx8 t = select(-w > zero, -w, zero);
+
+		u = u + select(u >= zero, -t, t);
+		v = v + select(v >= zero, -t, t);
+
+		floatx8 length = sqrt(u * u + v * v + w * w);
+
+		store_vec3x8(ret + i, vec3x8(u / length, v / length, w / length));
+	}
+#endif
+
+	for(; i < count; i++)
+		ret[i] = n[i].unpack();
+}
+
+inline void unpack(quat *ret, const quat48 *q, unsigned count)
+{
+	unsigned i = 0;
+
+#if defined(SIMPLEMATH_SSE41)
+	const float scale = 0.70710678f / 16383.0f;
+
+	__m128i mask = _mm_set1_epi16(0x7fff);
+
+	floatx8 zero(0.0f);
+	floatx8 one(1.0f);
+
+	for(; i + 8 <= count; i += 8)
+	{
+		__m128i qa, qb, qc;
+		load_short3x8(qa, qb, qc, q[i].v);
+
+		floatx8 index = ushort_to_floatx8(_mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(qa, 15), 1), _mm_srli_epi16(qb, 15)));
+
+		floatx8 a = (ushort_to_floatx8(_mm_and_si128(qa, mask)) - floatx8(16383.0f)) * floatx8(scale);
+		floatx8 b = (ushort_to_floatx8(_mm_and_si128(qb, mask)) - floatx8(16383.0f)) * floatx8(scale);
+		floatx8 c = (ushort_to_floatx8(_mm_and_si128(qc, mask)) - floatx8(16383.0f)) * floatx8(scale);
+
+		floatx8 d = one - (a * a + b * b + c * c);
+		d = sqrt(select(d > zero, d, zero));
+
+		floatx8 is0 = index == zero;
+		floatx8 is1 = index == one;
+		floatx8 is2 = index == floatx8(2.0f);
+		floatx8 is3 = index == floatx8(3.0f);
+
+		floatx8 x = select(is0, d, a);
+		floatx8 y = select(is0, a, select(is1, d, b));
+		floatx8 z = select(is0 | is1, b, select(is2, d, c));
+		floatx8 w = select(is3, d, c);
+
+		store_quatx8(ret + i, x, y, z, w);
+	}
+#endif
+
+	for(; i < count; i++)
+		ret[i] = q[i].unpack();
+}
+
+inline void unpack(aabb *ret, const aabb16 *boxes, unsigned count, const aabb& parent)
+{
+	unsigned i = 0;
+
+#if defined(SIMPLEMATH_SSE41)
+	vec3 parentMin = parent.min_point();
+	vec3 step = parent.size * (2.0f / 65535.0f);
+
+	__m128i lowMask = _mm_set1_epi32(0xffff);
+
+	__m128 half = _mm_set1_ps(0.5f);
+
+	for(; i + 4 <= count; i += 4)
+	{
+		// Minimum and maximum alternate, each 32-bit lane holds both values of a box
+		__m128i px, py, pz;
+		load_short3x8(px, py, pz, boxes[i].min);
+
+		__m128 lowX = _mm_add_ps(_mm_set1_ps(parentMin.x), _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(px, lowMask)), _mm_set1_ps(step.x)));
+		__m128 lowY = _mm_add_ps(_mm_set1_ps(parentMin.y), _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(py, lowMask)), _mm_set1_ps(step.y)));
+		__m128 lowZ = _mm_add_ps(_mm_set1_ps(parentMin.z), _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(pz, lowMask)), _mm_set1_ps(step.z)));
+
+		__m128 highX = _mm_add_ps(_mm_set1_ps(parentMin.x), _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(px, 16)), _mm_set1_ps(step.x)));
+		__m128 highY = _mm_add_ps(_mm_set1_ps(parentMin.y), _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(py, 16)), _mm_set1_ps(step.y)));
+		__m128 highZ = _mm_add_ps(_mm_set1_ps(parentMin.z), _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(pz, 16)), _mm_set1_ps(step.z)));
+
+		__m128 r0 = _mm_mul_ps(_mm_add_ps(lowX, highX), half);
+		__m128 r1 = _mm_mul_ps(_mm_add_ps(lowY, highY), half);
+		__m128 r2 = _mm_mul_ps(_mm_add_ps(lowZ, highZ), half);
+		__m128 r3 = _mm_mul_ps(_mm_sub_ps(highX, lowX), half);
+
+		__m128 r4 = _mm_mul_ps(_mm_sub_ps(highY, lowY), half);
+		__m128 r5 = _mm_mul_ps(_mm_sub_ps(highZ, lowZ), half);
+		__m128 r6 = _mm_setzero_ps();
+		__m128 r7 = _mm_setzero_ps();
+
+		// Rows become center and size of each box
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		_MM_TRANSPOSE4_PS(r4, r5, r6, r7);
+
+		_mm_storeu_ps(&ret[i].center.x, r0);
+		_mm_storel_pi((__m64*)&ret[i].size.y, r4);
+		_mm_storeu_ps(&ret[i + 1].center.x, r1);
+		_mm_storel_pi((__m64*)&ret[i + 1].size.y, r5);
+		_mm_storeu_ps(&ret[i + 2].center.x, r2);
+		_mm_storel_pi((__m64*)&ret[i + 2].size.y, r6);
+		_mm_storeu_ps(&ret[i + 3].center.x, r3);
+		_mm_storel_pi((__m64*)&ret[i + 3].size.y, r7);
+	}
+#endif
+
+	for(; i < count; i++)
+		ret[i] = boxes[i].unpack(parent);
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <string.h>
+
+#include "jobs.h"
+#include "matrix.h"
+#include "aabb.h"
+#include "frustum.h"
+#include "hierarchy.h"
+#include "skinning.h"
+
+/********************************************************************************/
+/*								Parallel batch operations						*/
+/********************************************************************************/
+
+// Chunk sizes keep the data of a chunk in the L2 cache of a core: 48KB of boxes, 48KB of source points
+// Culling chunks are multiples of 32, so that the threads write to separate mask words
+// Hierarchy nodes read their parents from anywhere in the arrays, chunks are smaller to balance the levels
+// Skinning chunks are multiples of 8 for the dual quaternion groups, 48KB of source positions and normals
+enum
+{
+	PARALLEL_CULL_CHUNK = 2048,
+	PARALLEL_TRANSFORM_CHUNK = 4096,
+	PARALLEL_HIERARCHY_CHUNK = 1024,
+	PARALLEL_SKINNING_CHUNK = 2048
+};
+
+// Same as frustum::aabb_inside_mask
+inline void parallel_aabb_inside_mask(job_pool& pool, const frustum& f, const aabb* boxes, unsigned count, unsigned* mask, unsigned stride = sizeof(aabb))
+{
+	pool.parallel_for(count, PARALLEL_CULL_CHUNK, [&](unsigned begin, unsigned end)
+	{
+		f.aabb_inside_mask((const aabb*)((const char*)boxes + begin * stride), end - begin, mask + begin / 32, stride);
+	});
+}
+
+// Same as frustum::aabb_inside_indices, indices are in the increasing order for any number of threads
+// 'visible' must have space for 'count' indices
+inline unsigned parallel_aabb_inside_indices(job_pool& pool, const frustum& f, const aabb* boxes, unsigned count, unsigned* visible, unsigned stride = sizeof(aabb))
+{
+	unsigned chunkCount = (count + PARALLEL_CULL_CHUNK - 1) / PARALLEL_CULL_CHUNK;
+
+	std::vector<unsigned> chunkVisible(chunkCount);
+
+	// Each chunk writes to its own part of the output
+	pool.parallel_for(count, PARALLEL_CULL_CHUNK, [&](unsigned begin, unsigned end)
+	{
+		unsigned *target = visible + begin;
+
+		unsigned visibleCount = f.aabb_inside_indices((const aabb*)((const char*)boxes + begin * stride), end - begin, target, stride);
+
+		for(unsigned i = 0; i < visibleCount; i++)
+			target[i] += begin;
+
+		chunkVisible[begin / PARALLEL_CULL_CHUNK] = visibleCount;
+	});
+
+	// Parts are joined in the chunk order
+	unsigned visibleCount = 0;
+
+	for(unsigned i = 0; i < chunkCount; i++)
+	{
+		if(visibleCount != i * PARALLEL_CULL_CHUNK)
+			memmove(visible + visibleCount, visible + i * PARALLEL_CULL_CHUNK, chunkVisible[i] * sizeof(unsigned));
+
+		visibleCount += chunkVisible[i];
+	}
+
+	return visibleCount;
+}
+
+// Same as transform_points
+inline void parallel_transform_points(job_pool& pool, vec3 *ret, unsigned retStride, const vec3 *v, unsigned vStride, unsigned count, const mat4 &m)
+{
+	pool.parallel_for(count, PARALLEL_TRANSFORM_CHUNK, [&](unsigned begin, unsigned end)
+	{
+		transform_points((vec3*)((char*)ret + begin * retStride), retStride, (const vec3*)((const char*)v + begin * vStride), vStride, end - begin, m);
+	});
+}
+
+inline void parallel_transform_points(job_pool& pool, vec3 *ret, const vec3 *v, unsigned count, const mat4 &m)
+{
+	pool.parallel_for(count, PARALLEL_TRANSFORM_CHUNK, [&](unsigned begin, unsigned end)
+	{
+		transform_points(ret + begin, v + begin, end - begin, m);
+	});
+}
+
+// Same as transform_aabbs, boxes are twice as large as points
+inline void parallel_transform_aabbs(job_pool& pool, aabb *ret, const aabb *boxes, unsigned count, const mat4& mat)
+{
+	pool.parallel_for(count, PARALLEL_TRANSFORM_CHUNK / 2, [&](unsigned begin, unsigned end)
+	{
+		transform_aabbs(ret + begin, boxes + begin, end - begin, mat);
+	});
+}
+
+// Same as transform_hierarchy::update, levels are updated one after another and the nodes of a level in parallel
+inline void parallel_update(job_pool& pool, transform_hierarchy& hierarchy)
+{
+	hierarchy.collect_updates(true);
+
+	for(unsigned level = 0; level + 1 < hierarchy.levels.size(); level++)
+	{
+		unsigned first = hierarchy.levels[level];
+
+		pool.parallel_for(hierarchy.levels[level + 1] - first, PARALLEL_HIERARCHY_CHUNK, [&](unsigned begin, unsigned end)
+		{
+			hierarchy.update_nodes(first + begin, first + end);
+		});
+	}
+}
+
+// Same as skin_linear
+inline void parallel_skin_linear(job_pool& pool, vec3 *positions, vec3 *normals, const vec3 *sourcePositions, const vec3 *sourceNormals, const unsigned short *joints, const float *weights, unsigned influences, unsigned count, const mat4 *palette)
+{
+	pool.parallel_for(count, PARALLEL_SKINNING_CHUNK, [&](unsigned begin, unsigned end)
+	{
+		skin_linear(positions + begin, normals ? normals + begin : 0, sourcePositions + begin, sourceNormals ? sourceNormals + begin : 0, joints + begin * influences, weights + begin * influences, influences, end - begin, palette);
+	});
+}
+
+// Same as skin_dualquat
+inline void parallel_skin_dualquat(job_pool& pool, vec3 *positions, vec3 *normals, const vec3 *sourcePositions, const vec3 *sourceNormals, const unsigned short *joints, const float *weights, unsigned influences, unsigned count, const dualquat *palette)
+{
+	pool.parallel_for(count, PARALLEL_SKINNING_CHUNK, [&](unsigned begin, unsigned end)
+	{
+		skin_dualquat(positions + begin, normals ? normals + begin : 0, sourcePositions + begin, sourceNormals ? sourceNormals + begin : 0, joints + begin * influences, weights + begin * influences, influences, end - begin, palette);
+	});
+}
@@ -5,6 +5,7 @@
 #include "vector.h"
 #include "matrix.h"
 #include "aabb.h"
+#include "soa.h"
 
 #define Epsilon() 1e-6f
 
@@ -33,7 +34,7 @@ struct plane
 	{
 	}
 
-	plane(const plane& p): pl(p.pl)
+	explicit plane(uninitialized_tag): pl(uninitialized)
 	{
 	}
 
@@ -60,6 +61,8 @@ struct plane
 	vec4 pl;
 };
 
+SIMPLEMATH_ASSERT_PLAIN_TYPE(plane, 16);
+
 inline line::line(const vec3& p, const plane& pl)
 {
 	this->p = p;
@@ -312,6 +315,41 @@ inline float line_intersects_aabb(const line& l, const aabb& box)
 	return dist;
 }
 
+inline vec3 line_inverse_direction(const line& l)
+{
+	return vec3(1.0f / l.n.x, 1.0f / l.n.y, 1.0f / l.n.z);
+}
+
+// Slab test for a line from 'origin' with the inverse direction from line_inverse_direction
+// Returns the entry distance in units of the line direction clamped to zero or -1 if the box is missed or further than 'maxDistance'
+// A line parallel to a slab with the origin exactly on one of its faces touches the box, like a line that enters it through an edge
+inline float line_intersect_aabb_distance(const vec3& origin, const vec3& invDir, const vec3& minp, const vec3& maxp, float maxDistance)
+{
+	// Faces are ordered by the direction, so the first distance of each slab is the entry and the second one is the exit
+	float tx1 = ((invDir.x < 0.0f ? maxp.x : minp.x) - origin.x) * invDir.x;
+	float tx2 = ((invDir.x < 0.0f ? minp.x : maxp.x) - origin.x) * invDir.x;
+	float ty1 = ((invDir.y < 0.0f ? maxp.y : minp.y) - origin.y) * invDir.y;
+	float ty2 = ((invDir.y < 0.0f ? minp.y : maxp.y) - origin.y) * invDir.y;
+	float tz1 = ((invDir.z < 0.0f ? maxp.z : minp.z) - origin.z) * invDir.z;
+	float tz2 = ((invDir.z < 0.0f ? minp.z : maxp.z) - origin.z) * invDir.z;
+
+	// An origin on a face of a parallel slab gives 0 * inf = NaN for that face and an infinity for the other one
+	// NaN fails the comparisons, so that slab doesn't limit the range
+	float tmin = tx1 > 0.0f ? tx1 : 0.0f;
+	float tmax = tx2 < maxDistance ? tx2 : maxDistance;
+
+	tmin = ty1 > tmin ? ty1 : tmin;
+	tmax = ty2 < tmax ? ty2 : tmax;
+
+	tmin = tz1 > tmin ? tz1 : tmin;
+	tmax = tz2 < tmax ? tz2 : tmax;
+
+	if(tmax < tmin)
+		return -1.0f;
+
+	return tmin;
+}
+
 inline float line_intersect_triangle_distance(const line& l, const vec3& a, const vec3& b, const vec3& c)
 {
 	// http://en.wikipedia.org/wiki/MollerTrumbore_intersection_algorithm
@@ -367,6 +405,175 @@ inline bool line_intersects_triangle(const line& l, const vec3& a, const vec3& b
 	return line_intersect_triangle_distance(l, a, b, c) >= 0.0f;
 }
 
+/********************************************************************************/
+/*								Packet intersection								*/
+/********************************************************************************/
+
+// Wide loads for the lane type of a packet, 'stride' is the distance between the vectors in bytes
+inline void load_vec3_wide(vec3x4 &ret, const vec3 *v, unsigned stride)
+{
+	ret = load_vec3x4(v, stride);
+}
+
+inline void load_vec3_wide(vec3x8 &ret, const vec3 *v, unsigned stride)
+{
+	ret = load_vec3x8(v, stride);
+}
+
+// Several lines, one per lane
+template<typename T>
+struct line_wide
+{
+	line_wide()
+	{
+	}
+
+	explicit line_wide(const line& l): p(l.p), n(l.n)
+	{
+	}
+
+	// One lane at a time, use load for consecutive lines
+	void set(unsigned i, const line& l)
+	{
+		p.set(i, l.p);
+		n.set(i, l.n);
+	}
+
+	// Consecutive lines, one for each lane
+	static line_wide load(const line *l)
+	{
+		line_wide ret;
+
+		load_vec3_wide(ret.p, &l->p, sizeof(line));
+		load_vec3_wide(ret.n, &l->n, sizeof(line));
+
+		return ret;
+	}
+
+	vec3_wide<T> p, n;
+};
+
+typedef line_wide<floatx4> linex4;
+typedef line_wide<floatx8> linex8;
+
+// Several triangles, one per lane, stored as a vertex and two edges
+// Unused lanes are degenerate and never intersect
+template<typename T>
+struct triangle_wide
+{
+	triangle_wide()
+	{
+	}
+
+	triangle_wide(const vec3& a, const vec3& b, const vec3& c): a(a), e1(b - a), e2(c - a)
+	{
+	}
+
+	// One lane at a time, use load for consecutive triangles
+	void set(unsigned i, const vec3& a, const vec3& b, const vec3& c)
+	{
+		this->a.set(i, a);
+		e1.set(i, b - a);
+		e2.set(i, c - a);
+	}
+
+	// Vertices of consecutive triangles from three arrays, or from one vertex array with 'stride' = 3 * sizeof(vec3)
+	static triangle_wide load(const vec3 *a, const vec3 *b, const vec3 *c, unsigned stride = sizeof(vec3))
+	{
+		vec3_wide<T> vb, vc;
+
+		triangle_wide ret;
+
+		load_vec3_wide(ret.a, a, stride);
+		load_vec3_wide(vb, b, stride);
+		load_vec3_wide(vc, c, stride);
+
+		ret.e1 = vb - ret.a;
+		ret.e2 = vc - ret.a;
+
+		return ret;
+	}
+
+	vec3_wide<T> a, e1, e2;
+};
+
+typedef triangle_wide<floatx4> trianglex4;
+typedef triangle_wide<floatx8> trianglex8;
+
+// Intersection of lines with triangles, lane by lane
+// Hit/miss decisions and distances are exactly the same as in line_intersect_triangle_distance
+// Bit k of the result is set if lane k has an intersection, 'distance' is -1 and barycentrics are 0 in other lanes
+template<typename T>
+inline int line_intersect_triangle_distance(const line_wide<T>& l, const triangle_wide<T>& tri, T& distance, T& u, T& v)
+{
+	vec3_wide<T> p = cross(l.n, tri.e2);
+
+	T det = dot(tri.e1, p);
+
+	// Comparisons are negated the same way as in the scalar code, so NaN values lead to the same decisions
+	T hit = ~((det > T(-Epsilon())) & (det < T(Epsilon())));
+
+	if(!hit.mask())
+	{
+		distance = T(-1.0f);
+		u = v = T(0.0f);
+		return 0;
+	}
+
+	T invDet = T(1.0f) / det;
+
+	vec3_wide<T> t = l.p - tri.a;
+
+	u = dot(t, p) * invDet;
+
+	hit = hit & ~((u < T(0.0f)) | (u > T(1.0f)));
+
+	vec3_wide<T> q = cross(t, tri.e1);
+
+	v = dot(l.n, q) * invDet;
+
+	hit = hit & ~((v < T(0.0f)) | (u + v > T(1.0f)));
+
+	distance = dot(tri.e2, q) * invDet;
+
+	hit = hit & (distance > T(Epsilon()));
+
+	distance = select(hit, distance, T(-1.0f));
+	u = select(hit, u, T(0.0f));
+	v = select(hit, v, T(0.0f));
+
+	return hit.mask();
+}
+
+// One line against several triangles
+template<typename T>
+inline int line_intersect_triangle_distance(const line& l, const triangle_wide<T>& tri, T& distance, T& u, T& v)
+{
+	return line_intersect_triangle_distance(line_wide<T>(l), tri, distance, u, v);
+}
+
+// Several lines against one triangle
+template<typename T>
+inline int line_intersect_triangle_distance(const line_wide<T>& l, const vec3& a, const vec3& b, const vec3& c, T& distance, T& u, T& v)
+{
+	return line_intersect_triangle_distance(l, triangle_wide<T>(a, b, c), distance, u, v);
+}
+
+// Lane with the smallest distance among the lanes in 'mask' or -1 if the mask is empty
+template<typename T>
+inline int nearest_lane(int mask, const T& distance)
+{
+	int nearest = -1;
+
+	for(unsigned i = 0; mask; i++, mask >>= 1)
+	{
+		if((mask & 1) && (nearest < 0 || distance[i] < distance[nearest]))
+			nearest = int(i);
+	}
+
+	return nearest;
+}
+
 inline bool line_intersects_triangle(const line& l, const vec2& a, const vec2& b, const vec2& c)
 {
 	float dx = l.p.x - a.x;
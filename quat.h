@@ -1,14 +1,19 @@
 #pragma once
 
 #include "matrix.h"
+#include "soa.h"
 
 #define Epsilon() 1e-6f
 #define DegToRad(x) ((x) * 3.1415926536f / 180.0f)
 #define RadToDeg(x) ((x) * 180.0f / 3.1415926536f)
 
-struct quat
+struct quat;
+
+inline SIMPLEMATH_CONSTEXPR_SIMD float dot(const quat& q0, const quat& q1);
+
+struct SIMPLEMATH_ALIGN16 quat
 {
-	quat(): x(0), y(0), z(0), w(1)
+	SIMPLEMATH_CONSTEXPR quat(): x(0), y(0), z(0), w(1)
 	{
 	}
 
@@ -56,22 +61,69 @@ struct quat
 		}
 	}
 
-	quat(float nx, float ny, float nz, float nw): x(nx), y(ny), z(nz), w(nw)
+	SIMPLEMATH_CONSTEXPR quat(float nx, float ny, float nz, float nw): x(nx), y(ny), z(nz), w(nw)
+	{
+	}
+
+	explicit quat(uninitialized_tag)
+	{
+	}
+
+#if defined(SIMPLEMATH_SSE41)
+	explicit quat(__m128 v)
+	{
+		_mm_store_ps(&x, v);
+	}
+
+	__m128 simd() const
 	{
+		return _mm_load_ps(&x);
 	}
+#endif
 
-	bool operator==(const quat& q) const
+	SIMPLEMATH_CONSTEXPR_SIMD bool operator==(const quat& q) const
 	{
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+			return _mm_movemask_ps(_mm_cmpeq_ps(simd(), q.simd())) == 0xf;
+#endif
 		return x == q.x && y == q.y && z == q.z && w == q.w;
 	}
 
-	bool operator!=(const quat& q) const
+	SIMPLEMATH_CONSTEXPR_SIMD bool operator!=(const quat& q) const
 	{
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+			return _mm_movemask_ps(_mm_cmpneq_ps(simd(), q.simd())) != 0;
+#endif
 		return x != q.x || y != q.y || z != q.z || w != q.w;
 	}
 
-	quat operator*(const quat& q) const
+	SIMPLEMATH_CONSTEXPR_SIMD quat operator*(const quat& q) const
 	{
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		{
+			// Same terms and summation order as the scalar code, subtraction is done by flipping the sign
+			__m128 a = simd();
+			__m128 b = q.simd();
+
+			__m128 signW = _mm_set_ps(-0.0f, 0.0f, 0.0f, 0.0f);
+
+			__m128 r = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), b);
+
+			__m128 t = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 2, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 1, 0, 2)));
+			r = _mm_add_ps(r, _mm_xor_ps(t, signW));
+
+			t = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 0, 2)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 2, 1)));
+			r = _mm_sub_ps(r, t);
+
+			t = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 0)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 3, 3)));
+			r = _mm_add_ps(r, _mm_xor_ps(t, signW));
+
+			return quat(r);
+		}
+#endif
 		quat ret;
 		ret.x = w * q.x + y * q.z - z * q.y + x * q.w;
 		ret.y = w * q.y + z * q.x - x * q.z + y * q.w;
@@ -83,19 +135,31 @@ struct quat
 	// Create a quaternion that represents rotation around axis "dir" by angle
 	quat& set(const vec3& dir, float angle)
 	{
+#if defined(SIMPLEMATH_FAST_MATH)
+		float length = dir.length_squared();
+#else
 		float length = dir.length();
+#endif
 
 		if(length != 0.0f)
 		{
+#if defined(SIMPLEMATH_FAST_MATH)
+			length = fast_rsqrt(length);
+
+			float sinAngle, cosAngle;
+			fast_sincos(DegToRad(angle) / 2.0f, sinAngle, cosAngle);
+#else
 			length = 1.0f / length;
 
 			float sinAngle = sinf(DegToRad(angle) / 2.0f);
+			float cosAngle = cosf(DegToRad(angle) / 2.0f);
+#endif
 
 			x = dir.x * length * sinAngle;
 			y = dir.y * length * sinAngle;
 			z = dir.z * length * sinAngle;
 
-			w = cosf(DegToRad(angle) / 2.0f);
+			w = cosAngle;
 		}
 		else
 		{
@@ -127,7 +191,11 @@ struct quat
 
 		vec3 axis = cross(f, t);
 
+#if defined(SIMPLEMATH_FAST_MATH)
+		float value = fast_acos(cosAngle);
+#else
 		float value = acosf(cosAngle);
+#endif
 
 		set(axis, RadToDeg(value));
 	}
@@ -136,7 +204,7 @@ struct quat
 	{
 		float k0, k1;
 		
-		float cosomega = q0.x * q1.x + q0.y * q1.y + q0.z * q1.z + q0.w * q1.w;
+		float cosomega = dot(q0, q1);
 
 		quat q;
 
@@ -159,11 +227,19 @@ struct quat
 
 		if(1.0 - cosomega > Epsilon())
 		{
+#if defined(SIMPLEMATH_FAST_MATH)
+			float omega = fast_acos(cosomega);
+			float sinomega = fast_sin(omega);
+
+			k0 = fast_sin((1.0f - t) * omega) / sinomega;
+			k1 = fast_sin(t * omega) / sinomega;
+#else
 			float omega = acosf(cosomega); 
 			float sinomega = sinf(omega);
 
 			k0 = sinf((1.0f - t) * omega) / sinomega;
 			k1 = sinf(t * omega) / sinomega;
+#endif
 		}
 		else
 		{
@@ -177,7 +253,7 @@ struct quat
 		w = q0.w * k0 + q.w * k1;
 	}
 
-	mat3 to_matrix() const
+	SIMPLEMATH_CONSTEXPR mat3 to_matrix() const
 	{
 		mat3 ret;
 
@@ -203,7 +279,11 @@ struct quat
 
 	void normalize()
 	{
+#if defined(SIMPLEMATH_FAST_MATH)
+		float magn = fast_rsqrt(x * x + y * y + z * z + w * w);
+#else
 		float magn = float(1.0 / sqrtf(x * x + y * y + z * z + w * w));
+#endif
 
 		x *= magn;
 		y *= magn;
@@ -211,7 +291,7 @@ struct quat
 		w *= magn;
 	}
 
-	quat conjugate()
+	SIMPLEMATH_CONSTEXPR quat conjugate() const
 	{
 		quat ret = *this;
 
@@ -222,7 +302,7 @@ struct quat
 		return ret;
 	}
 
-	vec3 transform_vector(const vec3& v)
+	SIMPLEMATH_CONSTEXPR vec3 transform_vector(const vec3& v) const
 	{
 		vec3 uv(y * v.z - z * v.y,
 				z * v.x - x * v.z,
@@ -242,6 +322,234 @@ struct quat
 	float x, y, z, w;
 };
 
+SIMPLEMATH_ASSERT_PLAIN_TYPE(quat, 16);
+
+inline SIMPLEMATH_CONSTEXPR_SIMD float dot(const quat& q0, const quat& q1)
+{
+#if defined(SIMPLEMATH_SSE41)
+	if(!SIMPLEMATH_CONSTANT_EVALUATED())
+	{
+		// Components are summed in the same order as in the scalar code to get the same result
+		__m128 m = _mm_mul_ps(q0.simd(), q1.simd());
+		__m128 sum = _mm_add_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+		sum = _mm_add_ss(sum, _mm_movehl_ps(m, m));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(m, m, _MM_SHUFFLE(3, 3, 3, 3)));
+		return _mm_cvtss_f32(sum);
+	}
+#endif
+	return q0.x * q1.x + q0.y * q1.y + q0.z * q1.z + q0.w * q1.w;
+}
+
+/********************************************************************************/
+/*								Batch interpolation								*/
+/********************************************************************************/
+
+// Input and output can be the same array
+// 't' is either an array with a value for each pair or a single value for all pairs
+
+// Same results as quat::slerp for each element
+inline void slerp(quat *ret, const quat *q0, const quat *q1, const float *t, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i].slerp(q0[i], q1[i], t[i]);
+}
+
+inline void slerp(quat *ret, const quat *q0, const quat *q1, float t, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i].slerp(q0[i], q1[i], t);
+}
+
+// Eight quaternions are transposed into component lanes
+inline void load_quatx8(floatx8 &x, floatx8 &y, floatx8 &z, floatx8 &w, const quat *q)
+{
+#if defined(SIMPLEMATH_SSE41)
+	__m128 r0 = _mm_loadu_ps(&q[0].x), r1 = _mm_loadu_ps(&q[1].x), r2 = _mm_loadu_ps(&q[2].x), r3 = _mm_loadu_ps(&q[3].x);
+	__m128 r4 = _mm_loadu_ps(&q[4].x), r5 = _mm_loadu_ps(&q[5].x), r6 = _mm_loadu_ps(&q[6].x), r7 = _mm_loadu_ps(&q[7].x);
+
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_MM_TRANSPOSE4_PS(r4, r5, r6, r7);
+
+	x = floatx8(floatx4(r0), floatx4(r4));
+	y = floatx8(floatx4(r1), floatx4(r5));
+	z = floatx8(floatx4(r2), floatx4(r6));
+	w = floatx8(floatx4(r3), floatx4(r7));
+#else
+	// Components are gathered into arrays and loaded once, setting the lanes one at a time reloads the whole vector
+	float lanes[4][8];
+
+	for(unsigned i = 0; i < 8; i++)
+	{
+		lanes[0][i] = q[i].x;
+		lanes[1][i] = q[i].y;
+		lanes[2][i] = q[i].z;
+		lanes[3][i] = q[i].w;
+	}
+
+	x = floatx8::load(lanes[0]);
+	y = floatx8::load(lanes[1]);
+	z = floatx8::load(lanes[2]);
+	w = floatx8::load(lanes[3]);
+#endif
+}
+
+inline void store_quatx8(quat *q, const floatx8 &x, const floatx8 &y, const floatx8 &z, const floatx8 &w)
+{
+#if defined(SIMPLEMATH_SSE41)
+	__m128 r0 = x.low().v, r1 = y.low().v, r2 = z.low().v, r3 = w.low().v;
+	__m128 r4 = x.high().v, r5 = y.high().v, r6 = z.high().v, r7 = w.high().v;
+
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_MM_TRANSPOSE4_PS(r4, r5, r6, r7);
+
+	_mm_storeu_ps(&q[0].x, r0); _mm_storeu_ps(&q[1].x, r1); _mm_storeu_ps(&q[2].x, r2); _mm_storeu_ps(&q[3].x, r3);
+	_mm_storeu_ps(&q[4].x, r4); _mm_storeu_ps(&q[5].x, r5); _mm_storeu_ps(&q[6].x, r6); _mm_storeu_ps(&q[7].x, r7);
+#else
+	float lanes[4][8];
+
+	x.store(lanes[0]);
+	y.store(lanes[1]);
+	z.store(lanes[2]);
+	w.store(lanes[3]);
+
+	for(unsigned i = 0; i < 8; i++)
+		q[i] = quat(lanes[0][i], lanes[1][i], lanes[2][i], lanes[3][i]);
+#endif
+}
+
+// Interpolation of eight pairs at a time, 'fast' selects the polynomial slerp approximation instead of the linear interpolation
+inline void interpolate_x8(quat *ret, const quat *q0, const quat *q1, const floatx8 &t, bool fast, bool normalize)
+{
+	floatx8 x0, y0, z0, w0;
+	floatx8 x1, y1, z1, w1;
+
+	load_quatx8(x0, y0, z0, w0, q0);
+	load_quatx8(x1, y1, z1, w1, q1);
+
+	floatx8 cosomega = x0 * x1 + y0 * y1 + z0 * z1 + w0 * w1;
+
+	// Shortest path, the second quaternion is negated when the angle is obtuse
+	floatx8 sign = cosomega & floatx8(-0.0f);
+
+	cosomega = cosomega ^ sign;
+
+	floatx8 one(1.0f);
+	floatx8 d = one - t;
+
+	floatx8 k0, k1;
+
+	if(fast)
+	{
+		// "A Fast and Accurate Algorithm for Computing SLERP", David Eberly
+		// sin(t * omega) / sin(omega) is expanded into a polynomial in t and (cos(omega) - 1), 14 terms are used
+		// and the last coefficient is scaled to minimize the maximum error on the whole [0, 1] range
+		static const float u[14] = {
+			1.0f / (1 * 3), 1.0f / (2 * 5), 1.0f / (3 * 7), 1.0f / (4 * 9), 1.0f / (5 * 11), 1.0f / (6 * 13), 1.0f / (7 * 15),
+			1.0f / (8 * 17), 1.0f / (9 * 19), 1.0f / (10 * 21), 1.0f / (11 * 23), 1.0f / (12 * 25), 1.0f / (13 * 27), 1.90659f / (14 * 29)
+		};
+		static const float v[14] = {
+			1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9, 5.0f / 11, 6.0f / 13, 7.0f / 15,
+			8.0f / 17, 9.0f / 19, 10.0f / 21, 11.0f / 23, 12.0f / 25, 13.0f / 27, 1.90659f * 14 / 29
+		};
+
+		floatx8 xm1 = cosomega - one;
+		floatx8 sqrT = t * t;
+		floatx8 sqrD = d * d;
+
+		floatx8 accT = one;
+		floatx8 accD = one;
+
+		for(int i = 13; i >= 0; i--)
+		{
+			accT = one + (floatx8(u[i]) * sqrT - floatx8(v[i])) * xm1 * accT;
+			accD = one + (floatx8(u[i]) * sqrD - floatx8(v[i])) * xm1 * accD;
+		}
+
+		k0 = d * accD;
+		k1 = t * accT;
+	}
+	else
+	{
+		k0 = d;
+		k1 = t;
+	}
+
+	k1 = k1 ^ sign;
+
+	floatx8 x = x0 * k0 + x1 * k1;
+	floatx8 y = y0 * k0 + y1 * k1;
+	floatx8 z = z0 * k0 + z1 * k1;
+	floatx8 w = w0 * k0 + w1 * k1;
+
+	if(normalize)
+	{
+#if defined(SIMPLEMATH_FAST_MATH)
+		floatx8 magn = fast_rsqrt(x * x + y * y + z * z + w * w);
+#else
+		floatx8 magn = one / sqrt(x * x + y * y + z * z + w * w);
+#endif
+
+		x = x * magn;
+		y = y * magn;
+		z = z * magn;
+		w = w * magn;
+	}
+
+	store_quatx8(ret, x, y, z, w);
+}
+
+inline void interpolate_array(quat *ret, const quat *q0, const quat *q1, const float *t, unsigned tStride, unsigned count, bool fast, bool normalize)
+{
+	unsigned i = 0;
+
+	for(; i + 8 <= count; i += 8)
+		interpolate_x8(ret + i, q0 + i, q1 + i, tStride ? floatx8::load(t + i) : floatx8(*t), fast, normalize);
+
+	if(i < count)
+	{
+		// Remaining elements are processed in a padded group
+		quat a[8], b[8], r[8];
+		float tt[8] = { 0.0f };
+
+		for(unsigned k = 0; k < count - i; k++)
+		{
+			a[k] = q0[i + k];
+			b[k] = q1[i + k];
+			tt[k] = t[tStride ? i + k : 0];
+		}
+
+		interpolate_x8(r, a, b, floatx8::load(tt), fast, normalize);
+
+		for(unsigned k = 0; k < count - i; k++)
+			ret[i + k] = r[k];
+	}
+}
+
+// Polynomial approximation of slerp without trigonometric functions, eight pairs are interpolated at a time
+// For unit quaternions and t in [0, 1] the maximum component difference from quat::slerp is 4e-7 and the result length differs from 1 by less than 6e-7
+// 'normalize' removes the length difference
+inline void slerp_fast(quat *ret, const quat *q0, const quat *q1, const float *t, unsigned count, bool normalize = false)
+{
+	interpolate_array(ret, q0, q1, t, 1, count, true, normalize);
+}
+
+inline void slerp_fast(quat *ret, const quat *q0, const quat *q1, float t, unsigned count, bool normalize = false)
+{
+	interpolate_array(ret, q0, q1, &t, 0, count, true, normalize);
+}
+
+// Linear interpolation along the shortest path
+// Rotation speed is not constant, the difference from quat::slerp grows with the angle between the quaternions (up to 0.14 radians at 180 degrees)
+inline void nlerp(quat *ret, const quat *q0, const quat *q1, const float *t, unsigned count, bool normalize = true)
+{
+	interpolate_array(ret, q0, q1, t, 1, count, false, normalize);
+}
+
+inline void nlerp(quat *ret, const quat *q0, const quat *q1, float t, unsigned count, bool normalize = true)
+{
+	interpolate_array(ret, q0, q1, &t, 0, count, false, normalize);
+}
+
 #undef Epsilon
 #undef DegToRad
 #undef RadToDeg
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <math.h>
+
+#include "vector.h"
+#include "matrix.h"
+#include "soa.h"
+#include "dualquat.h"
+
+// Vertex influences are stored in groups of 'influences' (1 to 8): joints[i * influences + k] and weights[i * influences + k]
+// Unused influences have zero weight, weights of a vertex add up to 1
+enum
+{
+	SKINNING_MAX_INFLUENCES = 8
+};
+
+/********************************************************************************/
+/*								Linear blend skinning							*/
+/********************************************************************************/
+
+// First three lanes of 'v'
+inline void store_xyz(vec3 &ret, const floatx4 &v)
+{
+#if defined(SIMPLEMATH_SSE41)
+	_mm_storel_pi((__m64*)&ret.x, v.v);
+	_mm_store_ss(&ret.z, _mm_movehl_ps(v.v, v.v));
+#else
+	ret = vec3(v.v[0], v.v[1], v.v[2]);
+#endif
+}
+
+// Linear blend skinning, joint matrices are summed with the weights and the positions and normals are transformed by the sum
+// 'normals' and 'sourceNormals' can be null, 'normals' are set to zero when only 'sourceNormals' is null, normals are transformed by the 3x3 part and are not normalized again (joint matrices are expected to be rigid or uniformly scaled)
+// Each vertex blends the matrices two columns at a time, the same in AVX, SSE and scalar builds
+// Palette entries are not prefetched: loads of the following vertices already overlap and explicit prefetches were slower even for palettes larger than the L2 cache
+inline void skin_linear(vec3 *positions, vec3 *normals, const vec3 *sourcePositions, const vec3 *sourceNormals, const unsigned short *joints, const float *weights, unsigned influences, unsigned count, const mat4 *palette)
+{
+	for(unsigned i = 0; i < count; i++)
+	{
+		const unsigned short *joint = joints + i * influences;
+		const float *weight = weights + i * influences;
+
+		floatx8 w(weight[0]);
+
+		floatx8 c01 = floatx8::load(&palette[joint[0]].mat[0]) * w;
+		floatx8 c23 = floatx8::load(&palette[joint[0]].mat[8]) * w;
+
+		for(unsigned k = 1; k < influences; k++)
+		{
+			w = floatx8(weight[k]);
+
+			c01 = mul_add(floatx8::load(&palette[joint[k]].mat[0]), w, c01);
+			c23 = mul_add(floatx8::load(&palette[joint[k]].mat[8]), w, c23);
+		}
+
+		const vec3 &p = sourcePositions[i];
+
+		floatx8 r = mul_add(c23, floatx8(floatx4(p.z), floatx4(1.0f)), c01 * floatx8(floatx4(p.x), floatx4(p.y)));
+
+		store_xyz(positions[i], r.low() + r.high());
+
+		if(normals)
+		{
+			vec3 n = sourceNormals ? sourceNormals[i] : vec3();
+
+			floatx8 rn = mul_add(c23, floatx8(floatx4(n.z), floatx4(0.0f)), c01 * floatx8(floatx4(n.x), floatx4(n.y)));
+
+			store_xyz(normals[i], rn.low() + rn.high());
+		}
+	}
+}
+
+/********************************************************************************/
+/*								Dual quaternion skinning						*/
+/********************************************************************************/
+
+// Palette entries of eight vertices, transposed into component lanes
+inline void gather_dualquatx8(floatx8 *real, floatx8 *dual, const dualquat *palette, const unsigned *index)
+{
+#if defined(SIMPLEMATH_SSE41)
+	__m128 r0 = palette[index[0]].real.simd(), r1 = palette[index[1]].real.simd(), r2 = palette[index[2]].real.simd(), r3 = palette[index[3]].real.simd();
+	__m128 r4 = palette[index[4]].real.simd(), r5 = palette[index[5]].real.simd(), r6 = palette[index[6]].real.simd(), r7 = palette[index[7]].real.simd();
+
+	__m128 d0 = palette[index[0]].dual.simd(), d1 = palette[index[1]].dual.simd(), d2 = palette[index[2]].dual.simd(), d3 = palette[index[3]].dual.simd();
+	__m128 d4 = palette[index[4]].dual.simd(), d5 = palette[index[5]].dual.simd(), d6 = palette[index[6]].dual.simd(), d7 = palette[index[7]].dual.simd();
+
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_MM_TRANSPOSE4_PS(r4, r5, r6, r7);
+	_MM_TRANSPOSE4_PS(d0, d1, d2, d3);
+	_MM_TRANSPOSE4_PS(d4, d5, d6, d7);
+
+	real[0] = floatx8(floatx4(r0), floatx4(r4));
+	real[1] = floatx8(floatx4(r1), floatx4(r5));
+	real[2] = floatx8(floatx4(r2), floatx4(r6));
+	real[3] = floatx8(floatx4(r3), floatx4(r7));
+
+	dual[0] = floatx8(floatx4(d0), floatx4(d4));
+	dual[1] = floatx8(floatx4(d1), floatx4(d5));
+	dual[2] = floatx8(floatx4(d2), floatx4(d6));
+	dual[3] = floatx8(floatx4(d3), floatx4(d7));
+#else
+	float lanes[8][8];
+
+	for(unsigned i = 0; i < 8; i++)
+	{
+		const dualquat &q = palette[index[i]];
+
+		lanes[0][i] = q.real.x; lanes[1][i] = q.real.y; lanes[2][i] = q.real.z; lanes[3][i] = q.real.w;
+		lanes[4][i] = q.dual.x; lanes[5][i] = q.dual.y; lanes[6][i] = q.dual.z; lanes[7][i] = q.dual.w;
+	}
+
+	for(unsigned k = 0; k < 4; k++)
+	{
+		real[k] = floatx8::load(lanes[k]);
+		dual[k] = floatx8::load(lanes[k + 4]);
+	}
+#endif
+}
+
+// Eight vertices at a time: palette entries are blended with the weights, normalized and applied to the positions and normals
+// Entries on the opposite side of the first influence are negated, so that the blend takes the shortest path
+inline void skin_dualquat_x8(vec3 *positions, vec3 *normals, const vec3 *sourcePositions, const vec3 *sourceNormals, const unsigned short *joints, const float *weights, unsigned influences, const dualquat *palette)
+{
+	floatx8 real[4], dual[4];
+	floatx8 blendReal[4], blendDual[4];
+	floatx8 firstReal[4];
+
+	for(unsigned k = 0; k < influences; k++)
+	{
+		unsigned index[8];
+		float laneWeights[8];
+
+		for(unsigned i = 0; i < 8; i++)
+		{
+			index[i] = joints[i * influences + k];
+			laneWeights[i] = weights[i * influences + k];
+		}
+
+		gather_dualquatx8(real, dual, palette, index);
+
+		floatx8 w = floatx8::load(laneWeights);
+
+		if(k == 0)
+		{
+			for(unsigned c = 0; c < 4; c++)
+			{
+				firstReal[c] = real[c];
+
+				blendReal[c] = real[c] * w;
+				blendDual[c] = dual[c] * w;
+			}
+
+			continue;
+		}
+
+		floatx8 sign = (firstReal[0] * real[0] + firstReal[1] * real[1] + firstReal[2] * real[2] + firstReal[3] * real[3]) & floatx8(-0.0f);
+
+		w = w ^ sign;
+
+		for(unsigned c = 0; c < 4; c++)
+		{
+			blendReal[c] = blendReal[c] + real[c] * w;
+			blendDual[c] = blendDual[c] + dual[c] * w;
+		}
+	}
+
+	floatx8 lengthSquared = blendReal[0] * blendReal[0] + blendReal[1] * blendReal[1] + blendReal[2] * blendReal[2] + blendReal[3] * blendReal[3];
+
+#if defined(SIMPLEMATH_FAST_MATH)
+	floatx8 magn = fast_rsqrt(lengthSquared);
+#else
+	floatx8 magn = floatx8(1.0f) / sqrt(lengthSquared);
+#endif
+
+	vec3x8 rv(blendReal[0] * magn, blendReal[1] * magn, blendReal[2] * magn);
+	floatx8 rw = blendReal[3] * magn;
+
+	vec3x8 dv(blendDual[0] * magn, blendDual[1] * magn, blendDual[2] * magn);
+	floatx8 dw = blendDual[3] * magn;
+
+	// Same as dualquat::transform_point and dualquat::transform_vector
+	vec3x8 translation = (dv * rw - rv * dw + rv.cross(dv)) * floatx8(2.0f);
+
+	vec3x8 p = load_vec3x8(sourcePositions);
+	vec3x8 uuv = rv.cross(rv.cross(p) + p * rw);
+
+	store_vec3x8(positions, p + uuv * floatx8(2.0f) + translation);
+
+	if(normals)
+	{
+		vec3x8 n = sourceNormals ? load_vec3x8(sourceNormals) : vec3x8(vec3());
+		vec3x8 nuuv = rv.cross(rv.cross(n) + n * rw);
+
+		store_vec3x8(normals, n + nuuv * floatx8(2.0f));
+	}
+}
+
+// Dual quaternion skinning of 'count' vertices, 'normals' and 'sourceNormals' can be null, 'normals' are set to zero when only 'sourceNormals' is null
+// Rotations are blended instead of the matrices, so joints twisted against each other keep the volume of the mesh
+inline void skin_dualquat(vec3 *positions, vec3 *normals, const vec3 *sourcePositions, const vec3 *sourceNormals, const unsigned short *joints, const float *weights, unsigned influences, unsigned count, const dualquat *palette)
+{
+	unsigned i = 0;
+
+	for(; i + 8 <= count; i += 8)
+		skin_dualquat_x8(positions + i, normals ? normals + i : 0, sourcePositions + i, sourceNormals ? sourceNormals + i : 0, joints + i * influences, weights + i * influences, influences, palette);
+
+	if(i < count)
+	{
+		// Remaining vertices are processed in a padded group, padding uses the first palette entry with full weight
+		vec3 p[8], n[8], rp[8], rn[8];
+		unsigned short j[8 * SKINNING_MAX_INFLUENCES] = { 0 };
+		float w[8 * SKINNING_MAX_INFLUENCES] = { 0.0f };
+
+		for(unsigned k = 0; k < 8; k++)
+		{
+			if(i + k < count)
+			{
+				p[k] = sourcePositions[i + k];
+				n[k] = sourceNormals ? sourceNormals[i + k] : vec3();
+
+				for(unsigned c = 0; c < influences; c++)
+				{
+					j[k * influences + c] = joints[(i + k) * influences + c];
+					w[k * influences + c] = weights[(i + k) * influences + c];
+				}
+			}
+			else
+			{
+				w[k * influences] = 1.0f;
+			}
+		}
+
+		skin_dualquat_x8(rp, normals ? rn : 0, p, n, j, w, influences, palette);
+
+		for(unsigned k = 0; i + k < count; k++)
+		{
+			positions[i + k] = rp[k];
+
+			if(normals)
+				normals[i + k] = rn[k];
+		}
+	}
+}
@@ -0,0 +1,1025 @@
+#pragma once
+
+#include <math.h>
+#include <string.h>
+
+#include <vector>
+
+#include "vector.h"
+
+#define Epsilon() 1e-6f
+
+struct floatx4;
+struct floatx8;
+
+template<typename T>
+struct vec3_wide;
+
+typedef vec3_wide<floatx4> vec3x4;
+typedef vec3_wide<floatx8> vec3x8;
+
+/********************************************************************************/
+/*								floatx4											*/
+/********************************************************************************/
+
+// Four float lanes. Comparisons return lane masks with all bits set for 'true' lanes
+// Without SSE4.1 the lanes are processed one by one and the results are the same
+struct floatx4
+{
+	floatx4()
+	{
+#if defined(SIMPLEMATH_SSE41)
+		v = _mm_setzero_ps();
+#else
+		v[0] = v[1] = v[2] = v[3] = 0.0f;
+#endif
+	}
+
+	floatx4(float a)
+	{
+#if defined(SIMPLEMATH_SSE41)
+		v = _mm_set1_ps(a);
+#else
+		v[0] = v[1] = v[2] = v[3] = a;
+#endif
+	}
+
+	floatx4(float a, float b, float c, float d)
+	{
+#if defined(SIMPLEMATH_SSE41)
+		v = _mm_setr_ps(a, b, c, d);
+#else
+		v[0] = a; v[1] = b; v[2] = c; v[3] = d;
+#endif
+	}
+
+#if defined(SIMPLEMATH_SSE41)
+	floatx4(__m128 v): v(v)
+	{
+	}
+#endif
+
+	// Unaligned load/store
+	static floatx4 load(const float* p)
+	{
+#if defined(SIMPLEMATH_SSE41)
+		return floatx4(_mm_loadu_ps(p));
+#else
+		return floatx4(p[0], p[1], p[2], p[3]);
+#endif
+	}
+
+	void store(float* p) const
+	{
+#if defined(SIMPLEMATH_SSE41)
+		_mm_storeu_ps(p, v);
+#else
+		p[0] = v[0]; p[1] = v[1]; p[2] = v[2]; p[3] = v[3];
+#endif
+	}
+
+	float operator[](unsigned i) const
+	{
+		float tmp[4];
+		store(tmp);
+		return tmp[i];
+	}
+
+	void set(unsigned i, float a)
+	{
+		float tmp[4];
+		store(tmp);
+		tmp[i] = a;
+		*this = load(tmp);
+	}
+
+	// Bit i is set if the sign bit of lane i is set (for masks: if lane is 'true')
+	int mask() const
+	{
+#if defined(SIMPLEMATH_SSE41)
+		return _mm_movemask_ps(v);
+#else
+		unsigned bits[4];
+		memcpy(bits, v, sizeof(bits));
+		return int((bits[0] >> 31) | ((bits[1] >> 31) << 1) | ((bits[2] >> 31) << 2) | ((bits[3] >> 31) << 3));
+#endif
+	}
+
+#if defined(SIMPLEMATH_SSE41)
+	__m128 v;
+#else
+	float v[4];
+#endif
+};
+
+#if defined(SIMPLEMATH_SSE41)
+	#define SIMPLEMATH_X4_BINARY(op, intrinsic, expr) inline floatx4 operator op(const floatx4& a, const floatx4& b) { return floatx4(intrinsic(a.v, b.v)); }
+	#define SIMPLEMATH_X4_COMPARE(op, intrinsic) inline floatx4 operator op(const floatx4& a, const floatx4& b) { return floatx4(intrinsic(a.v, b.v)); }
+	#define SIMPLEMATH_X4_BITWISE(op, intrinsic, expr) inline floatx4 operator op(const floatx4& a, const floatx4& b) { return floatx4(intrinsic(a.v, b.v)); }
+#else
+	#define SIMPLEMATH_X4_BINARY(op, intrinsic, expr) inline floatx4 operator op(const floatx4& a, const floatx4& b) { floatx4 r; for(unsigned i = 0; i < 4; i++) r.v[i] = a.v[i] op b.v[i]; return r; }
+	#define SIMPLEMATH_X4_COMPARE(op, intrinsic) inline floatx4 operator op(const floatx4& a, const floatx4& b) { floatx4 r; for(unsigned i = 0; i < 4; i++) { unsigned bits = a.v[i] op b.v[i] ? ~0u : 0u; memcpy(&r.v[i], &bits, 4); } return r; }
+	#define SIMPLEMATH_X4_BITWISE(op, intrinsic, expr) inline floatx4 operator op(const floatx4& a, const floatx4& b) { floatx4 r; for(unsigned i = 0; i < 4; i++) { unsigned x, y; memcpy(&x, &a.v[i], 4); memcpy(&y, &b.v[i], 4); x = expr; memcpy(&r.v[i], &x, 4); } return r; }
+#endif
+
+SIMPLEMATH_X4_BINARY(+, _mm_add_ps, 0)
+SIMPLEMATH_X4_BINARY(-, _mm_sub_ps, 0)
+SIMPLEMATH_X4_BINARY(*, _mm_mul_ps, 0)
+SIMPLEMATH_X4_BINARY(/, _mm_div_ps, 0)
+
+SIMPLEMATH_X4_COMPARE(<, _mm_cmplt_ps)
+SIMPLEMATH_X4_COMPARE(<=, _mm_cmple_ps)
+SIMPLEMATH_X4_COMPARE(>, _mm_cmpgt_ps)
+SIMPLEMATH_X4_COMPARE(>=, _mm_cmpge_ps)
+SIMPLEMATH_X4_COMPARE(==, _mm_cmpeq_ps)
+
+SIMPLEMATH_X4_BITWISE(&, _mm_and_ps, x & y)
+SIMPLEMATH_X4_BITWISE(|, _mm_or_ps, x | y)
+SIMPLEMATH_X4_BITWISE(^, _mm_xor_ps, x ^ y)
+
+#undef SIMPLEMATH_X4_BINARY
+#undef SIMPLEMATH_X4_COMPARE
+#undef SIMPLEMATH_X4_BITWISE
+
+inline floatx4 operator-(const floatx4& a)
+{
+	return a ^ floatx4(-0.0f);
+}
+
+inline floatx4 operator~(const floatx4& a)
+{
+	return a ^ (floatx4(0.0f) == floatx4(0.0f));
+}
+
+// Same as 'a < b ? a : b' in each lane
+inline floatx4 minimum(const floatx4& a, const floatx4& b)
+{
+#if defined(SIMPLEMATH_SSE41)
+	return floatx4(_mm_min_ps(a.v, b.v));
+#else
+	floatx4 r;
+	for(unsigned i = 0; i < 4; i++)
+		r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+	return r;
+#endif
+}
+
+// Same as 'a > b ? a : b' in each lane
+inline floatx4 maximum(const floatx4& a, const floatx4& b)
+{
+#if defined(SIMPLEMATH_SSE41)
+	return floatx4(_mm_max_ps(a.v, b.v));
+#else
+	floatx4 r;
+	for(unsigned i = 0; i < 4; i++)
+		r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+	return r;
+#endif
+}
+
+inline floatx4 sqrt(const floatx4& a)
+{
+#if defined(SIMPLEMATH_SSE41)
+	return floatx4(_mm_sqrt_ps(a.v));
+#else
+	floatx4 r;
+	for(unsigned i = 0; i < 4; i++)
+		r.v[i] = sqrtf(a.v[i]);
+	return r;
+#endif
+}
+
+inline floatx4 abs(const floatx4& a)
+{
+	return floatx4(-0.0f) ^ (a | floatx4(-0.0f));
+}
+
+// Same result in each lane as mul_add
+inline floatx4 mul_add(const floatx4& a, const floatx4& b, const floatx4& c)
+{
+#if defined(SIMPLEMATH_FMA) && defined(SIMPLEMATH_SSE41)
+	return floatx4(_mm_fmadd_ps(a.v, b.v, c.v));
+#elif defined(SIMPLEMATH_FMA)
+	floatx4 r;
+	for(unsigned i = 0; i < 4; i++)
+		r.v[i] = fmaf(a.v[i], b.v[i], c.v[i]);
+	return r;
+#else
+	return a * b + c;
+#endif
+}
+
+// 1 / sqrt(x) for x > 0, same result in each lane as fast_rsqrt
+inline floatx4 fast_rsqrt(const floatx4& a)
+{
+#if defined(SIMPLEMATH_SSE41)
+	floatx4 r(_mm_rsqrt_ps(a.v));
+
+	return r * (floatx4(1.5f) - floatx4(0.5f) * a * r * r);
+#else
+	return floatx4(1.0f) / sqrt(a);
+#endif
+}
+
+// Picks 'a' in lanes where 'mask' is set and 'b' in other lanes
+inline floatx4 select(const floatx4& mask, const floatx4& a, const floatx4& b)
+{
+#if defined(SIMPLEMATH_SSE41)
+	return floatx4(_mm_blendv_ps(b.v, a.v, mask.v));
+#else
+	floatx4 r;
+	for(unsigned i = 0; i < 4; i++)
+		r.v[i] = (mask.mask() >> i) & 1 ? a.v[i] : b.v[i];
+	return r;
+#endif
+}
+
+/********************************************************************************/
+/*								floatx8											*/
+/********************************************************************************/
+
+// Eight float lanes. Uses AVX when available, otherwise a pair of floatx4
+struct floatx8
+{
+	floatx8()
+	{
+#if defined(SIMPLEMATH_AVX)
+		v = _mm256_setzero_ps();
+#endif
+	}
+
+	floatx8(float a)
+	{
+#if defined(SIMPLEMATH_AVX)
+		v = _mm256_set1_ps(a);
+#else
+		lo = hi = floatx4(a);
+#endif
+	}
+
+	floatx8(const floatx4& lo, const floatx4& hi)
+	{
+#if defined(SIMPLEMATH_AVX)
+		v = _mm256_insertf128_ps(_mm256_castps128_ps256(lo.v), hi.v, 1);
+#else
+		this->lo = lo;
+		this->hi = hi;
+#endif
+	}
+
+#if defined(SIMPLEMATH_AVX)
+	floatx8(__m256 v): v(v)
+	{
+	}
+#endif
+
+	floatx4 low() const
+	{
+#if defined(SIMPLEMATH_AVX)
+		return floatx4(_mm256_castps256_ps128(v));
+#else
+		return lo;
+#endif
+	}
+
+	floatx4 high() const
+	{
+#if defined(SIMPLEMATH_AVX)
+		return floatx4(_mm256_extractf128_ps(v, 1));
+#else
+		return hi;
+#endif
+	}
+
+	// Unaligned load/store
+	static floatx8 load(const float* p)
+	{
+#if defined(SIMPLEMATH_AVX)
+		return floatx8(_mm256_loadu_ps(p));
+#else
+		return floatx8(floatx4::load(p), floatx4::load(p + 4));
+#endif
+	}
+
+	void store(float* p) const
+	{
+#if defined(SIMPLEMATH_AVX)
+		_mm256_storeu_ps(p, v);
+#else
+		lo.store(p);
+		hi.store(p + 4);
+#endif
+	}
+
+	float operator[](unsigned i) const
+	{
+		float tmp[8];
+		store(tmp);
+		return tmp[i];
+	}
+
+	void set(unsigned i, float a)
+	{
+		float tmp[8];
+		store(tmp);
+		tmp[i] = a;
+		*this = load(tmp);
+	}
+
+	// Bit i is set if the sign bit of lane i is set (for masks: if lane is 'true')
+	int mask() const
+	{
+#if defined(SIMPLEMATH_AVX)
+		return _mm256_movemask_ps(v);
+#else
+		return lo.mask() | (hi.mask() << 4);
+#endif
+	}
+
+#if defined(SIMPLEMATH_AVX)
+	__m256 v;
+#else
+	floatx4 lo, hi;
+#endif
+};
+
+#if defined(SIMPLEMATH_AVX)
+	#define SIMPLEMATH_X8_OPERATOR(op, expr) inline floatx8 operator op(const floatx8& a, const floatx8& b) { return floatx8(expr); }
+#else
+	#define SIMPLEMATH_X8_OPERATOR(op, expr) inline floatx8 operator op(const floatx8& a, const floatx8& b) { return floatx8(a.lo op b.lo, a.hi op b.hi); }
+#endif
+
+SIMPLEMATH_X8_OPERATOR(+, _mm256_add_ps(a.v, b.v))
+SIMPLEMATH_X8_OPERATOR(-, _mm256_sub_ps(a.v, b.v))
+SIMPLEMATH_X8_OPERATOR(*, _mm256_mul_ps(a.v, b.v))
+SIMPLEMATH_X8_OPERATOR(/, _mm256_div_ps(a.v, b.v))
+
+SIMPLEMATH_X8_OPERATOR(<, _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ))
+SIMPLEMATH_X8_OPERATOR(<=, _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ))
+SIMPLEMATH_X8_OPERATOR(>, _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ))
+SIMPLEMATH_X8_OPERATOR(>=, _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ))
+SIMPLEMATH_X8_OPERATOR(==, _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ))
+
+SIMPLEMATH_X8_OPERATOR(&, _mm256_and_ps(a.v, b.v))
+SIMPLEMATH_X8_OPERATOR(|, _mm256_or_ps(a.v, b.v))
+SIMPLEMATH_X8_OPERATOR(^, _mm256_xor_ps(a.v, b.v))
+
+#undef SIMPLEMATH_X8_OPERATOR
+
+inline floatx8 operator-(const floatx8& a)
+{
+	return a ^ floatx8(-0.0f);
+}
+
+inline floatx8 operator~(const floatx8& a)
+{
+	return a ^ (floatx8(0.0f) == floatx8(0.0f));
+}
+
+inline floatx8 minimum(const floatx8& a, const floatx8& b)
+{
+#if defined(SIMPLEMATH_AVX)
+	return floatx8(_mm256_min_ps(a.v, b.v));
+#else
+	return floatx8(minimum(a.lo, b.lo), minimum(a.hi, b.hi));
+#endif
+}
+
+inline floatx8 maximum(const floatx8& a, const floatx8& b)
+{
+#if defined(SIMPLEMATH_AVX)
+	return floatx8(_mm256_max_ps(a.v, b.v));
+#else
+	return floatx8(maximum(a.lo, b.lo), maximum(a.hi, b.hi));
+#endif
+}
+
+inline floatx8 sqrt(const floatx8& a)
+{
+#if defined(SIMPLEMATH_AVX)
+	return floatx8(_mm256_sqrt_ps(a.v));
+#else
+	return floatx8(sqrt(a.lo), sqrt(a.hi));
+#endif
+}
+
+inline floatx8 abs(const floatx8& a)
+{
+	return floatx8(-0.0f) ^ (a | floatx8(-0.0f));
+}
+
+// Same result in each lane as mul_add
+inline floatx8 mul_add(const floatx8& a, const floatx8& b, const floatx8& c)
+{
+#if defined(SIMPLEMATH_FMA) && defined(SIMPLEMATH_AVX)
+	return floatx8(_mm256_fmadd_ps(a.v, b.v, c.v));
+#elif defined(SIMPLEMATH_AVX)
+	return a * b + c;
+#else
+	return floatx8(mul_add(a.lo, b.lo, c.lo), mul_add(a.hi, b.hi, c.hi));
+#endif
+}
+
+// 1 / sqrt(x) for x > 0, same result in each lane as fast_rsqrt
+inline floatx8 fast_rsqrt(const floatx8& a)
+{
+#if defined(SIMPLEMATH_AVX)
+	floatx8 r(_mm256_rsqrt_ps(a.v));
+
+	return r * (floatx8(1.5f) - floatx8(0.5f) * a * r * r);
+#else
+	return floatx8(fast_rsqrt(a.lo), fast_rsqrt(a.hi));
+#endif
+}
+
+inline floatx8 select(const floatx8& mask, const floatx8& a, const floatx8& b)
+{
+#if defined(SIMPLEMATH_AVX)
+	return floatx8(_mm256_blendv_ps(b.v, a.v, mask.v));
+#else
+	return floatx8(select(mask.lo, a.lo, b.lo), select(mask.hi, a.hi, b.hi));
+#endif
+}
+
+/********************************************************************************/
+/*								vec3x4, vec3x8									*/
+/********************************************************************************/
+
+// Several vec3 values, one per lane, with the same interface as vec3
+// Every lane gets exactly the same result as the vec3 function
+template<typename T>
+struct vec3_wide
+{
+	vec3_wide()
+	{
+	}
+
+	explicit vec3_wide(float v): x(v), y(v), z(v)
+	{
+	}
+
+	explicit vec3_wide(const vec3& v): x(v.x), y(v.y), z(v.z)
+	{
+	}
+
+	vec3_wide(const T& x, const T& y, const T& z): x(x), y(y), z(z)
+	{
+	}
+
+	// Unary operators
+	const vec3_wide operator-() const
+	{
+		return vec3_wide(-x, -y, -z);
+	}
+
+	// Binary operators
+	const vec3_wide operator*(const T& a) const
+	{
+		return vec3_wide(x * a, y * a, z * a);
+	}
+
+	const vec3_wide operator/(const T& a) const
+	{
+		return vec3_wide(x / a, y / a, z / a);
+	}
+
+	const vec3_wide operator+(const vec3_wide& v) const
+	{
+		return vec3_wide(x + v.x, y + v.y, z + v.z);
+	}
+
+	const vec3_wide operator-(const vec3_wide& v) const
+	{
+		return vec3_wide(x - v.x, y - v.y, z - v.z);
+	}
+
+	const vec3_wide operator*(const vec3_wide& v) const
+	{
+		return vec3_wide(x * v.x, y * v.y, z * v.z);
+	}
+
+	const vec3_wide operator/(const vec3_wide& v) const
+	{
+		return vec3_wide(x / v.x, y / v.y, z / v.z);
+	}
+
+	// Assignment operators
+	vec3_wide& operator*=(const T& a)
+	{
+		return (*this = *this * a);
+	}
+
+	vec3_wide& operator/=(const T& a)
+	{
+		return (*this = *this / a);
+	}
+
+	vec3_wide& operator+=(const vec3_wide& v)
+	{
+		return (*this = *this + v);
+	}
+
+	vec3_wide& operator-=(const vec3_wide& v)
+	{
+		return (*this = *this - v);
+	}
+
+	// Functions
+	T length() const
+	{
+		return sqrt(x * x + y * y + z * z);
+	}
+
+	T length_squared() const
+	{
+		return x * x + y * y + z * z;
+	}
+
+	// Lanes shorter than Epsilon are left unchanged and return zero, as in vec3::normalize
+	T normalize()
+	{
+#if defined(SIMPLEMATH_FAST_MATH)
+		T len = length_squared();
+		T small = len < T(Epsilon() * Epsilon());
+
+		T inv = fast_rsqrt(len);
+
+		len = len * inv;
+#else
+		T len = length();
+		T small = len < T(Epsilon());
+
+		T inv = T(1.0f) / len;
+#endif
+
+		x = select(small, x, x * inv);
+		y = select(small, y, y * inv);
+		z = select(small, z, z * inv);
+
+		return select(small, T(0.0f), len);
+	}
+
+	vec3_wide normalized() const
+	{
+		vec3_wide ret = *this;
+		ret.normalize();
+		return ret;
+	}
+
+	T dot(const vec3_wide& v) const
+	{
+		return mul_add(z, v.z, mul_add(y, v.y, x * v.x));
+	}
+
+	vec3_wide cross(const vec3_wide& v2) const
+	{
+		return vec3_wide(mul_add(y, v2.z, -z * v2.y), mul_add(z, v2.x, -x * v2.z), mul_add(x, v2.y, -y * v2.x));
+	}
+
+	// Lane access
+	vec3 get(unsigned i) const
+	{
+		return vec3(x[i], y[i], z[i]);
+	}
+
+	void set(unsigned i, const vec3& v)
+	{
+		x.set(i, v.x);
+		y.set(i, v.y);
+		z.set(i, v.z);
+	}
+
+	T x, y, z;
+};
+
+template<typename T>
+inline vec3_wide<T> operator*(const T& f, const vec3_wide<T>& v)
+{
+	return vec3_wide<T>(f * v.x, f * v.y, f * v.z);
+}
+
+template<typename T>
+inline vec3_wide<T> normalize(vec3_wide<T> v)
+{
+	v.normalize();
+	return v;
+}
+
+template<typename T>
+inline vec3_wide<T> cross(const vec3_wide<T>& v1, const vec3_wide<T>& v2)
+{
+	return v1.cross(v2);
+}
+
+template<typename T>
+inline T dot(const vec3_wide<T>& v1, const vec3_wide<T>& v2)
+{
+	return v1.dot(v2);
+}
+
+// Same as dot(const vec3&, const vec4&) in each lane, distances from the points to a plane
+template<typename T>
+inline T dot(const vec3_wide<T>& v1, const vec4& v2)
+{
+#if defined(SIMPLEMATH_FMA)
+	return mul_add(v1.z, T(v2.z), mul_add(v1.y, T(v2.y), mul_add(v1.x, T(v2.x), T(v2.w))));
+#else
+	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z + v2.w;
+#endif
+}
+
+template<typename T>
+inline T length(const vec3_wide<T>& v)
+{
+	return v.length();
+}
+
+template<typename T>
+inline vec3_wide<T> saturate(const vec3_wide<T>& v)
+{
+	T zero(0.0f), one(1.0f);
+
+	return vec3_wide<T>(select(v.x < zero, zero, select(v.x > one, one, v.x)),
+						select(v.y < zero, zero, select(v.y > one, one, v.y)),
+						select(v.z < zero, zero, select(v.z > one, one, v.z)));
+}
+
+/********************************************************************************/
+/*								AoS <-> SoA										*/
+/********************************************************************************/
+
+// Loads four consecutive vec3 values
+inline vec3x4 load_vec3x4(const vec3* v)
+{
+#if defined(SIMPLEMATH_SSE41)
+	const float *p = &v[0].x;
+
+	__m128 a = _mm_loadu_ps(p);		// x0 y0 z0 x1
+	__m128 b = _mm_loadu_ps(p + 4);	// y1 z1 x2 y2
+	__m128 c = _mm_loadu_ps(p + 8);	// z2 x3 y3 z3
+
+	__m128 x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+	__m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), c, _MM_SHUFFLE(3, 0, 2, 0));
+
+	return vec3x4(floatx4(x), floatx4(y), floatx4(z));
+#else
+	return vec3x4(floatx4(v[0].x, v[1].x, v[2].x, v[3].x), floatx4(v[0].y, v[1].y, v[2].y, v[3].y), floatx4(v[0].z, v[1].z, v[2].z, v[3].z));
+#endif
+}
+
+// Loads four vec3 values that are 'stride' bytes apart (positions in an interleaved vertex buffer, aabb centers, etc.)
+inline vec3x4 load_vec3x4(const vec3* v, unsigned stride)
+{
+	const vec3 &v0 = *v;
+	const vec3 &v1 = *(const vec3*)((const char*)v + stride);
+	const vec3 &v2 = *(const vec3*)((const char*)v + stride * 2);
+	const vec3 &v3 = *(const vec3*)((const char*)v + stride * 3);
+
+#if defined(SIMPLEMATH_SSE41)
+	// Each vector is read without touching the memory after it
+	__m128 r0 = _mm_movelh_ps(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)&v0.x)), _mm_load_ss(&v0.z));
+	__m128 r1 = _mm_movelh_ps(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)&v1.x)), _mm_load_ss(&v1.z));
+	__m128 r2 = _mm_movelh_ps(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)&v2.x)), _mm_load_ss(&v2.z));
+	__m128 r3 = _mm_movelh_ps(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)&v3.x)), _mm_load_ss(&v3.z));
+
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+	return vec3x4(floatx4(r0), floatx4(r1), floatx4(r2));
+#else
+	return vec3x4(floatx4(v0.x, v1.x, v2.x, v3.x), floatx4(v0.y, v1.y, v2.y, v3.y), floatx4(v0.z, v1.z, v2.z, v3.z));
+#endif
+}
+
+// Stores four consecutive vec3 values
+inline void store_vec3x4(vec3* v, const vec3x4& s)
+{
+#if defined(SIMPLEMATH_SSE41)
+	__m128 x = s.x.v, y = s.y.v, z = s.z.v;
+
+	__m128 a = _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 b = _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 c = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+
+	float *p = &v[0].x;
+
+	_mm_storeu_ps(p, a);
+	_mm_storeu_ps(p + 4, b);
+	_mm_storeu_ps(p + 8, c);
+#else
+	for(unsigned i = 0; i < 4; i++)
+		v[i] = s.get(i);
+#endif
+}
+
+inline void store_vec3x4(vec3* v, unsigned stride, const vec3x4& s)
+{
+	for(unsigned i = 0; i < 4; i++)
+		*(vec3*)((char*)v + stride * i) = s.get(i);
+}
+
+inline vec3x8 load_vec3x8(const vec3* v)
+{
+	vec3x4 lo = load_vec3x4(v);
+	vec3x4 hi = load_vec3x4(v + 4);
+
+	return vec3x8(floatx8(lo.x, hi.x), floatx8(lo.y, hi.y), floatx8(lo.z, hi.z));
+}
+
+inline vec3x8 load_vec3x8(const vec3* v, unsigned stride)
+{
+	vec3x4 lo = load_vec3x4(v, stride);
+	vec3x4 hi = load_vec3x4((const vec3*)((const char*)v + stride * 4), stride);
+
+	return vec3x8(floatx8(lo.x, hi.x), floatx8(lo.y, hi.y), floatx8(lo.z, hi.z));
+}
+
+inline void store_vec3x8(vec3* v, const vec3x8& s)
+{
+	store_vec3x4(v, vec3x4(s.x.low(), s.y.low(), s.z.low()));
+	store_vec3x4(v + 4, vec3x4(s.x.high(), s.y.high(), s.z.high()));
+}
+
+inline void store_vec3x8(vec3* v, unsigned stride, const vec3x8& s)
+{
+	store_vec3x4(v, stride, vec3x4(s.x.low(), s.y.low(), s.z.low()));
+	store_vec3x4((vec3*)((char*)v + stride * 4), stride, vec3x4(s.x.high(), s.y.high(), s.z.high()));
+}
+
+/********************************************************************************/
+/*								vec3_soa										*/
+/********************************************************************************/
+
+// Storage is padded with zeroes to a multiple of 8 elements, so wide loads and stores never need a scalar tail
+struct vec3_soa
+{
+	vec3_soa(): count(0)
+	{
+	}
+
+	explicit vec3_soa(unsigned size): count(0)
+	{
+		resize(size);
+	}
+
+	vec3_soa(const vec3* v, unsigned size, unsigned stride = sizeof(vec3)): count(0)
+	{
+		gather(v, size, stride);
+	}
+
+	unsigned size() const
+	{
+		return count;
+	}
+
+	void resize(unsigned size)
+	{
+		count = size;
+
+		unsigned padded = (size + 7) & ~7u;
+
+		x.resize(padded);
+		y.resize(padded);
+		z.resize(padded);
+	}
+
+	void clear()
+	{
+		resize(0);
+	}
+
+	void push_back(const vec3& v)
+	{
+		resize(count + 1);
+		set(count - 1, v);
+	}
+
+	vec3 get(unsigned i) const
+	{
+		return vec3(x[i], y[i], z[i]);
+	}
+
+	void set(unsigned i, const vec3& v)
+	{
+		x[i] = v.x;
+		y[i] = v.y;
+		z[i] = v.z;
+	}
+
+	// Wide access to elements [i, i + 4) or [i, i + 8)
+	vec3x4 load4(unsigned i) const
+	{
+		return vec3x4(floatx4::load(&x[i]), floatx4::load(&y[i]), floatx4::load(&z[i]));
+	}
+
+	vec3x8 load8(unsigned i) const
+	{
+		return vec3x8(floatx8::load(&x[i]), floatx8::load(&y[i]), floatx8::load(&z[i]));
+	}
+
+	void store(unsigned i, const vec3x4& v)
+	{
+		v.x.store(&x[i]);
+		v.y.store(&y[i]);
+		v.z.store(&z[i]);
+	}
+
+	void store(unsigned i, const vec3x8& v)
+	{
+		v.x.store(&x[i]);
+		v.y.store(&y[i]);
+		v.z.store(&z[i]);
+	}
+
+	// Replace contents with 'size' vec3 values that are 'stride' bytes apart
+	void gather(const vec3* v, unsigned size, unsigned stride = sizeof(vec3))
+	{
+		resize(size);
+
+		unsigned i = 0;
+
+		if(stride == sizeof(vec3))
+		{
+			for(; i + 4 <= size; i += 4)
+				store(i, load_vec3x4(v + i));
+		}
+		else
+		{
+			for(; i + 4 <= size; i += 4)
+				store(i, load_vec3x4((const vec3*)((const char*)v + stride * i), stride));
+		}
+
+		for(; i < size; i++)
+			set(i, *(const vec3*)((const char*)v + stride * i));
+	}
+
+	// Write all elements to vec3 values that are 'stride' bytes apart
+	void scatter(vec3* v, unsigned stride = sizeof(vec3)) const
+	{
+		unsigned i = 0;
+
+		if(stride == sizeof(vec3))
+		{
+			for(; i + 4 <= count; i += 4)
+				store_vec3x4(v + i, load4(i));
+		}
+
+		for(; i < count; i++)
+			*(vec3*)((char*)v + stride * i) = get(i);
+	}
+
+	std::vector<float> x, y, z;
+	unsigned count;
+};
+
+/********************************************************************************/
+/*								vec4_soa										*/
+/********************************************************************************/
+
+struct vec4_soa
+{
+	vec4_soa(): count(0)
+	{
+	}
+
+	explicit vec4_soa(unsigned size): count(0)
+	{
+		resize(size);
+	}
+
+	vec4_soa(const vec4* v, unsigned size, unsigned stride = sizeof(vec4)): count(0)
+	{
+		gather(v, size, stride);
+	}
+
+	unsigned size() const
+	{
+		return count;
+	}
+
+	void resize(unsigned size)
+	{
+		count = size;
+
+		unsigned padded = (size + 7) & ~7u;
+
+		x.resize(padded);
+		y.resize(padded);
+		z.resize(padded);
+		w.resize(padded);
+	}
+
+	void clear()
+	{
+		resize(0);
+	}
+
+	void push_back(const vec4& v)
+	{
+		resize(count + 1);
+		set(count - 1, v);
+	}
+
+	vec4 get(unsigned i) const
+	{
+		return vec4(x[i], y[i], z[i], w[i]);
+	}
+
+	void set(unsigned i, const vec4& v)
+	{
+		x[i] = v.x;
+		y[i] = v.y;
+		z[i] = v.z;
+		w[i] = v.w;
+	}
+
+	// Wide access to elements [i, i + 4) or [i, i + 8), the xyz part and w are returned separately
+	vec3x4 load4(unsigned i, floatx4& lanesW) const
+	{
+		lanesW = floatx4::load(&w[i]);
+
+		return vec3x4(floatx4::load(&x[i]), floatx4::load(&y[i]), floatx4::load(&z[i]));
+	}
+
+	vec3x8 load8(unsigned i, floatx8& lanesW) const
+	{
+		lanesW = floatx8::load(&w[i]);
+
+		return vec3x8(floatx8::load(&x[i]), floatx8::load(&y[i]), floatx8::load(&z[i]));
+	}
+
+	void store(unsigned i, const vec3x4& v, const floatx4& lanesW)
+	{
+		v.x.store(&x[i]);
+		v.y.store(&y[i]);
+		v.z.store(&z[i]);
+		lanesW.store(&w[i]);
+	}
+
+	void store(unsigned i, const vec3x8& v, const floatx8& lanesW)
+	{
+		v.x.store(&x[i]);
+		v.y.store(&y[i]);
+		v.z.store(&z[i]);
+		lanesW.store(&w[i]);
+	}
+
+	// Replace contents with 'size' vec4 values that are 'stride' bytes apart
+	void gather(const vec4* v, unsigned size, unsigned stride = sizeof(vec4))
+	{
+		resize(size);
+
+		unsigned i = 0;
+
+#if defined(SIMPLEMATH_SSE41)
+		for(; i + 4 <= size; i += 4)
+		{
+			__m128 r0 = _mm_loadu_ps(&((const vec4*)((const char*)v + stride * i))->x);
+			__m128 r1 = _mm_loadu_ps(&((const vec4*)((const char*)v + stride * (i + 1)))->x);
+			__m128 r2 = _mm_loadu_ps(&((const vec4*)((const char*)v + stride * (i + 2)))->x);
+			__m128 r3 = _mm_loadu_ps(&((const vec4*)((const char*)v + stride * (i + 3)))->x);
+
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+			_mm_storeu_ps(&x[i], r0);
+			_mm_storeu_ps(&y[i], r1);
+			_mm_storeu_ps(&z[i], r2);
+			_mm_storeu_ps(&w[i], r3);
+		}
+#endif
+
+		for(; i < size; i++)
+			set(i, *(const vec4*)((const char*)v + stride * i));
+	}
+
+	// Write all elements to vec4 values that are 'stride' bytes apart
+	void scatter(vec4* v, unsigned stride = sizeof(vec4)) const
+	{
+		unsigned i = 0;
+
+#if defined(SIMPLEMATH_SSE41)
+		for(; i + 4 <= count; i += 4)
+		{
+			__m128 r0 = _mm_loadu_ps(&x[i]);
+			__m128 r1 = _mm_loadu_ps(&y[i]);
+			__m128 r2 = _mm_loadu_ps(&z[i]);
+			__m128 r3 = _mm_loadu_ps(&w[i]);
+
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+			_mm_storeu_ps(&((vec4*)((char*)v + stride * i))->x, r0);
+			_mm_storeu_ps(&((vec4*)((char*)v + stride * (i + 1)))->x, r1);
+			_mm_storeu_ps(&((vec4*)((char*)v + stride * (i + 2)))->x, r2);
+			_mm_storeu_ps(&((vec4*)((char*)v + stride * (i + 3)))->x, r3);
+		}
+#endif
+
+		for(; i < count; i++)
+			*(vec4*)((char*)v + stride * i) = get(i);
+	}
+
+	std::vector<float> x, y, z, w;
+	unsigned count;
+};
+
+#undef Epsilon
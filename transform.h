@@ -0,0 +1,269 @@
+#pragma once
+
+#include <math.h>
+
+#include "vector.h"
+#include "matrix.h"
+#include "quat.h"
+#include "affine.h"
+#include "soa.h"
+
+/********************************************************************************/
+/*								transform										*/
+/********************************************************************************/
+
+// Scale, then rotation, then translation, the usual output of animation sampling
+// Converted to a matrix directly, without the temporary matrices and the multiplications of mat4::scale/mat4::translate
+struct transform
+{
+	SIMPLEMATH_CONSTEXPR transform(): rotation(), translation(0.0f, 0.0f, 0.0f), scale(1.0f, 1.0f, 1.0f)
+	{
+	}
+
+	SIMPLEMATH_CONSTEXPR transform(const vec3& translation, const quat& rotation, const vec3& scale): rotation(rotation), translation(translation), scale(scale)
+	{
+	}
+
+	explicit transform(uninitialized_tag): rotation(uninitialized), translation(uninitialized), scale(uninitialized)
+	{
+	}
+
+	// Transformation 't' followed by this one
+	// Exact when the scale of this transformation is uniform, otherwise the shear of the product is lost
+	transform operator*(const transform& t) const
+	{
+		return transform(translation + rotation.transform_vector(scale * t.translation), rotation * t.rotation, scale * t.scale);
+	}
+
+	// Exact when the scale is uniform, same as the multiplication
+	transform inverse() const
+	{
+		quat inv = rotation.conjugate();
+		vec3 invScale(1.0f / scale.x, 1.0f / scale.y, 1.0f / scale.z);
+
+		return transform(inv.transform_vector(-translation) * invScale, inv, invScale);
+	}
+
+	vec3 transform_point(const vec3& v) const
+	{
+		return translation + rotation.transform_vector(v * scale);
+	}
+
+	// Translation is ignored
+	vec3 transform_vector(const vec3& v) const
+	{
+		return rotation.transform_vector(v * scale);
+	}
+
+	// Translation and scale are interpolated linearly, rotation with quat::slerp
+	void interpolate(const transform& t0, const transform& t1, float t)
+	{
+		translation = t0.translation + (t1.translation - t0.translation) * t;
+		rotation.slerp(t0.rotation, t1.rotation, t);
+		scale = t0.scale + (t1.scale - t0.scale) * t;
+	}
+
+	// Columns of quat::to_matrix multiplied by the scale
+	// Written in place without the default identity, which made the compiler assemble the result on the stack
+	mat4 to_matrix() const
+	{
+		mat3 r = rotation.to_matrix();
+
+		mat4 ret(uninitialized);
+
+		ret.mat[0] = r.mat[0] * scale.x; ret.mat[1] = r.mat[1] * scale.x; ret.mat[2] = r.mat[2] * scale.x; ret.mat[3] = 0.0f;
+		ret.mat[4] = r.mat[3] * scale.y; ret.mat[5] = r.mat[4] * scale.y; ret.mat[6] = r.mat[5] * scale.y; ret.mat[7] = 0.0f;
+		ret.mat[8] = r.mat[6] * scale.z; ret.mat[9] = r.mat[7] * scale.z; ret.mat[10] = r.mat[8] * scale.z; ret.mat[11] = 0.0f;
+		ret.mat[12] = translation.x; ret.mat[13] = translation.y; ret.mat[14] = translation.z; ret.mat[15] = 1.0f;
+
+		return ret;
+	}
+
+	affine3x4 to_affine() const
+	{
+		mat3 r = rotation.to_matrix();
+
+		affine3x4 ret(uninitialized);
+
+		ret.mat[0] = r.mat[0] * scale.x; ret.mat[1] = r.mat[3] * scale.y; ret.mat[2] = r.mat[6] * scale.z; ret.mat[3] = translation.x;
+		ret.mat[4] = r.mat[1] * scale.x; ret.mat[5] = r.mat[4] * scale.y; ret.mat[6] = r.mat[7] * scale.z; ret.mat[7] = translation.y;
+		ret.mat[8] = r.mat[2] * scale.x; ret.mat[9] = r.mat[5] * scale.y; ret.mat[10] = r.mat[8] * scale.z; ret.mat[11] = translation.z;
+
+		return ret;
+	}
+
+	quat rotation;
+	vec3 translation;
+	vec3 scale;
+};
+
+// Padded to the alignment of quat in SIMPLEMATH_SIMD builds
+#if defined(SIMPLEMATH_SSE41)
+SIMPLEMATH_ASSERT_PLAIN_TYPE(transform, 48);
+#else
+SIMPLEMATH_ASSERT_PLAIN_TYPE(transform, 40);
+#endif
+
+/********************************************************************************/
+/*								Batch operations								*/
+/********************************************************************************/
+
+#if defined(SIMPLEMATH_SSE41)
+// Components of eight transforms, transposed into lanes: rotation x, y, z, w, translation x, y, z and scale x, y, z
+inline void load_transformx8(floatx8 *lanes, const transform *t)
+{
+	__m128 r0 = t[0].rotation.simd(), r1 = t[1].rotation.simd(), r2 = t[2].rotation.simd(), r3 = t[3].rotation.simd();
+	__m128 r4 = t[4].rotation.simd(), r5 = t[5].rotation.simd(), r6 = t[6].rotation.simd(), r7 = t[7].rotation.simd();
+
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_MM_TRANSPOSE4_PS(r4, r5, r6, r7);
+
+	lanes[0] = floatx8(floatx4(r0), floatx4(r4)); lanes[1] = floatx8(floatx4(r1), floatx4(r5)); lanes[2] = floatx8(floatx4(r2), floatx4(r6)); lanes[3] = floatx8(floatx4(r3), floatx4(r7));
+
+	// Translation followed by the scale x, the last lane is dropped
+	__m128 t0 = _mm_loadu_ps(&t[0].translation.x), t1 = _mm_loadu_ps(&t[1].translation.x), t2 = _mm_loadu_ps(&t[2].translation.x), t3 = _mm_loadu_ps(&t[3].translation.x);
+	__m128 t4 = _mm_loadu_ps(&t[4].translation.x), t5 = _mm_loadu_ps(&t[5].translation.x), t6 = _mm_loadu_ps(&t[6].translation.x), t7 = _mm_loadu_ps(&t[7].translation.x);
+
+	_MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+	_MM_TRANSPOSE4_PS(t4, t5, t6, t7);
+
+	lanes[4] = floatx8(floatx4(t0), floatx4(t4)); lanes[5] = floatx8(floatx4(t1), floatx4(t5)); lanes[6] = floatx8(floatx4(t2), floatx4(t6));
+
+	// Scale followed by the padding, the last lane is dropped
+	__m128 s0 = _mm_loadu_ps(&t[0].scale.x), s1 = _mm_loadu_ps(&t[1].scale.x), s2 = _mm_loadu_ps(&t[2].scale.x), s3 = _mm_loadu_ps(&t[3].scale.x);
+	__m128 s4 = _mm_loadu_ps(&t[4].scale.x), s5 = _mm_loadu_ps(&t[5].scale.x), s6 = _mm_loadu_ps(&t[6].scale.x), s7 = _mm_loadu_ps(&t[7].scale.x);
+
+	_MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+	_MM_TRANSPOSE4_PS(s4, s5, s6, s7);
+
+	lanes[7] = floatx8(floatx4(s0), floatx4(s4)); lanes[8] = floatx8(floatx4(s1), floatx4(s5)); lanes[9] = floatx8(floatx4(s2), floatx4(s6));
+}
+
+// Lanes 'a', 'b', 'c' and 'd' of eight matrices are stored as four consecutive floats at 'offset' of each matrix
+template<typename Matrix>
+inline void store_transposedx8(Matrix *ret, unsigned offset, const floatx8 &a, const floatx8 &b, const floatx8 &c, const floatx8 &d)
+{
+	__m128 r0 = a.low().v, r1 = b.low().v, r2 = c.low().v, r3 = d.low().v;
+	__m128 r4 = a.high().v, r5 = b.high().v, r6 = c.high().v, r7 = d.high().v;
+
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_MM_TRANSPOSE4_PS(r4, r5, r6, r7);
+
+	_mm_storeu_ps(&ret[0].mat[offset], r0); _mm_storeu_ps(&ret[1].mat[offset], r1); _mm_storeu_ps(&ret[2].mat[offset], r2); _mm_storeu_ps(&ret[3].mat[offset], r3);
+	_mm_storeu_ps(&ret[4].mat[offset], r4); _mm_storeu_ps(&ret[5].mat[offset], r5); _mm_storeu_ps(&ret[6].mat[offset], r6); _mm_storeu_ps(&ret[7].mat[offset], r7);
+}
+
+// Rows of eight 4x4 matrices in m[4 * row + column], stored as the columns of mat4
+inline void store_matrixx8(mat4 *ret, const floatx8 *m)
+{
+	store_transposedx8(ret, 0, m[0], m[4], m[8], m[12]);
+	store_transposedx8(ret, 4, m[1], m[5], m[9], m[13]);
+	store_transposedx8(ret, 8, m[2], m[6], m[10], m[14]);
+	store_transposedx8(ret, 12, m[3], m[7], m[11], m[15]);
+}
+
+// Same as above, the first three rows are stored as the rows of affine3x4
+inline void store_matrixx8(affine3x4 *ret, const floatx8 *m)
+{
+	store_transposedx8(ret, 0, m[0], m[1], m[2], m[3]);
+	store_transposedx8(ret, 4, m[4], m[5], m[6], m[7]);
+	store_transposedx8(ret, 8, m[8], m[9], m[10], m[11]);
+}
+
+// Eight transforms at a time, each lane is computed exactly like transform::to_matrix
+template<typename Matrix>
+inline void transform_to_matrix_x8(Matrix *ret, const transform *t)
+{
+	floatx8 lanes[10];
+
+	load_transformx8(lanes, t);
+
+	const floatx8 &x = lanes[0], &y = lanes[1], &z = lanes[2], &w = lanes[3];
+
+	// Same as quat::to_matrix
+	floatx8 x2 = x + x;
+	floatx8 y2 = y + y;
+	floatx8 z2 = z + z;
+	floatx8 xx = x * x2;
+	floatx8 yy = y * y2;
+	floatx8 zz = z * z2;
+	floatx8 xy = x * y2;
+	floatx8 yz = y * z2;
+	floatx8 xz = z * x2;
+	floatx8 wx = w * x2;
+	floatx8 wy = w * y2;
+	floatx8 wz = w * z2;
+
+	floatx8 one(1.0f);
+	floatx8 zero(0.0f);
+
+	floatx8 m[16];
+
+	m[0] = (one - (yy + zz)) * lanes[7]; m[1] = (xy - wz) * lanes[8]; m[2] = (xz + wy) * lanes[9]; m[3] = lanes[4];
+	m[4] = (xy + wz) * lanes[7]; m[5] = (one - (xx + zz)) * lanes[8]; m[6] = (yz - wx) * lanes[9]; m[7] = lanes[5];
+	m[8] = (xz - wy) * lanes[7]; m[9] = (yz + wx) * lanes[8]; m[10] = (one - (xx + yy)) * lanes[9]; m[11] = lanes[6];
+	m[12] = zero; m[13] = zero; m[14] = zero; m[15] = one;
+
+	store_matrixx8(ret, m);
+}
+
+template<typename Matrix>
+inline void transform_to_matrix_array(Matrix *ret, const transform *t, unsigned count)
+{
+	unsigned i = 0;
+
+	for(; i + 8 <= count; i += 8)
+		transform_to_matrix_x8(ret + i, t + i);
+
+	if(i < count)
+	{
+		// Remaining transforms are converted in a padded group
+		transform src[8];
+		Matrix dst[8];
+
+		for(unsigned k = 0; i + k < count; k++)
+			src[k] = t[i + k];
+
+		transform_to_matrix_x8(dst, src);
+
+		for(unsigned k = 0; i + k < count; k++)
+			ret[i + k] = dst[k];
+	}
+}
+#endif
+
+// Same results as transform::to_matrix and transform::to_affine for each element, in a single pass over the arrays
+// Scalar builds convert one transform at a time, the lanes of floatx8 would only add a round trip through the stack
+inline void to_matrix(mat4 *ret, const transform *t, unsigned count)
+{
+#if defined(SIMPLEMATH_SSE41)
+	transform_to_matrix_array(ret, t, count);
+#else
+	for(unsigned i = 0; i < count; i++)
+		ret[i] = t[i].to_matrix();
+#endif
+}
+
+inline void to_matrix(affine3x4 *ret, const transform *t, unsigned count)
+{
+#if defined(SIMPLEMATH_SSE41)
+	transform_to_matrix_array(ret, t, count);
+#else
+	for(unsigned i = 0; i < count; i++)
+		ret[i] = t[i].to_affine();
+#endif
+}
+
+// ret[i] = parent[i] * local[i], 'ret' can be the same array as 'parent' or 'local'
+inline void mul(transform *ret, const transform *parent, const transform *local, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i] = parent[i] * local[i];
+}
+
+// Same results as transform::interpolate for each element, input and output can be the same array
+inline void interpolate(transform *ret, const transform *t0, const transform *t1, float t, unsigned count)
+{
+	for(unsigned i = 0; i < count; i++)
+		ret[i].interpolate(t0[i], t1[i], t);
+}
@@ -2,95 +2,128 @@
 
 #include <math.h>
 
+#include <type_traits>
+
+#include "config.h"
+#include "fastmath.h"
+
 #define Epsilon() 1e-6f
 
 struct vec2;
 struct vec3;
 struct vec4;
 
+// Constructors with this tag leave the values uninitialized, for results and arrays that are written right after
+//	mat4 world(uninitialized);
+//	mul(world, parent, local);
+enum uninitialized_tag
+{
+	uninitialized
+};
+
+// Types are copied with memcpy/memmove by containers and can be streamed as raw floats
+#define SIMPLEMATH_ASSERT_PLAIN_TYPE(type, size) \
+	static_assert(std::is_trivially_copyable<type>::value, #type " must be trivially copyable"); \
+	static_assert(std::is_standard_layout<type>::value, #type " must have a standard layout"); \
+	static_assert(sizeof(type) == size, #type " must have no padding")
+
+// a * b + c, rounded once with SIMPLEMATH_FMA
+inline SIMPLEMATH_CONSTEXPR float mul_add(float a, float b, float c)
+{
+#if defined(SIMPLEMATH_FMA)
+	if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		return fmaf(a, b, c);
+
+	// The product is exact in double precision, the sum can differ from fmaf in the last bit
+	return float(double(a) * double(b) + double(c));
+#else
+	return a * b + c;
+#endif
+}
+
 /********************************************************************************/
 /*								vec2											*/
 /********************************************************************************/
 
 struct vec2
 {
-	vec2(): x(0.0f), y(0.0f)
+	SIMPLEMATH_CONSTEXPR vec2(): x(0.0f), y(0.0f)
 	{
 	}
 
-	explicit vec2(float v): x(v), y(v)
+	SIMPLEMATH_CONSTEXPR explicit vec2(float v): x(v), y(v)
 	{
 	}
 
-	vec2(const vec2& v): x(v.x), y(v.y)
+	explicit vec2(uninitialized_tag)
 	{
 	}
 
-	explicit vec2(const float* v): x(v[0]), y(v[1])
+	SIMPLEMATH_CONSTEXPR explicit vec2(const float* v): x(v[0]), y(v[1])
 	{
 	}
 
-	vec2(float x, float y): x(x), y(y)
+	SIMPLEMATH_CONSTEXPR vec2(float x, float y): x(x), y(y)
 	{
 	}
 
-	explicit vec2(const vec3& v);
-	explicit vec2(const vec4& v);
+	SIMPLEMATH_CONSTEXPR explicit vec2(const vec3& v);
+	SIMPLEMATH_CONSTEXPR explicit vec2(const vec4& v);
 
 	// Unary operators
-	const vec2 operator-() const
+	SIMPLEMATH_CONSTEXPR vec2 operator-() const
 	{
 		return vec2(-x, -y);
 	}
 
 	// Binary operators
-	const vec2 operator*(float a) const
+	SIMPLEMATH_CONSTEXPR vec2 operator*(float a) const
 	{
 		return vec2(x*a, y*a);
 	}
 
-	const vec2 operator/(float a) const
+	SIMPLEMATH_CONSTEXPR vec2 operator/(float a) const
 	{
 		return vec2(x / a, y / a);
 	}
 
-	const vec2 operator+(const vec2& v) const
+	SIMPLEMATH_CONSTEXPR vec2 operator+(const vec2& v) const
 	{
 		return vec2(x + v.x, y + v.y);
 	}
 
-	const vec2 operator-(const vec2& v) const
+	SIMPLEMATH_CONSTEXPR vec2 operator-(const vec2& v) const
 	{
 		return vec2(x - v.x, y - v.y);
 	}
 
-	bool operator==(const vec2& v) const
+	SIMPLEMATH_CONSTEXPR bool operator==(const vec2& v) const
 	{
 		return v.x == x && v.y == y;
 	}
 
-	bool operator!=(const vec2& v) const
+	SIMPLEMATH_CONSTEXPR bool operator!=(const vec2& v) const
 	{
 		return !(*this == v);
 	}
 
 	// Assignment operators
-	vec2& operator*=(float a)
+	SIMPLEMATH_CONSTEXPR vec2& operator*=(float a)
 	{
 		return (*this = *this * a);
 	}
 
-	vec2& operator/=(float a)
+	SIMPLEMATH_CONSTEXPR vec2& operator/=(float a)
 	{
 		return (*this = *this / a);
 	}
 
-	vec2& operator+=(const vec2& v)
+	SIMPLEMATH_CONSTEXPR vec2& operator+=(const vec2& v)
 	{
 		return (*this = *this + v);
 	}
 
-	vec2& operator-=(const vec2& v)
+	SIMPLEMATH_CONSTEXPR vec2& operator-=(const vec2& v)
 	{
 		return (*this = *this - v);
 	}
@@ -101,19 +134,30 @@ struct vec2
 		return sqrtf(x * x + y * y);
 	}
 
-	float length_squared() const
+	SIMPLEMATH_CONSTEXPR float length_squared() const
 	{
 		return x * x + y * y;
 	}
 
 	float normalize()
 	{
+#if defined(SIMPLEMATH_FAST_MATH)
+		float len = length_squared();
+
+		if(len < Epsilon() * Epsilon())
+			return 0.0f;
+
+		float inv = fast_rsqrt(len);
+
+		len *= inv;
+#else
 		float len = length();
 
 		if(len < Epsilon())
 			return 0.0f;
 
 		float inv = 1.0f / len;
+#endif
 
 		x *= inv;
 		y *= inv;
@@ -123,19 +167,31 @@ struct vec2
 
 	vec2 normalized() const
 	{
+#if defined(SIMPLEMATH_FAST_MATH)
+		float len = length_squared();
+
+		if(len < Epsilon() * Epsilon())
+			return *this;
+
+		float inv = fast_rsqrt(len);
+#else
 		float len = length();
 
 		if(len < Epsilon())
 			return *this;
 
 		float inv = 1.0f / len;
+#endif
 
 		return *this * inv;
 	}
 
 	vec2 rotated(float radians) const
 	{
-		return vec2(x * cosf(radians) - y * sinf(radians), x * sinf(radians) + y * cosf(radians));
+		float s, c;
+		math_sincos(radians, s, c);
+
+		return vec2(x * c - y * s, x * s + y * c);
 	}
 
 	float x, y;
@@ -147,96 +203,96 @@ struct vec2
 
 struct vec3
 {
-	vec3(): x(0.0f), y(0.0f), z(0.0f)
+	SIMPLEMATH_CONSTEXPR vec3(): x(0.0f), y(0.0f), z(0.0f)
 	{
 	}
 
-	explicit vec3(float v): x(v), y(v), z(v)
+	SIMPLEMATH_CONSTEXPR explicit vec3(float v): x(v), y(v), z(v)
 	{
 	}
 
-	vec3(const vec2& v, float z): x(v.x), y(v.y), z(z)
+	SIMPLEMATH_CONSTEXPR vec3(const vec2& v, float z): x(v.x), y(v.y), z(z)
 	{
 	}
 
-	vec3(const vec3& v): x(v.x), y(v.y), z(v.z)
+	explicit vec3(uninitialized_tag)
 	{
 	}
 
-	explicit vec3(const float* v): x(v[0]), y(v[1]), z(v[2])
+	SIMPLEMATH_CONSTEXPR explicit vec3(const float* v): x(v[0]), y(v[1]), z(v[2])
 	{
 	}
 
-	vec3(float x, float y, float z): x(x), y(y), z(z)
+	SIMPLEMATH_CONSTEXPR vec3(float x, float y, float z): x(x), y(y), z(z)
 	{
 	}
 
-	explicit vec3(const vec4& v);
+	SIMPLEMATH_CONSTEXPR explicit vec3(const vec4& v);
 
 	// Unary operators
-	const vec3 operator-() const
+	SIMPLEMATH_CONSTEXPR vec3 operator-() const
 	{
 		return vec3(-x, -y, -z);
 	}
 
 	// Binary operators
-	const vec3 operator*(float a) const
+	SIMPLEMATH_CONSTEXPR vec3 operator*(float a) const
 	{
 		return vec3(x*a, y*a, z*a);
 	}
 
-	const vec3 operator/(float a) const
+	SIMPLEMATH_CONSTEXPR vec3 operator/(float a) const
 	{
 		return vec3(x / a, y / a, z / a);
 	}
 
-	const vec3 operator+(const vec3& v) const
+	SIMPLEMATH_CONSTEXPR vec3 operator+(const vec3& v) const
 	{
 		return vec3(x + v.x, y + v.y, z + v.z);
 	}
 
-	const vec3 operator-(const vec3& v) const
+	SIMPLEMATH_CONSTEXPR vec3 operator-(const vec3& v) const
 	{
 		return vec3(x - v.x, y - v.y, z - v.z);
 	}
 
-	const vec3 operator*(const vec3& v) const
+	SIMPLEMATH_CONSTEXPR vec3 operator*(const vec3& v) const
 	{
 		return vec3(x*v.x, y*v.y, z*v.z);
 	}
 
-	const vec3 operator/(const vec3& v) const
+	SIMPLEMATH_CONSTEXPR vec3 operator/(const vec3& v) const
 	{
 		return vec3(x / v.x, y / v.y, z / v.z);
 	}
 
-	bool operator==(const vec3& v) const
+	SIMPLEMATH_CONSTEXPR bool operator==(const vec3& v) const
 	{
 		return v.x == x && v.y == y && v.z == z;
 	}
 
-	bool operator!=(const vec3& v) const
+	SIMPLEMATH_CONSTEXPR bool operator!=(const vec3& v) const
 	{
 		return !(*this == v);
 	}
 
 	// Assignment operators
-	vec3& operator*=(float a)
+	SIMPLEMATH_CONSTEXPR vec3& operator*=(float a)
 	{
 		return (*this = *this * a);
 	}
 
-	vec3& operator/=(float a)
+	SIMPLEMATH_CONSTEXPR vec3& operator/=(float a)
 	{
 		return (*this = *this / a);
 	}
 
-	vec3& operator+=(const vec3& v)
+	SIMPLEMATH_CONSTEXPR vec3& operator+=(const vec3& v)
 	{
 		return (*this = *this + v);
 	}
 
-	vec3& operator-=(const vec3& v)
+	SIMPLEMATH_CONSTEXPR vec3& operator-=(const vec3& v)
 	{
 		return (*this = *this - v);
 	}
@@ -247,19 +303,30 @@ struct vec3
 		return sqrtf(x * x + y * y + z * z);
 	}
 
-	float length_squared() const
+	SIMPLEMATH_CONSTEXPR float length_squared() const
 	{
 		return x * x + y * y + z * z;
 	}
 
 	float normalize()
 	{
+#if defined(SIMPLEMATH_FAST_MATH)
+		float len = length_squared();
+
+		if(len < Epsilon() * Epsilon())
+			return 0.0f;
+
+		float inv = fast_rsqrt(len);
+
+		len *= inv;
+#else
 		float len = length();
 
 		if(len < Epsilon())
 			return 0.0f;
 
 		float inv = 1.0f / len;
+#endif
 
 		x *= inv;
 		y *= inv;
@@ -270,49 +337,59 @@ struct vec3
 
 	vec3 normalized() const
 	{
+#if defined(SIMPLEMATH_FAST_MATH)
+		float len = length_squared();
+
+		if(len < Epsilon() * Epsilon())
+			return *this;
+
+		float inv = fast_rsqrt(len);
+#else
 		float len = length();
 
 		if(len < Epsilon())
 			return *this;
 
 		float inv = 1.0f / len;
+#endif
 
 		return *this * inv;
 	}
 
-	float dot(const vec3& v) const
+	// Same result as 'x * v.x + y * v.y + z * v.z' unless SIMPLEMATH_FMA is defined
+	SIMPLEMATH_CONSTEXPR float dot(const vec3& v) const
 	{
-		return x * v.x + y * v.y + z * v.z;
+		return mul_add(z, v.z, mul_add(y, v.y, x * v.x));
 	}
 
-	vec3 cross(const vec3& v2) const
+	SIMPLEMATH_CONSTEXPR vec3 cross(const vec3& v2) const
 	{
 		vec3 ret;
-		ret.x = y * v2.z - z * v2.y;
-		ret.y = z * v2.x - x * v2.z;
-		ret.z = x * v2.y - y * v2.x;
+		ret.x = mul_add(y, v2.z, -z * v2.y);
+		ret.y = mul_add(z, v2.x, -x * v2.z);
+		ret.z = mul_add(x, v2.y, -y * v2.x);
 		return ret;
 	}
 
-	void cross(const vec3& v1, const vec3& v2)
+	SIMPLEMATH_CONSTEXPR void cross(const vec3& v1, const vec3& v2)
 	{
-		x = v1.y * v2.z - v1.z * v2.y;
-		y = v1.z * v2.x - v1.x * v2.z;
-		z = v1.x * v2.y - v1.y * v2.x;
+		x = mul_add(v1.y, v2.z, -v1.z * v2.y);
+		y = mul_add(v1.z, v2.x, -v1.x * v2.z);
+		z = mul_add(v1.x, v2.y, -v1.y * v2.x);
 	}
 
 	// Swizzles
-	vec2 xy() const
+	SIMPLEMATH_CONSTEXPR vec2 xy() const
 	{
 		return vec2(x, y);
 	}
 
-	vec2 xx() const
+	SIMPLEMATH_CONSTEXPR vec2 xx() const
 	{
 		return vec2(x, x);
 	}
 
-	vec2 yy() const
+	SIMPLEMATH_CONSTEXPR vec2 yy() const
 	{
 		return vec2(y, y);
 	}
@@ -324,104 +401,148 @@ struct vec3
 /*								vec4											*/
 /********************************************************************************/
 
-struct vec4
+struct SIMPLEMATH_ALIGN16 vec4
 {
-	vec4(): x(0.0f), y(0.0f), z(0.0f), w(0.0f)
+	SIMPLEMATH_CONSTEXPR vec4(): x(0.0f), y(0.0f), z(0.0f), w(0.0f)
+	{
+	}
+
+	SIMPLEMATH_CONSTEXPR explicit vec4(float v): x(v), y(v), z(v), w(v)
+	{
+	}
+
+	SIMPLEMATH_CONSTEXPR vec4(const vec2& v, float z, float w): x(v.x), y(v.y), z(z), w(w)
+	{
+	}
+
+	SIMPLEMATH_CONSTEXPR vec4(const vec3& v, float w): x(v.x), y(v.y), z(v.z), w(w)
 	{
 	}
 
-	explicit vec4(float v): x(v), y(v), z(v), w(v)
+	SIMPLEMATH_CONSTEXPR explicit vec4(const vec2& v): x(v.x), y(v.y), z(0.0f), w(1.0f)
 	{
 	}
 
-	vec4(const vec2& v, float z, float w): x(v.x), y(v.y), z(z), w(w)
+	SIMPLEMATH_CONSTEXPR explicit vec4(const vec3& v): x(v.x), y(v.y), z(v.z), w(1.0f)
 	{
 	}
 
-	vec4(const vec3& v, float w): x(v.x), y(v.y), z(v.z), w(w)
+	SIMPLEMATH_CONSTEXPR explicit vec4(const float* v): x(v[0]), y(v[1]), z(v[2]), w(v[3])
 	{
 	}
 
-	explicit vec4(const vec2& v): x(v.x), y(v.y), z(0.0f), w(1.0f)
+	SIMPLEMATH_CONSTEXPR vec4(float x, float y, float z, float w = 1.0f): x(x), y(y), z(z), w(w)
 	{
 	}
 
-	explicit vec4(const vec3& v): x(v.x), y(v.y), z(v.z), w(1.0f)
+	explicit vec4(uninitialized_tag)
 	{
 	}
 
-	explicit vec4(const float* v): x(v[0]), y(v[1]), z(v[2]), w(v[3])
+#if defined(SIMPLEMATH_SSE41)
+	explicit vec4(__m128 v)
 	{
+		_mm_store_ps(&x, v);
 	}
 
-	vec4(float x, float y, float z, float w = 1.0f): x(x), y(y), z(z), w(w)
+	__m128 simd() const
 	{
+		return _mm_load_ps(&x);
 	}
+#endif
 
 	// Unary operators
-	const vec4 operator-() const
+	SIMPLEMATH_CONSTEXPR_SIMD vec4 operator-() const
 	{
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+			return vec4(_mm_xor_ps(simd(), _mm_set1_ps(-0.0f)));
+#endif
 		return vec4(-x, -y, -z, -w);
 	}
 
 	// Binary operators
-	const vec4 operator*(float a) const
+	SIMPLEMATH_CONSTEXPR_SIMD vec4 operator*(float a) const
 	{
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+			return vec4(_mm_mul_ps(simd(), _mm_set1_ps(a)));
+#endif
 		return vec4(x*a, y*a, z*a, w*a);
 	}
 
-	const vec4 operator/(float a) const
+	SIMPLEMATH_CONSTEXPR_SIMD vec4 operator/(float a) const
 	{
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+			return vec4(_mm_div_ps(simd(), _mm_set1_ps(a)));
+#endif
 		return vec4(x / a, y / a, z / a, w / a);
 	}
 
-	const vec4 operator+(const vec4& v) const
+	SIMPLEMATH_CONSTEXPR_SIMD vec4 operator+(const vec4& v) const
 	{
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+			return vec4(_mm_add_ps(simd(), v.simd()));
+#endif
 		return vec4(x + v.x, y + v.y, z + v.z, w + v.w);
 	}
 
-	const vec4 operator-(const vec4& v) const
+	SIMPLEMATH_CONSTEXPR_SIMD vec4 operator-(const vec4& v) const
 	{
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+			return vec4(_mm_sub_ps(simd(), v.simd()));
+#endif
 		return vec4(x - v.x, y - v.y, z - v.z, w - v.w);
 	}
 
-	const vec4 operator*(const vec4& v) const
+	SIMPLEMATH_CONSTEXPR_SIMD vec4 operator*(const vec4& v) const
 	{
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+			return vec4(_mm_mul_ps(simd(), v.simd()));
+#endif
 		return vec4(x*v.x, y*v.y, z*v.z, w*v.w);
 	}
 
-	bool operator==(const vec4& v) const
+	SIMPLEMATH_CONSTEXPR_SIMD bool operator==(const vec4& v) const
 	{
+#if defined(SIMPLEMATH_SSE41)
+		if(!SIMPLEMATH_CONSTANT_EVALUATED())
+			return _mm_movemask_ps(_mm_cmpeq_ps(simd(), v.simd())) == 0xf;
+#endif
 		return v.x == x && v.y == y && v.z == z && v.w == w;
 	}
 
-	bool operator!=(const vec4& v) const
+	SIMPLEMATH_CONSTEXPR_SIMD bool operator!=(const vec4& v) const
 	{
 		return !(*this == v);
 	}
 
 	// Assignment operators
-	vec4& operator*=(float a)
+	SIMPLEMATH_CONSTEXPR_SIMD vec4& operator*=(float a)
 	{
 		return (*this = *this * a);
 	}
 
-	vec4& operator/=(float a)
+	SIMPLEMATH_CONSTEXPR_SIMD vec4& operator/=(float a)
 	{
 		return (*this = *this / a);
 	}
 
-	vec4& operator+=(const vec4& v)
+	SIMPLEMATH_CONSTEXPR_SIMD vec4& operator+=(const vec4& v)
 	{
 		return (*this = *this + v);
 	}
 
-	vec4& operator-=(const vec4& v)
+	SIMPLEMATH_CONSTEXPR_SIMD vec4& operator-=(const vec4& v)
 	{
 		return (*this = *this - v);
 	}
 
-	vec4& operator*=(const vec4& v)
+	SIMPLEMATH_CONSTEXPR_SIMD vec4& operator*=(const vec4& v)
 	{
 		return (*this = *this * v);
 	}
@@ -432,19 +553,30 @@ struct vec4
 		return sqrtf(x * x + y * y + z * z);
 	}
 
-	float length_squared() const
+	SIMPLEMATH_CONSTEXPR float length_squared() const
 	{
 		return x * x + y * y + z * z;
 	}
 
 	float normalize()
 	{
+#if defined(SIMPLEMATH_FAST_MATH)
+		float len = length_squared();
+
+		if(len < Epsilon() * Epsilon())
+			return 0.0f;
+
+		float inv = fast_rsqrt(len);
+
+		len *= inv;
+#else
 		float len = length();
 
 		if(len < Epsilon())
 			return 0.0f;
 
 		float inv = 1.0f / len;
+#endif
 
 		x *= inv;
 		y *= inv;
@@ -455,43 +587,52 @@ struct vec4
 
 	vec4 normalized() const
 	{
+#if defined(SIMPLEMATH_FAST_MATH)
+		float len = length_squared();
+
+		if(len < Epsilon() * Epsilon())
+			return *this;
+
+		float inv = fast_rsqrt(len);
+#else
 		float len = length();
 
 		if(len < Epsilon())
 			return *this;
 
 		float inv = 1.0f / len;
+#endif
 
 		return vec4(xyz() * inv, 1.0f);
 	}
 
 	// Swizzles
-	vec2 xy() const
+	SIMPLEMATH_CONSTEXPR vec2 xy() const
 	{
 		return vec2(x, y);
 	}
 
-	vec3 xyz() const
+	SIMPLEMATH_CONSTEXPR vec3 xyz() const
 	{
 		return vec3(x, y, z);
 	}
 
-	vec3 xxx() const
+	SIMPLEMATH_CONSTEXPR vec3 xxx() const
 	{
 		return vec3(x, x, x);
 	}
 
-	vec3 yyy() const
+	SIMPLEMATH_CONSTEXPR vec3 yyy() const
 	{
 		return vec3(y, y, y);
 	}
 
-	vec3 zzz() const
+	SIMPLEMATH_CONSTEXPR vec3 zzz() const
 	{
 		return vec3(z, z, z);
 	}
 
-	vec3 www() const
+	SIMPLEMATH_CONSTEXPR vec3 www() const
 	{
 		return vec3(w, w, w);
 	}
@@ -499,52 +640,53 @@ struct vec4
 	float x, y, z, w;
 };
 
+SIMPLEMATH_ASSERT_PLAIN_TYPE(vec2, 8);
+SIMPLEMATH_ASSERT_PLAIN_TYPE(vec3, 12);
+SIMPLEMATH_ASSERT_PLAIN_TYPE(vec4, 16);
+
 // Additional functions
-inline vec2::vec2(const vec3& v)
+inline SIMPLEMATH_CONSTEXPR vec2::vec2(const vec3& v): x(v.x), y(v.y)
 {
-	x = v.x;
-	y = v.y;
 }
 
-inline vec2::vec2(const vec4& v)
+inline SIMPLEMATH_CONSTEXPR vec2::vec2(const vec4& v): x(v.x), y(v.y)
 {
-	x = v.x;
-	y = v.y;
 }
 
-inline vec3::vec3(const vec4& v)
+inline SIMPLEMATH_CONSTEXPR vec3::vec3(const vec4& v): x(v.x), y(v.y), z(v.z)
 {
-	x = v.x;
-	y = v.y;
-	z = v.z;
 }
 
-inline vec2 operator*(const float f, const vec2& v)
+inline SIMPLEMATH_CONSTEXPR vec2 operator*(const float f, const vec2& v)
 {
 	return vec2(f * v.x, f * v.y);
 }
 
-inline vec3 operator*(const float f, const vec3& v)
+inline SIMPLEMATH_CONSTEXPR vec3 operator*(const float f, const vec3& v)
 {
 	return vec3(f * v.x, f * v.y, f * v.z);
 }
 
-inline vec4 operator*(const float f, const vec4& v)
+inline SIMPLEMATH_CONSTEXPR_SIMD vec4 operator*(const float f, const vec4& v)
 {
+#if defined(SIMPLEMATH_SSE41)
+	if(!SIMPLEMATH_CONSTANT_EVALUATED())
+		return vec4(_mm_mul_ps(_mm_set1_ps(f), v.simd()));
+#endif
 	return vec4(f * v.x, f * v.y, f * v.z, f * v.w);
 }
 
-inline vec2 operator/(const float f, const vec2& v)
+inline SIMPLEMATH_CONSTEXPR vec2 operator/(const float f, const vec2& v)
 {
 	return vec2(f / v.x, f / v.y);
 }
 
-inline vec3 operator/(const float f, const vec3& v)
+inline SIMPLEMATH_CONSTEXPR vec3 operator/(const float f, const vec3& v)
 {
 	return vec3(f / v.x, f / v.y, f / v.z);
 }
 
-inline vec4 operator/(const float f, const vec4& v)
+inline SIMPLEMATH_CONSTEXPR vec4 operator/(const float f, const vec4& v)
 {
 	return vec4(f / v.x, f / v.y, f / v.z, f / v.w);
 }
@@ -567,36 +709,53 @@ inline vec4 normalize(vec4 v)
 	return v;
 }
 
-inline vec3 cross(const vec3& v1, const vec3& v2)
+inline SIMPLEMATH_CONSTEXPR vec3 cross(const vec3& v1, const vec3& v2)
 {
 	vec3 ret;
-	ret.x = v1.y * v2.z - v1.z * v2.y;
-	ret.y = v1.z * v2.x - v1.x * v2.z;
-	ret.z = v1.x * v2.y - v1.y * v2.x;
+	ret.x = mul_add(v1.y, v2.z, -v1.z * v2.y);
+	ret.y = mul_add(v1.z, v2.x, -v1.x * v2.z);
+	ret.z = mul_add(v1.x, v2.y, -v1.y * v2.x);
 	return ret;
 }
 
-inline float dot(const vec2& v1, const vec2& v2)
+inline SIMPLEMATH_CONSTEXPR float dot(const vec2& v1, const vec2& v2)
 {
-	return v1.x * v2.x + v1.y * v2.y;
+	return mul_add(v1.y, v2.y, v1.x * v2.x);
 }
 
-inline float dot(const vec3& v1, const vec3& v2)
+inline SIMPLEMATH_CONSTEXPR float dot(const vec3& v1, const vec3& v2)
 {
-	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+	return mul_add(v1.z, v2.z, mul_add(v1.y, v2.y, v1.x * v2.x));
 }
 
-inline float dot(const vec4& v1, const vec4& v2)
+inline SIMPLEMATH_CONSTEXPR_SIMD float dot(const vec4& v1, const vec4& v2)
 {
+#if defined(SIMPLEMATH_SSE41)
+	if(!SIMPLEMATH_CONSTANT_EVALUATED())
+	{
+		// Components are summed in the same order as in the scalar code to get the same result
+		__m128 m = _mm_mul_ps(v1.simd(), v2.simd());
+		__m128 sum = _mm_add_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+		sum = _mm_add_ss(sum, _mm_movehl_ps(m, m));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(m, m, _MM_SHUFFLE(3, 3, 3, 3)));
+		return _mm_cvtss_f32(sum);
+	}
+#endif
 	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z + v1.w * v2.w;
 }
 
-inline float dot(const vec3& v1, const vec4& v2)
+// Distance from a point to a plane
+inline SIMPLEMATH_CONSTEXPR float dot(const vec3& v1, const vec4& v2)
 {
+#if defined(SIMPLEMATH_FMA)
+	// Three fused operations, 'w' is added first
+	return mul_add(v1.z, v2.z, mul_add(v1.y, v2.y, mul_add(v1.x, v2.x, v2.w)));
+#else
 	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z + v2.w;
+#endif
 }
 
-inline vec2 saturate(const vec2& v)
+inline SIMPLEMATH_CONSTEXPR vec2 saturate(const vec2& v)
 {
 	vec2 ret = v;
 
@@ -613,7 +772,7 @@ inline vec2 saturate(const vec2& v)
 	return ret;
 }
 
-inline vec3 saturate(const vec3& v)
+inline SIMPLEMATH_CONSTEXPR vec3 saturate(const vec3& v)
 {
 	vec3 ret = v;
 
@@ -635,7 +794,7 @@ inline vec3 saturate(const vec3& v)
 	return ret;
 }
 
-inline vec4 saturate(const vec4& v)
+inline SIMPLEMATH_CONSTEXPR vec4 saturate(const vec4& v)
 {
 	vec4 ret = v;
 